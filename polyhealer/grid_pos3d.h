@@ -0,0 +1,238 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef GRID_POS3D_H
+#define GRID_POS3D_H
+
+/*
+   grid_pos3d is a special purpose STL-style generic container
+   which uses 3d coordinates as keys (i.e. pos3d), with the same
+   insert/find/range interface as the former multimap_pos3d, which it replaces.
+
+   Values are hashed into a uniform 3d grid with cell size equal to the tolerance,
+   so all matches of a position are found in the 27 cells around it. Unlike the
+   spherical shells of multimap_pos3d, the number of candidates does not grow
+   with the number of points at similar distance from some base point.
+
+   For welding all vertices of a polyhedron at once, see vertex_welder.
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "spacemath/pos3d.h"
+
+template<class T>
+class grid_pos3d {
+public:
+
+   grid_pos3d() : m_tol(1.0e-3), m_cell_size(1.0e-3) {};
+
+   // set the matching tolerance, existing values are re-hashed
+   void setTolerance(double tol);
+
+   // value_type is used when inserting values
+   typedef std::pair<spacemath::pos3d,T>               value_type;
+
+   // internal container type and iterator.
+   // As for std::vector, iterators are invalidated by insertion
+   typedef std::vector<value_type>                     PosVec;
+   typedef typename PosVec::iterator                   iterator;
+
+   // simple iteration over all values, in insertion order
+   iterator begin()                                   { return m_values.begin(); }
+   iterator end()                                     { return m_values.end(); }
+
+   // find returns the match closest to the given pos
+   // or end() if no match found
+   iterator find(const spacemath::pos3d& pos);
+
+   // size and clear do the obvious things
+   size_t size() const                                { return m_values.size(); }
+   void clear();
+
+   // pos_range is the special type that allows
+   // finding instances based on coordinates.
+   // It contains only the instances within tolerance of the range position
+   class pos_range {
+   public:
+      typedef std::vector<iterator>                   match_vector;
+      typedef typename match_vector::const_iterator   match_iterator;
+
+      pos_range(const spacemath::pos3d& pos,double tol)
+         : m_pos(pos),m_tol(tol) {}
+
+      const spacemath::pos3d& range_position() const            { return m_pos; }
+      const spacemath::pos3d& position(match_iterator it) const { return (*it)->first;}
+      const T& value(match_iterator it) const                   { return (*it)->second; }
+
+      // first match in the range
+      match_iterator begin() const                              { return m_matches.begin(); }
+
+      // one beyond range
+      match_iterator end() const                                { return m_matches.end(); }
+
+      // next match
+      match_iterator next_match(match_iterator it)              { return ++it; }
+
+      size_t size() const                                       { return m_matches.size(); }
+      double tol()                                              { return m_tol; }
+
+      void add_match(iterator it)                               { m_matches.push_back(it); }
+
+   private:
+      spacemath::pos3d m_pos;      // the range is based on this coordinate set
+      match_vector     m_matches;  // the matching instances
+      double           m_tol;      // the tolerance
+   };
+
+   // insertion of a new value
+   iterator  insert(const value_type& value);
+
+   // extract the range of matches
+   pos_range equal_key_range(const spacemath::pos3d& pos);
+
+private:
+   // integer grid cell coordinates
+   struct cell_index {
+      int64_t ix,iy,iz;
+      bool operator==(const cell_index& other) const { return ix==other.ix && iy==other.iy && iz==other.iz; }
+   };
+
+   struct cell_hash {
+      size_t operator()(const cell_index& c) const
+      {
+         // large primes mixing the 3 coordinates
+         return size_t(c.ix*73856093LL) ^ size_t(c.iy*19349663LL) ^ size_t(c.iz*83492791LL);
+      }
+   };
+
+   typedef std::unordered_map<cell_index,size_t,cell_hash> CellMap;
+
+   static const size_t npos = static_cast<size_t>(-1);
+
+   cell_index key(const spacemath::pos3d& pos) const;
+   void       link(size_t i);
+
+private:
+   PosVec              m_values;     // all values, in insertion order
+   std::vector<size_t> m_next;       // next value in the same cell, npos at end
+   CellMap             m_cells;      // first value in each cell
+   double              m_tol;        // the tolerance
+   double              m_cell_size;  // grid cell size, equal to tolerance unless tolerance is zero
+};
+
+template <class T>
+const size_t grid_pos3d<T>::npos;
+
+template <class T>
+void grid_pos3d<T>::setTolerance(double tol)
+{
+   m_tol       = tol;
+   m_cell_size = (tol > 0.0)? tol : 1.0;
+
+   // re-hash values already inserted
+   m_cells.clear();
+   for(size_t i=0; i<m_values.size(); i++) link(i);
+}
+
+template <class T>
+typename grid_pos3d<T>::cell_index grid_pos3d<T>::key(const spacemath::pos3d& pos) const
+{
+   cell_index c;
+   c.ix = int64_t(std::floor(pos.x()/m_cell_size));
+   c.iy = int64_t(std::floor(pos.y()/m_cell_size));
+   c.iz = int64_t(std::floor(pos.z()/m_cell_size));
+   return c;
+}
+
+template <class T>
+void grid_pos3d<T>::link(size_t i)
+{
+   // push value i at front of its cell list
+   auto ins = m_cells.insert(std::make_pair(key(m_values[i].first),i));
+   if(ins.second) {
+      m_next[i] = npos;
+   }
+   else {
+      m_next[i] = ins.first->second;
+      ins.first->second = i;
+   }
+}
+
+template <class T>
+void grid_pos3d<T>::clear()
+{
+   m_values.clear();
+   m_next.clear();
+   m_cells.clear();
+}
+
+template <class T>
+typename grid_pos3d<T>::iterator grid_pos3d<T>::insert(const value_type& value)
+{
+   m_values.push_back(value);
+   m_next.push_back(npos);
+   link(m_values.size()-1);
+   return m_values.end()-1;
+}
+
+template <class T>
+typename grid_pos3d<T>::pos_range grid_pos3d<T>::equal_key_range(const spacemath::pos3d& pos)
+{
+   // return all instances within tolerance, they are found in the neighbouring cells
+   pos_range range(pos,m_tol);
+
+   cell_index c0 = key(pos);
+   for(int64_t dx=-1; dx<=1; dx++) {
+      for(int64_t dy=-1; dy<=1; dy++) {
+         for(int64_t dz=-1; dz<=1; dz++) {
+            cell_index c = { c0.ix+dx, c0.iy+dy, c0.iz+dz };
+            auto it = m_cells.find(c);
+            if(it == m_cells.end()) continue;
+            for(size_t i=it->second; i!=npos; i=m_next[i]) {
+               if(pos.dist(m_values[i].first) <= m_tol) range.add_match(m_values.begin()+i);
+            }
+         }
+      }
+   }
+   return range;
+}
+
+template <class T>
+typename grid_pos3d<T>::iterator grid_pos3d<T>::find(const spacemath::pos3d& pos)
+{
+   // get the range of matches
+   pos_range range = equal_key_range(pos);
+
+   // select the nearest one
+   iterator itfound = end();
+   double dist0 = 0.0;
+   for(auto it=range.begin(); it!=range.end(); it=range.next_match(it)) {
+      double dist = range.position(it).dist(pos);
+      if(itfound==end() || dist < dist0) {
+         // this one was closer
+         dist0   = dist;
+         itfound = *it;
+      }
+   }
+
+   // return the closest match
+   return itfound;
+}
+
+#endif // GRID_POS3D_H
@@ -0,0 +1,453 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "halfedge_mesh.h"
+#include "spacemath/line3d.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+const size_t halfedge_mesh::npos;
+
+halfedge_mesh::halfedge_mesh(const std::shared_ptr<polyhedron3d> poly)
+: m_poly(poly)
+{
+   clear();
+   construct();
+}
+
+halfedge_mesh::~halfedge_mesh()
+{}
+
+void halfedge_mesh::clear()
+{
+   m_vert.clear();
+   m_vert_valid.clear();
+   m_vert_he.clear();
+   m_vert_free.clear();
+
+   m_he.clear();
+   m_he_free.clear();
+
+   m_face.clear();
+   m_face_free.clear();
+}
+
+void halfedge_mesh::construct()
+{
+   size_t nvert = m_poly->vertex_size();
+   m_vert.reserve(nvert);
+   for(size_t iv=0; iv<nvert; iv++) m_vert.push_back(m_poly->vertex(iv));
+   m_vert_valid.assign(nvert,1);
+   m_vert_he.assign(nvert,npos);
+
+   size_t nface = m_poly->face_size();
+   size_t nhe   = 0;
+   for(size_t iface=0; iface<nface; iface++) nhe += m_poly->face(iface).size();
+   m_he.reserve(nhe);
+   m_face.reserve(nface);
+
+   for(size_t iface=0; iface<nface; iface++) add_face(m_poly->face(iface));
+}
+
+std::shared_ptr<polyhedron3d> halfedge_mesh::update_input()
+{
+   // new vertex numbers of valid vertices: iv_new = vtx[iv_old]
+   vtx_vec vert;
+   vert.reserve(vertex_size());
+   std::vector<id_vertex> vtx(m_vert.size(),npos);
+   for(id_vertex iv=0; iv<m_vert.size(); iv++) {
+      if(m_vert_valid[iv]) {
+         vtx[iv] = vert.size();
+         vert.push_back(m_vert[iv]);
+      }
+   }
+
+   pface_vec faces;
+   faces.reserve(face_size());
+   for(id_face iface=0; iface<m_face.size(); iface++) {
+      if(face_valid(iface)) {
+         pface face_new;
+         id_halfedge ih0 = m_face[iface];
+         id_halfedge ih  = ih0;
+         do {
+            face_new.push_back(vtx[m_he[ih].vert]);
+            ih = m_he[ih].next;
+         } while(ih != ih0);
+         faces.push_back(face_new);
+      }
+   }
+
+   // update the polyhedron
+   m_poly->assign(vert,faces);
+
+   return m_poly;
+}
+
+id_vertex halfedge_mesh::add_vertex(const pos3d& pos)
+{
+   if(m_vert_free.size() > 0) {
+      id_vertex iv = m_vert_free.back();
+      m_vert_free.pop_back();
+      m_vert[iv]       = pos;
+      m_vert_valid[iv] = 1;
+      m_vert_he[iv]    = npos;
+      return iv;
+   }
+
+   m_vert.push_back(pos);
+   m_vert_valid.push_back(1);
+   m_vert_he.push_back(npos);
+   return m_vert.size()-1;
+}
+
+void halfedge_mesh::remove_vertex(id_vertex iv)
+{
+   if(m_vert_valid[iv]) {
+      m_vert_valid[iv] = 0;
+      m_vert_free.push_back(iv);
+   }
+}
+
+pface halfedge_mesh::face(id_face iface) const
+{
+   pface face;
+   id_halfedge ih0 = m_face[iface];
+   id_halfedge ih  = ih0;
+   do {
+      face.push_back(m_he[ih].vert);
+      ih = m_he[ih].next;
+   } while(ih != ih0);
+   return face;
+}
+
+halfedge_mesh::id_halfedge halfedge_mesh::new_halfedge()
+{
+   if(m_he_free.size() > 0) {
+      id_halfedge ih = m_he_free.back();
+      m_he_free.pop_back();
+      return ih;
+   }
+   m_he.push_back(halfedge());
+   return m_he.size()-1;
+}
+
+id_face halfedge_mesh::add_face(id_vertex iv1, id_vertex iv2, id_vertex iv3)
+{
+   pface face = {iv1,iv2,iv3};
+   return add_face(face);
+}
+
+id_face halfedge_mesh::add_face(const pface& face)
+{
+   size_t nv = face.size();
+   if(nv < 3) throw std::logic_error("halfedge_mesh::add_face, face has less than 3 vertices: " + std::to_string(nv));
+   for(id_vertex iv : face) {
+      if(iv >= m_vert_he.size()) throw std::logic_error("halfedge_mesh::add_face, vertex index out of range: " + std::to_string(iv));
+   }
+
+   // new face id
+   id_face iface = m_face.size();
+   if(m_face_free.size() > 0) {
+      iface = m_face_free.back();
+      m_face_free.pop_back();
+   }
+   else {
+      m_face.push_back(npos);
+   }
+
+   // create the half-edge cycle
+   id_halfedge ih_first = npos;
+   id_halfedge ih_prev  = npos;
+   for(size_t iv=0; iv<nv; iv++) {
+      id_halfedge ih = new_halfedge();
+      halfedge& he = m_he[ih];
+      he.vert     = face[iv];
+      he.next     = npos;
+      he.opposite = ih;
+      he.vlink    = npos;
+      he.face     = iface;
+      if(ih_prev != npos) m_he[ih_prev].next = ih;
+      else                ih_first = ih;
+      ih_prev = ih;
+   }
+   m_he[ih_prev].next = ih_first;
+   m_face[iface] = ih_first;
+
+   // connect the half-edges to their edges
+   id_halfedge ih = ih_first;
+   do {
+      link_edge(ih);
+      link_vertex(ih);
+      ih = m_he[ih].next;
+   } while(ih != ih_first);
+
+   return iface;
+}
+
+void halfedge_mesh::remove_face(id_face iface)
+{
+   id_halfedge ih0 = m_face[iface];
+   id_halfedge ih  = ih0;
+   do {
+      unlink_edge(ih);
+      unlink_vertex(ih);
+      ih = m_he[ih].next;
+   } while(ih != ih0);
+
+   // free the half-edges only after traversal, the next links are still needed above
+   ih = ih0;
+   do {
+      id_halfedge ih_next = m_he[ih].next;
+      m_he[ih].face = npos;
+      m_he_free.push_back(ih);
+      ih = ih_next;
+   } while(ih != ih0);
+
+   m_face[iface] = npos;
+   m_face_free.push_back(iface);
+}
+
+void halfedge_mesh::face_flip(id_face iface)
+{
+   // each half-edge keeps its edge, but changes direction.
+   // Therefore the edge and vertex lists are not affected
+   std::vector<id_halfedge> hes;
+   id_halfedge ih0 = m_face[iface];
+   id_halfedge ih  = ih0;
+   do {
+      hes.push_back(ih);
+      ih = m_he[ih].next;
+   } while(ih != ih0);
+
+   size_t nhe = hes.size();
+   std::vector<id_vertex> targets(nhe);
+   for(size_t i=0; i<nhe; i++) targets[i] = target(hes[i]);
+   for(size_t i=0; i<nhe; i++) {
+      halfedge& he = m_he[hes[i]];
+      he.vert = targets[i];
+      he.next = hes[(i+nhe-1)%nhe];
+   }
+}
+
+halfedge_mesh::id_halfedge halfedge_mesh::prev(id_halfedge ih) const
+{
+   id_halfedge ip = ih;
+   while(m_he[ip].next != ih) ip = m_he[ip].next;
+   return ip;
+}
+
+size_t halfedge_mesh::edge_use_count(id_halfedge ih) const
+{
+   size_t count = 1;
+   for(id_halfedge io=m_he[ih].opposite; io!=ih; io=m_he[io].opposite) count++;
+   return count;
+}
+
+bool halfedge_mesh::edge_leader(id_halfedge ih) const
+{
+   for(id_halfedge io=m_he[ih].opposite; io!=ih; io=m_he[io].opposite) {
+      if(io < ih) return false;
+   }
+   return true;
+}
+
+halfedge_mesh::id_halfedge halfedge_mesh::find_halfedge(id_vertex iv0, id_vertex iv1) const
+{
+   id_vertex ivlo = std::min(iv0,iv1);
+   id_vertex ivhi = std::max(iv0,iv1);
+   for(id_halfedge ih=m_vert_he[ivlo]; ih!=npos; ih=m_he[ih].vlink) {
+      if(std::max(origin(ih),target(ih)) == ivhi) return ih;
+   }
+   return npos;
+}
+
+void halfedge_mesh::link_edge(id_halfedge ih)
+{
+   // must be called before ih is linked to its vertex, so it does not find itself
+   id_halfedge io = find_halfedge(origin(ih),target(ih));
+   if(io != npos) {
+      m_he[ih].opposite = m_he[io].opposite;
+      m_he[io].opposite = ih;
+   }
+   else {
+      m_he[ih].opposite = ih;
+   }
+}
+
+void halfedge_mesh::unlink_edge(id_halfedge ih)
+{
+   id_halfedge ip = ih;
+   while(m_he[ip].opposite != ih) ip = m_he[ip].opposite;
+   m_he[ip].opposite = m_he[ih].opposite;
+   m_he[ih].opposite = ih;
+}
+
+void halfedge_mesh::link_vertex(id_halfedge ih)
+{
+   id_vertex ivlo = std::min(origin(ih),target(ih));
+   m_he[ih].vlink = m_vert_he[ivlo];
+   m_vert_he[ivlo] = ih;
+}
+
+void halfedge_mesh::unlink_vertex(id_halfedge ih)
+{
+   id_vertex ivlo = std::min(origin(ih),target(ih));
+   id_halfedge* link = &m_vert_he[ivlo];
+   while(*link != ih) link = &m_he[*link].vlink;
+   *link = m_he[ih].vlink;
+   m_he[ih].vlink = npos;
+}
+
+bool halfedge_mesh::flip_edge(id_halfedge ih)
+{
+   // ih: a->b in face A = (a,b,c),  it: b->a in face B = (b,a,d)
+   id_halfedge it = m_he[ih].opposite;
+   if(it == ih || m_he[it].opposite != ih) return false;
+
+   id_halfedge ih1 = m_he[ih].next;
+   id_halfedge ih2 = m_he[ih1].next;
+   id_halfedge it1 = m_he[it].next;
+   id_halfedge it2 = m_he[it1].next;
+   if(m_he[ih2].next != ih || m_he[it2].next != it) return false;
+
+   id_vertex a = origin(ih);
+   id_vertex b = origin(ih1);
+   id_vertex c = origin(ih2);
+   id_vertex d = origin(it2);
+   if(origin(it) != b || origin(it1) != a) return false;
+   if(c == d || find_halfedge(c,d) != npos) return false;
+
+   id_face iface_a = m_he[ih].face;
+   id_face iface_b = m_he[it].face;
+
+   unlink_vertex(ih);
+   unlink_vertex(it);
+
+   // A = (c,d,b) using ih, it2, ih1
+   m_he[ih].vert  = c;   m_he[ih].next  = it2;
+   m_he[it2].next = ih1; m_he[it2].face = iface_a;
+   m_he[ih1].next = ih;
+
+   // B = (d,c,a) using it, ih2, it1
+   m_he[it].vert  = d;   m_he[it].next  = ih2;
+   m_he[ih2].next = it1; m_he[ih2].face = iface_b;
+   m_he[it1].next = it;
+
+   m_face[iface_a] = ih;
+   m_face[iface_b] = it;
+
+   link_vertex(ih);
+   link_vertex(it);
+
+   return true;
+}
+
+id_vertex halfedge_mesh::opposite_vertex(id_halfedge ih) const
+{
+   id_halfedge ih2 = m_he[ih].next;
+   id_halfedge ih3 = m_he[ih2].next;
+   if(m_he[ih3].next != ih) throw std::logic_error("halfedge_mesh::opposite_vertex, face is not a triangle");
+   return m_he[ih3].vert;
+}
+
+void halfedge_mesh::triangle(id_face iface, id_vertex& iv1, id_vertex& iv2, id_vertex& iv3, const char* caller) const
+{
+   id_halfedge ih1 = m_face[iface];
+   id_halfedge ih2 = m_he[ih1].next;
+   id_halfedge ih3 = m_he[ih2].next;
+   if(m_he[ih3].next != ih1) throw std::logic_error(std::string("halfedge_mesh::") + caller + ", face is not a triangle");
+   iv1 = m_he[ih1].vert;
+   iv2 = m_he[ih2].vert;
+   iv3 = m_he[ih3].vert;
+}
+
+double halfedge_mesh::edge_length(id_vertex iv1, id_vertex iv2) const
+{
+   return m_vert[iv1].dist(m_vert[iv2]);
+}
+
+double halfedge_mesh::edge_length(id_halfedge ih) const
+{
+   return edge_length(origin(ih),target(ih));
+}
+
+double halfedge_mesh::face_area(id_vertex iv1, id_vertex iv2, id_vertex iv3) const
+{
+   vec3d v1(m_vert[iv1],m_vert[iv2]);
+   vec3d v2(m_vert[iv1],m_vert[iv3]);
+   return 0.5*v1.cross(v2).length();
+}
+
+double halfedge_mesh::face_area(id_face iface) const
+{
+   id_vertex iv1,iv2,iv3;
+   triangle(iface,iv1,iv2,iv3,"face_area");
+   return face_area(iv1,iv2,iv3);
+}
+
+double halfedge_mesh::face_aspect_ratio(id_vertex iv1, id_vertex iv2, id_vertex iv3) const
+{
+   const pos3d& p1 = m_vert[iv1];
+   const pos3d& p2 = m_vert[iv2];
+   const pos3d& p3 = m_vert[iv3];
+
+   // we define aspect ratio to be defined from the
+   // longest edge and the projection distance of opposite vertex down to the same edge
+
+   line3d line1(p1,p2);
+   line3d line2(p2,p3);
+   line3d line3(p1,p3);
+
+   // figure out which edge/vertex pair is most relevant
+   typedef std::pair<line3d,pos3d> aspect_pair;
+   std::map<double,aspect_pair> edges;
+   edges[line1.length()] = std::make_pair(line1,p3);
+   edges[line2.length()] = std::make_pair(line2,p1);
+   edges[line3.length()] = std::make_pair(line3,p2);
+
+   // use the longest edge
+   auto i = edges.rbegin();
+   const auto& p = *i;
+   const line3d& line = (p.second).first;
+   const pos3d& pos   = (p.second).second;
+   pos3d ppos = line.interpolate(line.project(pos));
+   double dmin = pos.dist(ppos);
+   return dmin/line.length();
+}
+
+double halfedge_mesh::face_aspect_ratio(id_face iface) const
+{
+   id_vertex iv1,iv2,iv3;
+   triangle(iface,iv1,iv2,iv3,"face_aspect_ratio");
+   return face_aspect_ratio(iv1,iv2,iv3);
+}
+
+vec3d halfedge_mesh::face_normal(id_vertex iv1, id_vertex iv2, id_vertex iv3) const
+{
+   vec3d v1(m_vert[iv1],m_vert[iv2]);
+   vec3d v2(m_vert[iv1],m_vert[iv3]);
+   vec3d norm = v1.cross(v2);
+   norm.normalise();
+   return norm;
+}
+
+vec3d halfedge_mesh::face_normal(id_face iface) const
+{
+   id_vertex iv1,iv2,iv3;
+   triangle(iface,iv1,iv2,iv3,"face_normal");
+   return face_normal(iv1,iv2,iv3);
+}
@@ -0,0 +1,201 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef HALFEDGE_MESH_H
+#define HALFEDGE_MESH_H
+
+#include "polyhealer_config.h"
+
+#include "spacemath/polyhedron3d.h"
+#include "spacemath/vec3d.h"
+using namespace spacemath;
+
+#include <memory>
+#include <vector>
+
+// halfedge_mesh is an array based half-edge representation of a polyhedron surface, intended for
+// algorithms that modify the mesh topology. Vertices, half-edges and faces are stored in flat vectors
+// and referred to by index. Removed elements are put on free-lists and reused by later insertions,
+// so the indices of the remaining elements stay valid while the mesh is modified.
+//
+// Each face owns a cycle of half-edges linked by next(). All half-edges using the same undirected edge
+// are linked in a cyclic list by opposite(): for a 2-manifold edge opposite() is the twin half-edge,
+// for a free edge it is the half-edge itself, and for a non-manifold edge the list visits every use of the edge.
+// Since half-edges are paired on undirected edges, inconsistently oriented faces are allowed.
+// Faces are normally triangles, but general polygons are supported by the basic traversal functions.
+
+class POLYHEALER_PUBLIC halfedge_mesh {
+public:
+   typedef size_t id_halfedge;
+   static const size_t npos = static_cast<size_t>(-1);
+
+   halfedge_mesh(const std::shared_ptr<polyhedron3d> poly);
+   virtual ~halfedge_mesh();
+
+   // update the input polyhedron to match the current mesh
+   // vertices and faces are compacted, keeping their relative order
+   std::shared_ptr<polyhedron3d> update_input();
+
+   // clear all mesh data, except input polyhedron
+   void clear();
+
+
+   // === VERTICES
+   // ------------
+
+   // vertex indices are in the range [0,vertex_capacity()), removed vertices are not valid
+   inline size_t       vertex_capacity() const            { return m_vert.size(); }
+   inline size_t       vertex_size() const                { return m_vert.size() - m_vert_free.size(); }
+   inline bool         vertex_valid(id_vertex iv) const   { return m_vert_valid[iv] != 0; }
+   inline const pos3d& vertex(id_vertex iv) const         { return m_vert[iv]; }
+
+   // add vertex to mesh, a previously removed vertex index may be reused
+   id_vertex add_vertex(const pos3d& pos);
+
+   // remove vertex
+   // Note: it is assumed that the vertex being removed is unreferenced, no checking is done
+   void remove_vertex(id_vertex iv);
+
+
+   // === FACES
+   // ---------
+
+   // face indices are in the range [0,face_capacity()), removed faces are not valid
+   inline size_t       face_capacity() const              { return m_face.size(); }
+   inline size_t       face_size() const                  { return m_face.size() - m_face_free.size(); }
+   inline bool         face_valid(id_face iface) const    { return m_face[iface] != npos; }
+
+   // first half-edge of face
+   inline id_halfedge  face_halfedge(id_face iface) const { return m_face[iface]; }
+
+   // return the face vertices
+   pface face(id_face iface) const;
+
+   // add face to mesh, a previously removed face index may be reused
+   id_face add_face(id_vertex iv1, id_vertex iv2, id_vertex iv3);
+   id_face add_face(const pface& face);
+
+   // remove face and its half-edges
+   void remove_face(id_face iface);
+
+   // reverse the orientation of face
+   void face_flip(id_face iface);
+
+
+   // === HALF-EDGES
+   // --------------
+
+   inline size_t       halfedge_capacity() const              { return m_he.size(); }
+   inline bool         halfedge_valid(id_halfedge ih) const   { return m_he[ih].face != npos; }
+
+   // the half-edge runs from origin to target, in the face direction
+   inline id_vertex    origin(id_halfedge ih) const           { return m_he[ih].vert; }
+   inline id_vertex    target(id_halfedge ih) const           { return m_he[m_he[ih].next].vert; }
+   inline id_face      halfedge_face(id_halfedge ih) const    { return m_he[ih].face; }
+   inline id_halfedge  next(id_halfedge ih) const             { return m_he[ih].next; }
+   id_halfedge         prev(id_halfedge ih) const;
+
+   // next half-edge on the same edge, ih itself for a free edge
+   inline id_halfedge  opposite(id_halfedge ih) const         { return m_he[ih].opposite; }
+
+   // edge identifier, as computed by polyhedron3d::EDGE
+   inline id_edge      edge(id_halfedge ih) const             { return polyhedron3d::EDGE(origin(ih),target(ih)); }
+
+   // number of faces using the edge of ih
+   size_t              edge_use_count(id_halfedge ih) const;
+
+   // true if ih is the lowest numbered half-edge on its edge. Used for visiting each edge once
+   bool                edge_leader(id_halfedge ih) const;
+
+   // for a triangle, return vertex opposite to the edge of ih. Throws if the face of ih is not a triangle
+   id_vertex           opposite_vertex(id_halfedge ih) const;
+
+   // return any half-edge on the edge between iv0 and iv1, or npos if there is no such edge
+   id_halfedge         find_halfedge(id_vertex iv0, id_vertex iv1) const;
+
+   // replace the edge of ih by the edge between the opposite vertices of its 2 faces.
+   // The faces and half-edges are reused. Returns false with no change unless the edge
+   // is 2-manifold between consistently oriented triangles and the new edge does not already exist
+   bool                flip_edge(id_halfedge ih);
+
+
+   // ==== COMPUTE PROPERTIES
+   // -----------------------
+
+   // compute edge length from 2 vertices
+   double edge_length(id_vertex iv1, id_vertex iv2) const;
+
+   // compute edge length of half-edge
+   double edge_length(id_halfedge ih) const;
+
+   // compute area from 3 vertices
+   double face_area(id_vertex iv1, id_vertex iv2, id_vertex iv3) const;
+
+   // compute area of triangle face
+   double face_area(id_face iface) const;
+
+   // compute face aspect ratio from 3 vertices
+   double face_aspect_ratio(id_vertex iv1, id_vertex iv2, id_vertex iv3) const;
+
+   // compute aspect ratio of triangle face
+   double face_aspect_ratio(id_face iface) const;
+
+   // compute normalised normal from 3 vertices in assumed face order
+   vec3d  face_normal(id_vertex iv1, id_vertex iv2, id_vertex iv3) const;
+
+   // compute normalised normal of triangle face
+   vec3d  face_normal(id_face iface) const;
+
+protected:
+   // initialize the mesh from the input polyhedron
+   void construct();
+
+   // return the 3 vertices of a triangle face, throw if not a triangle
+   void triangle(id_face iface, id_vertex& iv1, id_vertex& iv2, id_vertex& iv3, const char* caller) const;
+
+   // link/unlink half-edge in the opposite() list of its edge
+   void link_edge(id_halfedge ih);
+   void unlink_edge(id_halfedge ih);
+
+   // link/unlink half-edge in the edge list of its lowest vertex, used by find_halfedge
+   void link_vertex(id_halfedge ih);
+   void unlink_vertex(id_halfedge ih);
+
+   id_halfedge new_halfedge();
+
+private:
+   struct halfedge {
+      id_vertex   vert;      // origin vertex
+      id_halfedge next;      // next half-edge in face
+      id_halfedge opposite;  // next half-edge on same edge
+      id_halfedge vlink;     // next half-edge in the edge list of the lowest edge vertex
+      id_face     face;      // owning face, npos when removed
+   };
+
+   std::shared_ptr<polyhedron3d>  m_poly;         // original polyhedron
+
+   vtx_vec                        m_vert;         // vertex positions
+   std::vector<char>              m_vert_valid;   // 0 for removed vertices
+   std::vector<id_halfedge>       m_vert_he;      // first half-edge in the edge list of each vertex
+   std::vector<id_vertex>         m_vert_free;    // removed vertices
+
+   std::vector<halfedge>          m_he;           // half-edges
+   std::vector<id_halfedge>       m_he_free;      // removed half-edges
+
+   std::vector<id_halfedge>       m_face;         // first half-edge of each face, npos when removed
+   std::vector<id_face>           m_face_free;    // removed faces
+};
+
+#endif // HALFEDGE_MESH_H
@@ -13,10 +13,27 @@
 // A PARTICULAR PURPOSE.
 // EndLicense:
 #include "lump_finder.h"
-#include <iostream>
-
-lump_finder::lump_finder(const std::shared_ptr<polyhedron3d> poly)
+#include "union_find.h"
+#include "spacemath/parallel_for.h"
+#include "spacemath/polyhedron_order.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// use of a vertex in a face: the face, the corner index in the flat corner array, and the next and previous face vertices
+struct vertex_use {
+   uint32_t face;
+   uint32_t corner;
+   uint32_t next;
+   uint32_t prev;
+};
+
+lump_finder::lump_finder(const std::shared_ptr<polyhedron3d> poly, bool reorder, connectivity conn)
 : m_poly(poly)
+, m_reorder(reorder)
+, m_conn(conn)
 {}
 
 lump_finder::~lump_finder()
@@ -24,110 +41,117 @@ lump_finder::~lump_finder()
 
 std::shared_ptr<ph3d_vector> lump_finder::find_lumps()
 {
-   // create a set of all faces
-   face_set all_faces;
-   for(auto i=m_poly.face_begin(); i!=m_poly.face_end(); i++) all_faces.insert(i->first);
-
-   // the actual lumps to be created
-   lump_map lumps;
-
-   size_t id_lump = 0;
-   while(all_faces.size() > 0) {
-
-      // start a new lump
-      face_set& lump_faces = lumps[id_lump++];
-
-      // our set of faces not yet processed
-      face_set  todo_faces;
-
-      // pick a face to start from, and repeat as long as more faces to do
-      todo_faces.insert(*all_faces.begin());
-
-      while(todo_faces.size() > 0) {
-
-         // transfer next face from todo_faces to lump_faces
-         id_face face_id = *todo_faces.begin();
-         todo_faces.erase(face_id);
-         lump_faces.insert(face_id);
+   const polyhedron3d& poly = *m_poly;
+   size_t nface = poly.face_size();
+   size_t nvert = poly.vertex_size();
 
-         // look up face neigbours to this face (face_id)
-         face_set neighbour_faces = m_poly.get_face_neighbour_faces(face_id);
+   std::shared_ptr<ph3d_vector> polyset(new ph3d_vector);
+   if(nface == 0) return polyset;
+
+   // offset of each face in the flat corner arrays
+   std::vector<size_t> face_offset(nface+1,0);
+   for(id_face iface=0; iface<nface; iface++) face_offset[iface+1] = face_offset[iface] + poly.face(iface).size();
+   size_t ncorner = face_offset[nface];
+   if(std::max(ncorner,nvert) >= std::numeric_limits<uint32_t>::max()) {
+      throw std::logic_error("lump_finder::find_lumps(...) too many face corners or vertices: " + std::to_string(std::max(ncorner,nvert)));
+   }
 
-         // collect only previously unseen neighbour faces in todo_faces
-         for(id_face neighbour_face : neighbour_faces) {
-            if(lump_faces.find(neighbour_face) == lump_faces.end()) {
-               todo_faces.insert(neighbour_face);
-            }
+   // face corners using each vertex, in increasing face order: vert_use[vert_offset[iv]] to vert_use[vert_offset[iv+1]-1].
+   // The neighbour vertices in the face are stored with each use, so edges can be matched without visiting the faces
+   std::vector<size_t> vert_offset(nvert+1,0);
+   for(id_face iface=0; iface<nface; iface++) {
+      for(id_vertex iv : poly.face(iface)) vert_offset[iv+1]++;
+   }
+   for(id_vertex iv=0; iv<nvert; iv++) vert_offset[iv+1] += vert_offset[iv];
+   std::vector<vertex_use> vert_use(ncorner);
+   {
+      std::vector<size_t> next(vert_offset.begin(),vert_offset.end()-1);
+      size_t icorner = 0;
+      for(id_face iface=0; iface<nface; iface++) {
+         const pface& face = poly.face(iface);
+         size_t n = face.size();
+         for(size_t k=0; k<n; k++) {
+            vert_use[next[face[k]]++] = vertex_use{uint32_t(iface),uint32_t(icorner++),uint32_t(face[(k+1)%n]),uint32_t(face[(k+n-1)%n])};
          }
       }
-
-      // we now have all faces in this lump, remove them from all_faces.
-      // The remaining faces in all_faces (if any) belong to other lumps
-      for(id_face iface : lump_faces) {
-         all_faces.erase(iface);
-      }
    }
 
-   // we have sorted all faces in lumps, create a new polyset with a polyhedron for each lump
-   std::shared_ptr<ph3d_vector> polyset(new ph3d_vector);
-   polyset->reserve(lumps.size());
-
-   for(auto& p : lumps) {
-
-      // the set of faces in the lump
-      face_set& faces = p.second;
-
-      // first collect the vertices in use by this lump
-      vertex_set vtx_lump;
-      for(id_face iface : faces) {
-         const pface& face = m_poly.face(iface);
-         for(id_vertex iv=0;iv<face.size();iv++) vtx_lump.insert(face[iv]);
-      }
-
-      // create a vector: iv_new = new_vert[iv_old]
-      // where iv_new=-1 for unused vertices
-
-      size_t nv=m_poly.vertex_size();
-      std::vector<int> new_vert(nv,-1);
-      int iv_new = 0;
-      for(id_vertex iv_old : vtx_lump) {
-         new_vert[iv_old] = iv_new++;
-      }
-
-      // create the new and smaller vertex vector with only used vertices
-      vtx_vec vert(vtx_lump.size());
-      for(id_vertex iv_old=0; iv_old<nv; iv_old++) {
-          int iv_new = new_vert[iv_old];
-          if(iv_new >= 0) {
-             vert[iv_new] = m_poly.vertex(iv_old);
-          }
+   // union-find over the faces. Faces using the same vertex are joined, or when connecting through edges
+   // only those also sharing a neighbour vertex: the uses of each vertex are listed once per neighbour,
+   // sorted by neighbour and each run of equal neighbours (one edge) is joined. Roots are always the
+   // lowest face, so the lumps are labelled in order of their lowest face
+   union_find lumps(nface);
+   const bool conn_edge = (m_conn == by_edge);
+   parallel_for(nvert,0,1<<14,[&vert_offset,&vert_use,&lumps,conn_edge](size_t first, size_t last) {
+      std::vector<std::pair<uint32_t,uint32_t>> edge_face;  // (neighbour vertex, face)
+      for(id_vertex iv=first; iv<last; iv++) {
+         const vertex_use* use_begin = vert_use.data() + vert_offset[iv];
+         const vertex_use* use_end   = vert_use.data() + vert_offset[iv+1];
+         if(!conn_edge) {
+            for(const vertex_use* u=use_begin; u<use_end; u++) lumps.unite(use_begin->face,u->face);
+            continue;
+         }
+         edge_face.clear();
+         for(const vertex_use* u=use_begin; u<use_end; u++) {
+            edge_face.push_back(std::make_pair(u->next,u->face));
+            edge_face.push_back(std::make_pair(u->prev,u->face));
+         }
+         std::sort(edge_face.begin(),edge_face.end());
+         for(size_t i=1; i<edge_face.size(); i++) {
+            if(edge_face[i].first == edge_face[i-1].first) lumps.unite(edge_face[i-1].second,edge_face[i].second);
+         }
       }
+   });
+   std::vector<uint32_t> face_lump;
+   size_t nlump = lumps.label(face_lump);
+
+   // faces of each lump in original order: lump_face[lump_face_start[ilump]] to lump_face[lump_face_start[ilump+1]-1]
+   std::vector<size_t> lump_face_start(nlump+1,0);
+   for(uint32_t ilump : face_lump) lump_face_start[ilump+1]++;
+   for(size_t ilump=0; ilump<nlump; ilump++) lump_face_start[ilump+1] += lump_face_start[ilump];
+   std::vector<uint32_t> lump_face(nface);
+   {
+      std::vector<size_t> next(lump_face_start.begin(),lump_face_start.end()-1);
+      for(id_face iface=0; iface<nface; iface++) lump_face[next[face_lump[iface]]++] = uint32_t(iface);
+   }
 
-      // create polyhedron faces with renumbered indices
-      // there is no need to check for unused vertices here
-
-      // number of faces in this lump
-      size_t nface = faces.size();
-      pface_vec new_faces(nface);
-
-      // face_counter counts the new faces
-      size_t face_counter = 0;
-      for(id_face iface : faces) {
-
-         // iface is the old face number
-         const pface& face_old = m_poly.face(iface);
-         pface& face_new = new_faces[face_counter++];
-         face_new.reserve(face_old.size());
-         size_t nv = face_old.size();
-         for(size_t iv=0; iv<nv; iv++) {
-            size_t iv_old = face_old[iv];      // old vertex
-            size_t iv_new = new_vert[iv_old];  // corresponding new vertex
-            face_new.push_back(iv_new);
+   // number the vertices of each lump in original vertex order, and record the new vertex of each corner.
+   // A vertex is normally used by one lump only, but lumps connected through edges may share vertices
+   std::vector<vtx_vec>  vert(nlump);
+   std::vector<uint32_t> corner_vert(ncorner);
+   std::vector<uint32_t> vert_lumps;
+   for(id_vertex iv=0; iv<nvert; iv++) {
+      vert_lumps.clear();
+      for(size_t i=vert_offset[iv]; i<vert_offset[iv+1]; i++) {
+         const vertex_use& use = vert_use[i];
+         uint32_t ilump = face_lump[use.face];
+         size_t   l     = 0;
+         while(l<vert_lumps.size() && vert_lumps[l]!=ilump) l++;
+         if(l == vert_lumps.size()) {
+            vert_lumps.push_back(ilump);
+            vert[ilump].push_back(poly.vertex(iv));
          }
+         corner_vert[use.corner] = uint32_t(vert[ilump].size()-1);
+      }
+   }
+   std::vector<vertex_use>().swap(vert_use);
+
+   // scatter the renumbered faces into all lumps concurrently
+   std::vector<pface_vec> faces(nlump);
+   for(size_t ilump=0; ilump<nlump; ilump++) faces[ilump].resize(lump_face_start[ilump+1] - lump_face_start[ilump]);
+   parallel_for(nface,0,1<<14,[&](size_t first, size_t last) {
+      for(size_t i=first; i<last; i++) {
+         id_face iface = lump_face[i];
+         size_t  ilump = face_lump[iface];
+         faces[ilump][i - lump_face_start[ilump]].assign(corner_vert.begin()+face_offset[iface],corner_vert.begin()+face_offset[iface+1]);
       }
+   });
 
-      // create the polyhedron for this lump and push to polyset vector
-      polyset->push_back(std::shared_ptr<polyhedron3d>(new polyhedron3d(vert,new_faces)));
+   // create the polyhedron for each lump
+   polyset->reserve(nlump);
+   for(size_t ilump=0; ilump<nlump; ilump++) {
+      polyset->push_back(std::make_shared<polyhedron3d>(std::move(vert[ilump]),std::move(faces[ilump])));
+      if(m_reorder) reorder_polyhedron(*polyset->back());
    }
 
    return polyset;
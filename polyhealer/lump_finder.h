@@ -15,16 +15,17 @@
 #ifndef LUMP_FINDER_H
 #define LUMP_FINDER_H
 
+#include "polyhealer_config.h"
+
 #include "spacemath/polyhedron3d.h"
 #include <memory>
-#include <utility>  // std::pair
-#include <unordered_map>
-#include <unordered_set>
-#include <set>
-
-#include "mutable_polyhedron3d.h"
+#include <vector>
+using namespace spacemath;
 
-// lump_finder takes a healed polyhedron and analyses whether it consists of separate, disconnected lumps
+// lump_finder takes a healed polyhedron and analyses whether it consists of separate, disconnected lumps.
+// Faces are labelled by a parallel union-find over the faces sharing each edge (or vertex), using a flat
+// table of vertex uses. All lumps are then built together, with the renumbered faces scattered in parallel.
+// Lumps are numbered in order of their lowest face, and keep the original face and vertex order.
 
 class POLYHEALER_PUBLIC lump_finder {
 public:
@@ -32,17 +33,20 @@ public:
    // various topological identifiers
    typedef size_t  id_lump;
 
-   typedef std::set<id_vertex>                    vertex_set;     // a sorted set of vertices
-   typedef std::unordered_map<id_lump, face_set>  lump_map;       // faces in a lump
+   // how faces are connected within a lump: through shared edges, or through shared vertices
+   enum connectivity { by_edge, by_vertex };
 
-   lump_finder(const std::shared_ptr<polyhedron3d>  poly);
+   // when reorder is true, each lump returned is reordered for cache locality, see spacemath::reorder_polyhedron
+   lump_finder(const std::shared_ptr<polyhedron3d>  poly, bool reorder = false, connectivity conn = by_edge);
    virtual ~lump_finder();
 
    // return the polyhedron split into lumps
    std::shared_ptr<ph3d_vector> find_lumps();
 
 private:
-   mutable_polyhedron3d  m_poly;
+   std::shared_ptr<polyhedron3d> m_poly;
+   bool                          m_reorder;  // reorder the lumps returned
+   connectivity                  m_conn;     // how faces are connected
 };
 
 #endif // LUMP_FINDER_H
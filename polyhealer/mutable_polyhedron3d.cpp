@@ -14,6 +14,7 @@
 // EndLicense:
 #include "mutable_polyhedron3d.h"
 #include "spacemath/line3d.h"
+#include "spacemath/parallel_for.h"
 #include <stdexcept>
 
 mutable_polyhedron3d::mutable_polyhedron3d(const std::shared_ptr<polyhedron3d> poly)
@@ -41,47 +42,65 @@ void mutable_polyhedron3d::clear()
 
 void mutable_polyhedron3d::construct()
 {
-   // basic data as maps
-   size_t nvert = m_poly->vertex_size();
-   for(size_t i=0;i<nvert; i++) m_vert[i] = m_poly->vertex(i);
-
-   size_t nface = m_poly->face_size();
-   for(size_t i=0;i<nface; i++) m_face[i] = m_poly->face(i);
-   m_face_counter = m_face.size();
-
-   // extended data
-   m_edge_faces = construct_edge_faces();
-   m_edge_vert  = construct_edge_vertices();
-
-   // face_edges = inverse of edge_faces
-   for(auto& p: m_edge_faces) {
-      id_edge          edge = p.first;
-      const face_set& faces = p.second;
-      for(auto face : faces) {
-         m_face_edges[face].insert(edge);
+   // the edge table is built in parallel, and shared with other users of the input polyhedron when it is cached
+   std::shared_ptr<const edge_table> edges = m_poly->edges();
+
+   // the maps are independent of each other, so they are filled concurrently
+   const polyhedron3d& poly = *m_poly;
+   size_t nvert = poly.vertex_size();
+   size_t nface = poly.face_size();
+   parallel_tasks(5,0,[this,&poly,&edges,nvert,nface](size_t itask) {
+      switch(itask) {
+
+         // basic data as maps
+         case 0: {
+            for(size_t i=0;i<nvert; i++) m_vert.emplace_hint(m_vert.end(),i,poly.vertex(i));
+            break;
+         }
+         case 1: {
+            m_face.reserve(nface);
+            for(size_t i=0;i<nface; i++) m_face[i] = m_poly->face(i);
+            break;
+         }
+
+         // extended data
+         case 2: {
+            m_edge_faces = construct_edge_faces(*edges);
+            break;
+         }
+         case 3: {
+            m_edge_vert  = construct_edge_vertices(*edges);
+            break;
+         }
+         case 4: {
+            // face_edges = inverse of edge_faces
+            m_face_edges.reserve(nface);
+            for(size_t iface=0; iface<nface; iface++) {
+               edge_set& face_edges = m_face_edges[iface];
+               size_t nedge = m_poly->face(iface).size();
+               for(size_t iedge=0; iedge<nedge; iedge++) {
+                  face_edges.insert(edges->edge(edges->face_edge(iface,iedge)));
+               }
+            }
+            break;
+         }
       }
-   }
+   });
+   m_face_counter = nface;
 }
 
 
 edge_face_map mutable_polyhedron3d::construct_edge_faces()
 {
-   edge_face_map edge_faces;
-
-   size_t nface = m_poly->face_size();
-   for(size_t iface=0; iface<nface; iface++) {
-
-      const pface& face = m_poly->face(iface);
+   return construct_edge_faces(*m_poly->edges());
+}
 
-      // number of edges == number of vertices
-      size_t nedge     = face.size();
-      size_t last_edge = nedge-1;
-      for(size_t iedge=0; iedge<nedge; iedge++) {
-         id_vertex   iv0 = face[iedge];
-         id_vertex   iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         id_edge edge_id =  m_poly->EDGE(iv0,iv1);
-         edge_faces[edge_id].insert(iface);
-      }
+edge_face_map mutable_polyhedron3d::construct_edge_faces(const edge_table& edges)
+{
+   edge_face_map edge_faces;
+   edge_faces.reserve(edges.size());
+   for(size_t ie=0; ie<edges.size(); ie++) {
+      edge_faces[edges.edge(ie)] = face_set(edges.face_begin(ie),edges.face_end(ie));
    }
 
    return std::move(edge_faces);
@@ -89,48 +108,24 @@ edge_face_map mutable_polyhedron3d::construct_edge_faces()
 
 edge_vertex_map mutable_polyhedron3d::construct_edge_vertices()
 {
-   edge_vertex_map edges;
-   size_t nface =  m_poly->face_size();
-   for(id_face iface=0; iface<nface; iface++) {
-
-      const pface& face =  m_poly->face(iface);
-
-      // number of edges == number of vertices
-      size_t nedge     = face.size();
-      size_t last_edge = nedge-1;
-      for(size_t iedge=0; iedge<nedge; iedge++) {
-         id_vertex iv0 = face[iedge];
-         id_vertex iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         id_edge  edge = m_poly->EDGE(iv0,iv1);
-         edges[edge]   = m_poly->VERTEX_PAIR(iv0,iv1);
-      }
+   return construct_edge_vertices(*m_poly->edges());
+}
+
+edge_vertex_map mutable_polyhedron3d::construct_edge_vertices(const edge_table& edges)
+{
+   edge_vertex_map edge_vert;
+   edge_vert.reserve(edges.size());
+   for(size_t ie=0; ie<edges.size(); ie++) {
+      edge_vert[edges.edge(ie)] = edges.edge_vertices(ie);
    }
 
-   return std::move(edges);
+   return std::move(edge_vert);
 }
 
 edge_count_map mutable_polyhedron3d::construct_edge_use_count()
 {
    // perform edge use count
-   edge_count_map edge_count;
-   size_t nface = m_poly->face_size();
-   for(size_t iface=0; iface<nface; iface++) {
-
-      const pface& face = m_poly->face(iface);
-
-      // count edges
-      // number of edges == number of vertices
-      size_t nedge     = face.size();
-      size_t last_edge = nedge-1;
-      for(size_t iedge=0; iedge<nedge; iedge++) {
-         id_vertex   iv0 = face[iedge];
-         id_vertex   iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         id_edge edge_id = m_poly->EDGE(iv0,iv1);
-         edge_count[edge_id]++;
-      }
-   }
-
-   return std::move(edge_count);
+   return m_poly->edges()->use_count_map();
 }
 
 
@@ -19,6 +19,7 @@
 
 #include "spacemath/polyhedron3d.h"
 #include "spacemath/vec3d.h"
+#include "spacemath/edge_table.h"
 using namespace spacemath;
 
 #include <map>
@@ -150,6 +151,10 @@ public:
    edge_face_map   construct_edge_faces();
    edge_vertex_map construct_edge_vertices();
 
+   // same as above, from an already built edge table
+   static edge_face_map   construct_edge_faces(const edge_table& edges);
+   static edge_vertex_map construct_edge_vertices(const edge_table& edges);
+
 protected:
 
    // initialize all data structures belonging to
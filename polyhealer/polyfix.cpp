@@ -15,18 +15,17 @@
 #include "polyfix.h"
 #include <map>
 #include <unordered_map>
-#include <unordered_set>
-#include <set>
 #include <string>
 #include <sstream>
 #include <algorithm>
 #include <limits>
+#include <utility>
 #include <sstream>
 
-#include "multimap_pos3d.h"
+#include "vertex_welder.h"
+#include "spacemath/parallel_for.h"
 #include "spacemath/polygon3d.h"
-
-#include "mutable_polyhedron3d.h"
+#include "spacemath/edge_table.h"
 
 polyfix::polyfix(const std::shared_ptr<polyhedron3d> poly, double dtol, double atol, bool verbose)
 : m_poly(poly)
@@ -40,42 +39,39 @@ polyfix::~polyfix()
 
 size_t polyfix::remove_unused_vertices()
 {
-   mutable_polyhedron3d poly(m_poly);
-
-   // we use a map to maintain the original vertex order
-   typedef std::map<size_t,int> lookup_map;
-
-   // vtx_use : <vertex,usecount>
-   lookup_map vtx_use;
-
-   // execute vertex use count, count faces too
-   size_t nface = 0;
-   for(auto i=poly.face_begin(); i!=poly.face_end(); i++) {
-      nface++;
-      const pface& face = i->second;
-      size_t nv = face.size();
-      for(size_t iv=0; iv<nv; iv++) {
-         vtx_use[face[iv]]++;
-      }
+   // flag the vertices referenced by faces
+   size_t nvert = m_poly->vertex_size();
+   size_t nface = m_poly->face_size();
+   vector<char> vtx_used(nvert,0);
+   for(size_t iface=0; iface<nface; iface++) {
+      const pface& face = m_poly->face(iface);
+      for(auto iv : face) vtx_used[iv] = 1;
    }
 
-   // the size of the use_count buffer will be less or equal to number of original vertices
-   size_t num_unused = poly.vertex_size() - vtx_use.size();
+   size_t num_used   = std::count(vtx_used.begin(),vtx_used.end(),1);
+   size_t num_unused = nvert - num_used;
 
    if(num_unused > 0) {
 
-      // build the set of unreferenced vertices to be removed
-      set<id_vertex> vtx_rem;
-      for(auto itv=poly.vertex_begin(); itv!=poly.vertex_end(); itv++) {
-         id_vertex iv = itv->first;
-         if(vtx_use.find(iv) == vtx_use.end()) vtx_rem.insert(iv);
+      // renumber the remaining vertices, maintaining the original vertex order
+      vector<id_vertex> new_vert(nvert);
+      vtx_vec vert;
+      vert.reserve(num_used);
+      for(size_t iv=0; iv<nvert; iv++) {
+         if(vtx_used[iv]) {
+            new_vert[iv] = vert.size();
+            vert.push_back(m_poly->vertex(iv));
+         }
       }
 
-      for(auto iv : vtx_rem) {
-         poly.remove_vertex(iv);
+      pface_vec faces(nface);
+      for(size_t iface=0; iface<nface; iface++) {
+         pface& face = faces[iface];
+         face = m_poly->face(iface);
+         for(auto& iv : face) iv = new_vert[iv];
       }
 
-      m_poly = poly.update_input();
+      m_poly->assign(vert,faces);
    }
 
    return num_unused;
@@ -84,187 +80,57 @@ size_t polyfix::remove_unused_vertices()
 
 std::pair<size_t,size_t> polyfix::merge_vertices()
 {
-   size_t num_removed_vertices = 0;
-   size_t num_removed_faces = 0;
-
-   typedef std::set<size_t>                            vtx_cluster;       // cluster of matching vertices (contains sorted vertex indices)
-   typedef std::unordered_map<std::string,vtx_cluster> vtx_cluster_map;   // map of vertex clusters
-   typedef std::unordered_map<std::string,pos3d>       vtx_cluster_pos;   // map of vertex cluster positions
-   typedef std::vector<string>                         vtx_cluster_keys;  // vector of cluster keys, vector index is original vertex index
-   typedef std::unordered_map<std::string,size_t>      vtx_cluster_idx;   // assigned new vertex index for each cluster
-   typedef std::map<size_t,size_t>                     vtx_idx_map;       // <index_old,index_new> ,  index_new = vtx_idx_map[index_old]
-
-
-   // build the vertex multimap, keyed by coordinates
-   multimap_pos3d<size_t>  mmpos;
-   mmpos.setTolerance(m_dtol);
-   size_t nv=m_poly->vertex_size();
-   for(size_t i=0;i<nv; i++) {
-      mmpos.insert(make_pair(m_poly->vertex(i),i));
-   }
-
-   // map of all vertex clusters found
-   vtx_cluster_map   cluster_map;
-   vtx_cluster_keys  cluster_keys(nv);  // set to blank keys for all
-
-   // post-process the vertices and get duplicates from mmpos to create clusters
-   for(size_t i=0;i<nv; i++) {
-
-      // get the vertex position
-      const pos3d& pos = m_poly->vertex(i);
-
-      // vertex cluster of matching vertices (zero based indices)
-      vtx_cluster cluster;
-      cluster.insert(i);
-
-      // get the range of candidate matches
-      auto range = mmpos.equal_key_range(pos);
-
-      // traverse the candidates, so far these are only in the same shell
-      for(auto it=range.begin(); it !=range.end(); it = range.next_match(it)) {
-
-         // get the candidate vertex index, process only if this is not a "self-match"
-         size_t iv_other = it->second.second;
-         if(i != iv_other) {
-
-            // get the distance to the candidate, it must be less or equal to tolerance
-            // to be classified as a match
-            double dist = pos.dist( m_poly->vertex(iv_other));
-            if(dist <= range.tol())  {
-
-               // ok, a match within tolerance
-               // add to cluster
-               cluster.insert(iv_other);
-            }
-         }
-      }
-
-      if(cluster.size() > 1) {
-
-         // this vertex was part of a cluster of matching vertices
-         // create the cluster lookup key
-         ostringstream out;
-         for(auto iv : cluster) out << '_' << iv;
-         string key = out.str();
-
-         // add to cluster map if not already there
-         if(cluster_map.find(key) == cluster_map.end()) {
-            cluster_map.insert(make_pair(key,cluster));
-            // set the key for the vertices in the cluster
-            for(auto iv : cluster) cluster_keys[iv] = key;
-         }
-      }
-
-   }
-
-   // all clusters have been computed
-   // compute cluster coordinates
-   vtx_cluster_pos cluster_pos;
-   for(auto& p : cluster_map) {
-      const string& key          = p.first;
-      const vtx_cluster& cluster = p.second;
-      pos3d cpos;
-      for(size_t iv : cluster) {
-         cpos += m_poly->vertex(iv);
-      }
-      cpos /= double(cluster.size());
-      cluster_pos.insert(std::make_pair(key,cpos));
-   }
-
-   // create the new and smaller vertex vector with only unique vertices plus cluster vertices
+   // compute the vertex clusters, remap[iv_old] = iv_new
+   std::vector<uint32_t> remap;
    vtx_vec vert;
-   vert.reserve(nv);
-
-   // this map records which clusters have been processed and their cooresponding vertex index
-   vtx_cluster_idx cluster_idx;
-   vtx_idx_map  new_vert;
-
-   // traverse original vertices
-   for(size_t iv=0; iv<nv; iv++) {
-
-       // first assign the original vertex position
-       pos3d pos = m_poly->vertex(iv);
-
-       // iv_new is the index in the new, reduced vertex vector
-       size_t iv_new = std::numeric_limits<size_t>::max();
-
-       // ckeck if part of cluster
-       const string& key = cluster_keys[iv];
-       if(key.length() > 0) {
-
-          // cluster vertex
-          auto it = cluster_idx.find(key);
-          if(it == cluster_idx.end()) {
-
-             // new cluster vertex, record the new vertex position
-             iv_new = vert.size();
-             vert.push_back(cluster_pos[key]);
-
-             // mark the cluster as processed
-             cluster_idx.insert(std::make_pair(key,iv_new));
-          }
-          else {
-             // previously seen cluster vertex
-             iv_new = it->second;
-          }
-       }
-       else {
-          // not a cluster vertex
-          iv_new = vert.size();
-          vert.push_back(pos);
-       }
-
-       // keep the mapping from old to new vertex
-       new_vert[iv] = iv_new;
-   }
-
-   // compute the number of removed vertices
-   num_removed_vertices = nv - vert.size();
+   vertex_welder welder(m_dtol);
+   size_t num_removed_vertices = welder.weld(*m_poly,remap,vert);
 
    // create polyhedron faces with renumbered indices
-   // and check for collapsed faces
+   // and check for collapsed faces. Each face is processed independently
    size_t nface = m_poly->face_size();
-   pface_vec faces;
-   faces.reserve(nface);
-
-   int num_zero = 0;
-
-   for(size_t iface=0; iface<nface; iface++) {
-
-      const pface& face_old = m_poly->face(iface);
-      pface face_new;
-      face_new.reserve(face_old.size());
-
-      set<size_t> face_verts;
-      size_t nv = face_old.size();
-      for(size_t iv=0; iv<nv; iv++) {
-         size_t iv_old = face_old[iv];
-         size_t iv_new = new_vert[iv_old];
-         face_new.push_back(iv_new);
-         face_verts.insert(iv_new);
-      }
-
-      // if the sizes below are not the same, it means that a vertex was repeated, i.e. collapsed face
-      // We simply skip collapsed faces
-      if(face_new.size() == face_verts.size()) {
+   pface_vec faces(nface);
+   std::vector<char> keep(nface,0);
+
+   parallel_for(nface,0,1<<12,[this,&remap,&vert,&faces,&keep](size_t first, size_t last) {
+      std::vector<pos3d> face_pos;
+      for(size_t iface=first; iface<last; iface++) {
+
+         const pface& face_old = m_poly->face(iface);
+         pface& face_new = faces[iface];
+         size_t nv = face_old.size();
+         face_new.resize(nv);
+         for(size_t iv=0; iv<nv; iv++) face_new[iv] = remap[face_old[iv]];
+
+         // if a vertex is repeated, the face is collapsed. We simply skip collapsed faces
+         bool collapsed = false;
+         for(size_t iv=0; iv<nv && !collapsed; iv++) {
+            for(size_t jv=iv+1; jv<nv; jv++) {
+               if(face_new[iv] == face_new[jv]) { collapsed = true; break; }
+            }
+         }
+         if(collapsed) continue;
 
          // check for sliver face (vertices on a straight line)
-         vector<pos3d> face_pos;
-         for(size_t iv=0; iv<face_new.size(); iv++) {
-            face_pos.push_back(vert[face_new[iv]]);
-         }
+         face_pos.clear();
+         for(size_t iv=0; iv<nv; iv++) face_pos.push_back(vert[face_new[iv]]);
          polygon3d poly_face(face_pos);
-         if(poly_face.area() > m_atol) {
-            faces.push_back(face_new);
-         }
-         else {
-            num_zero++; // for debugging, count number of zero area faces ignored
-         }
+         if(poly_face.area() > m_atol) keep[iface] = 1;
+      }
+   });
+
+   // compact the kept faces
+   size_t nkeep = 0;
+   for(size_t iface=0; iface<nface; iface++) {
+      if(keep[iface]) {
+         if(nkeep != iface) faces[nkeep].swap(faces[iface]);
+         nkeep++;
       }
    }
+   faces.resize(nkeep);
 
    // compute the number of removed faces
-   num_removed_faces = nface - faces.size();
+   size_t num_removed_faces = nface - nkeep;
 
    // finally assign the polyhedron
    m_poly->assign(vert,faces);
@@ -272,36 +138,88 @@ std::pair<size_t,size_t> polyfix::merge_vertices()
    return std::make_pair(num_removed_vertices,num_removed_faces);
 }
 
+// canonical key of a face with up to 4 distinct vertices: the sorted distinct vertex indices,
+// padded with face_key_pad. Faces with the same vertices in any order get the same key
+static const id_vertex face_key_pad = ~id_vertex(0);
+
+struct face_key {
+   id_vertex v[4];
+   size_t    iface;
+};
+
+inline bool operator<(const face_key& a, const face_key& b)
+{
+   for(size_t i=0; i<4; i++) {
+      if(a.v[i] != b.v[i]) return (a.v[i] < b.v[i]);
+   }
+   return (a.iface < b.iface);
+}
+
+inline bool same_vertices(const face_key& a, const face_key& b)
+{
+   return (a.v[0]==b.v[0]) && (a.v[1]==b.v[1]) && (a.v[2]==b.v[2]) && (a.v[3]==b.v[3]);
+}
+
 size_t  polyfix::remove_duplicate_faces()
 {
-   // execute face duplicate count
-   unordered_set<string> face_keys;
    size_t nface = m_poly->face_size();
 
-   // the new faces
-   pface_vec faces;
-   faces.reserve(nface);
+   // sorted distinct vertices of each face, faces with more than 4 distinct vertices are flagged as large
+   std::vector<face_key> keys(nface);
+   std::vector<char>     large(nface,0);
+   parallel_for(nface,0,1<<14,[this,&keys,&large](size_t first, size_t last) {
+      pface sorted_face;
+      for(size_t iface=first; iface<last; iface++) {
+         const pface& face = m_poly->face(iface);
+         sorted_face.assign(face.begin(),face.end());
+         std::sort(sorted_face.begin(),sorted_face.end());
+         sorted_face.erase(std::unique(sorted_face.begin(),sorted_face.end()),sorted_face.end());
+
+         face_key& key = keys[iface];
+         key.iface = iface;
+         if(sorted_face.size() > 4) {
+            large[iface] = 1;
+            continue;
+         }
+         for(size_t i=0; i<4; i++) key.v[i] = (i<sorted_face.size())? sorted_face[i] : face_key_pad;
+      }
+   });
 
+   // the polygons with more than 4 distinct vertices are compared as sorted vertex vectors.
+   // The face index is kept outside the vertex vector, so it only breaks ties between equal vertex sets
+   std::vector<std::pair<pface,size_t>> large_faces;
+   size_t nsmall = 0;
    for(size_t iface=0; iface<nface; iface++) {
-
-      const pface& face = m_poly->face(iface);
-      size_t nv = face.size();
-
-      // sort the vertex indices in increasing order
-      set<size_t> sorted_face;
-      for(size_t iv=0; iv<nv; iv++) {
-        sorted_face.insert(face[iv]);
+      if(large[iface]) {
+         pface sorted_face = m_poly->face(iface);
+         std::sort(sorted_face.begin(),sorted_face.end());
+         sorted_face.erase(std::unique(sorted_face.begin(),sorted_face.end()),sorted_face.end());
+         large_faces.push_back(std::make_pair(std::move(sorted_face),iface));
+      }
+      else {
+         keys[nsmall++] = keys[iface];
       }
+   }
+   keys.resize(nsmall);
 
-      ostringstream out;
-      for(auto iv : sorted_face) out << '_' << iv;
-      string key = out.str();
-      if(face_keys.find(key) == face_keys.end()) {
+   // after sorting, duplicates are adjacent and the first of them has the lowest face index
+   parallel_sort(keys.begin(),keys.end(),std::less<face_key>());
+   std::sort(large_faces.begin(),large_faces.end());
 
-         // face not seen before, so keep it
-         face_keys.insert(key);
-         faces.push_back(face);
-      }
+   // keep only the first face of each vertex set, i.e. the first occurrence in the input
+   std::vector<char> keep(nface,1);
+   for(size_t i=1; i<keys.size(); i++) {
+      if(same_vertices(keys[i],keys[i-1])) keep[keys[i].iface] = 0;
+   }
+   for(size_t i=1; i<large_faces.size(); i++) {
+      if(large_faces[i].first == large_faces[i-1].first) keep[large_faces[i].second] = 0;
+   }
+
+   // the new faces, in the original order
+   pface_vec faces;
+   faces.reserve(nface);
+   for(size_t iface=0; iface<nface; iface++) {
+      if(keep[iface]) faces.push_back(m_poly->face(iface));
    }
 
    // if any duplicates were found, faces.size() will be less than the original
@@ -317,8 +235,8 @@ size_t  polyfix::remove_duplicate_faces()
 
 std::pair<size_t,size_t> polyfix::remove_nonmanifold_or_zero_faces()
 {
-   // perform edge use count
-   edge_count_map edge_count = m_poly->construct_edge_use_count();
+   // perform edge use count, reusing the edge table if the polyhedron caches it
+   std::shared_ptr<const edge_table> edges = m_poly->edges();
 
    // the new faces
    size_t nface = m_poly->face_size();
@@ -335,12 +253,8 @@ std::pair<size_t,size_t> polyfix::remove_nonmanifold_or_zero_faces()
       // number of edges == number of vertices
       size_t nedge        = face.size();
       size_t nedge_nonman = 0;
-      size_t last_edge = nedge-1;
       for(size_t iedge=0; iedge<nedge; iedge++) {
-         size_t iv0 = face[iedge];
-         size_t iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         size_t edge_id = polyhedron3d::EDGE(iv0,iv1);
-         size_t edge_used = edge_count[edge_id];
+         size_t edge_used = edges->use_count(edges->face_edge(iface,iedge));
          if(edge_used != 2) {
             nedge_nonman++;
          }
@@ -391,18 +305,15 @@ double polyfix::area(size_t iface) const
    return poly_face.area();
 }
 
-list<string>  polyfix::check()
+std::list<std::string>  polyfix::check()
 {
-   edge_count_map edge_count;
-   std::unordered_multimap<size_t,size_t> edge_faces;
    size_t face_error=0;
 
-   list<string> warnings;
+   std::list<std::string> warnings;
 
    size_t nface = m_poly->face_size();
    if(nface==0) warnings.push_back("warning: no faces");
 
-
    for(size_t iface=0; iface<nface; iface++) {
 
       const pface& face = m_poly->face(iface);
@@ -416,63 +327,56 @@ list<string>  polyfix::check()
       // check face area error
       polygon3d poly_face(face_pos);
       if(!(poly_face.area()>m_atol))face_error++;
-
-      // count edges
-      // number of edges == number of vertices
-      size_t nedge     = face.size();
-      size_t last_edge = nedge-1;
-      for(size_t iedge=0; iedge<nedge; iedge++) {
-         size_t iv0 = face[iedge];
-         size_t iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         size_t edge_id = polyhedron3d::EDGE(iv0,iv1);
-         edge_count[edge_id]++;
-         edge_faces.insert(make_pair(edge_id,iface));
-      }
    }
 
+   // count edges, reusing the edge table if the polyhedron caches it
+   std::shared_ptr<const edge_table> edges = m_poly->edges();
+
    // count edge errors
-   map<size_t,size_t> uc_error;
-   for(auto i=edge_count.begin(); i!=edge_count.end(); i++) {
-      if(i->second != 2) {
-         uc_error[i->second]++;
-      }
-      else {
-         edge_faces.erase(i->first);
+   std::map<size_t,size_t> uc_error;
+   size_t nedge_error = 0;
+   for(size_t ie=0; ie<edges->size(); ie++) {
+      size_t edge_used = edges->use_count(ie);
+      if(edge_used != 2) {
+         uc_error[edge_used]++;
+         nedge_error++;
       }
    }
 
    if(face_error > 0) {
-      ostringstream out;
+      std::ostringstream out;
       out << "warning: "<< face_error << " zero area faces.";
       warnings.push_back(out.str());
    }
 
    if( uc_error.size() > 0) {
-      ostringstream out;
+      std::ostringstream out;
       out << "warning: nonmanifold edges: ";
       for(auto p : uc_error) { out << "uc("<<p.first <<")"<< '='<< p.second << ' '; }
       warnings.push_back(out.str());
 
       if(m_verbose) {
 
-         // more detailed messages
+         // more detailed messages, showing the first face of some nonmanifold edges
          size_t edge_counter=0;
-         for(auto& p  : edge_faces) {
+         for(size_t ie=0; ie<edges->size() && edge_counter<=6; ie++) {
+
+            size_t edge_used = edges->use_count(ie);
+            if(edge_used == 2) continue;
 
-            size_t iface = p.second;
+            size_t iface = *edges->face_begin(ie);
             const pface& face = m_poly->face(iface);
 
-            ostringstream out;
-            out << "    edge=" << p.first << " uc=" << edge_count[p.first] << " face=" << iface << ':';
+            std::ostringstream out;
+            out << "    edge=" << edges->edge(ie) << " uc=" << edge_used << " face=" << iface << ':';
             for(size_t iv=0; iv<face.size(); iv++) out << ' ' << face[iv];
             out << " area=" << area(iface);
             warnings.push_back(out.str());
-            if(edge_counter > 5)break;
             edge_counter++;
          }
-         size_t more_edges = edge_faces.size() - edge_counter;
+         size_t more_edges = nedge_error - edge_counter;
          if(more_edges > 0) {
-            ostringstream out;
+            std::ostringstream out;
             out << "    ... and " << more_edges << " more edges";
             warnings.push_back(out.str());
          }
@@ -15,66 +15,57 @@
 #include "polyflip.h"
 #include "spacemath/polygon3d.h"
 #include "spacemath/vec3d.h"
-#include "spacemath/line3d.h"
-#include "spacemath/plane3d.h"
+#include "spacemath/parallel_for.h"
 
-#include <set>
-#include <limits>
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 
-polyflip::polyflip(const std::shared_ptr<polyhedron3d> poly, double dtol, double atol)
+// number of seed faces casting rays when deciding the orientation of the body, an odd number avoids ties
+static const size_t num_seed_faces = 5;
+
+// number of faces sampled for the winding number orientation, and the offset of the sample points
+// from the face centroid relative to the square root of the face area
+static const size_t num_winding_faces = 1024;
+static const double winding_offset    = 1.0E-3;
+
+polyflip::polyflip(const std::shared_ptr<polyhedron3d> poly, double dtol, double atol, orientation_method method)
 : m_poly(poly)
 , m_dtol(dtol)
 , m_atol(atol)
+, m_method(method)
 {}
 
 polyflip::~polyflip()
 {}
 
-bool polyflip::p_in_triangle(const pos3d& p, const pos3d& a, const pos3d& b, const pos3d& c)
+void polyflip::build_bvh()
 {
-   // solution based on area coordinates
-   // see figure at http://math.stackexchange.com/questions/4322/check-whether-a-point-is-within-a-3d-triangle
-   // Note that the logic there is wrong
-
-   // we simply check whether the subtriangle areas add up to more than the whole triangle
-   // if yes, the point is outside
-
-   // a,b,c are triangle corners. p is the point to check.
-   // p must lie in the plane of abc
-
-   vec3d  ab(a,b);
-   vec3d  ac(a,c);
-   vec3d  ap(a,p);
-   vec3d  pb(p,b);
-   vec3d  pc(p,c);
-
-   // area of triangle abc
-   double area_abc = 0.5*ab.cross(ac).length();
-
-   // areas of subtriangles
-   double area_abp = 0.5*ab.cross(ap).length();
-   double area_pbc = 0.5*pb.cross(pc).length();
-   double area_apc = 0.5*ap.cross(ac).length();
-
-   // if the sum of subtriangle areas is greater than the abc triangle area, then the point is outside
-   double asum = area_abp+area_pbc+area_apc;
-   double diff = asum - area_abc;
-
-   // we must accept a small area tolerance here, exact zero is too strict
-   // Remember the difference can never be negative
-   if(diff > m_atol) return false;
-
-   // ok, point is inside triangle area
-   return true;
+   size_t nface = m_poly.face_capacity();
+   vtx_vec corners;
+   std::vector<size_t> tri_id;
+   corners.reserve(3*m_poly.face_size());
+   tri_id.reserve(m_poly.face_size());
+   for(id_face iface=0; iface<nface; iface++) {
+      if(!m_poly.face_valid(iface)) continue;
+
+      halfedge_mesh::id_halfedge ih1 = m_poly.face_halfedge(iface);
+      halfedge_mesh::id_halfedge ih2 = m_poly.next(ih1);
+      halfedge_mesh::id_halfedge ih3 = m_poly.next(ih2);
+      if(m_poly.next(ih3) != ih1) throw std::logic_error("polyflip::flip_faces(...) non-triangular face detected");
+
+      corners.push_back(m_poly.vertex(m_poly.origin(ih1)));
+      corners.push_back(m_poly.vertex(m_poly.origin(ih2)));
+      corners.push_back(m_poly.vertex(m_poly.origin(ih3)));
+      tri_id.push_back(iface);
+   }
+   m_bvh.build(corners,tri_id);
 }
 
-
 size_t polyflip::count_positive_intersections(id_face iface0)
 {
-   // select the first face and check its orientation
-   const pface& face = m_poly.face(iface0);
+   // select the face and check its orientation
+   const pface face = m_poly.face(iface0);
 
    // compute the face normal.  Returned vector is normalised
    std::vector<pos3d> face_pos;
@@ -88,143 +79,99 @@ size_t polyflip::count_positive_intersections(id_face iface0)
    vec3d normal;
    poly_face.area(normal);
 
-   // face normal as a line. Must use centroid as start point to be sure about proper intersections
+   // cast the face normal as a ray. Must use centroid as start point to be sure about proper intersections
    centroid /= double(face.size());
-   line3d normal_line(centroid,centroid+normal);
+   std::vector<triangle_bvh::ray_hit> hits;
+   m_bvh.intersect(centroid,normal,hits,iface0);
 
    // intersections contains all intersection distances found along the face normal
-   std::set<double> intersections;
-
-   // Count face intersections in forward direction
-   for(auto i=m_poly.face_begin(); i!=m_poly.face_end(); i++) {
-
-      id_face iface = i->first;
-
-      // guard against self-intersection
-      if(iface != iface0) {
-
-         const pface& face = m_poly.face(iface);
-         if(face.size() != 3) throw std::logic_error("polyflip::flip_faces(...) non-triangular face detected");
-
-         // compute plane equation for the face triangle
-         const pos3d& p1 = m_poly.vertex(face[0]);
-         const pos3d& p2 = m_poly.vertex(face[1]);
-         const pos3d& p3 = m_poly.vertex(face[2]);
-         plane3d face_plane(p1,p2,p3);
-
-         // compute intersection with normal_line and face plane.
-         double line_par=-1.0;  // line_par [0.0,1.0] correspond to line [end1,end2]
-         if(face_plane.intersect(normal_line,line_par)){
-
-            // plane and line were non-parallel
-            // we are only interested in intersections in the positive normal direction
-            if((std::isfinite(line_par)) &&  (line_par>0.0) ) {
-
-               // the plane intersection point is on the positive side of iface0,
-               // but is it within the area of the current triangle face being checked?
-               pos3d p = normal_line.interpolate(line_par);
-               if(p_in_triangle(p,p1,p2,p3)) {
-
-                  // yes, the intersection hit inside the triangle area or exactly on the border,
-                  // therefore this is a real intersection.
-                  // Record the distance from iface0, measured along the iface0 normal
-                  intersections.insert(normal_line.end1().dist(p));
-               }
-            }
-         }
-      }
-
-   } // next face in polyhedron
+   std::vector<double> intersections;
+   intersections.reserve(hits.size());
+   double len = normal.length();
+   for(auto& hit : hits) intersections.push_back(hit.t*len);
+   std::sort(intersections.begin(),intersections.end());
 
    // filter any intersections that may be too close to each other
    // this is to guard against small numerical differences in intersections
    // computed on 2 neighbouring faces (on border)
-   std::set<double> tolerant_intersections;
+   size_t num_intersections = 0;
    double dist_prev = -1.0;
    for(double dist : intersections) {
       if( (dist-dist_prev) >= m_dtol) {
-         tolerant_intersections.insert(dist);
+         num_intersections++;
          dist_prev = dist;
       }
    }
 
    // finally we have the real number of intersections
-   return tolerant_intersections.size();
+   return num_intersections;
 }
 
 size_t polyflip::flip_faces()
 {
    size_t nflip = 0;
-   // determine the normal orientation of the 1st polyhedron face
-   // if the number of intersections is an even number (including zero), the normal is pointing outwards
 
-   id_face iface0 = 0;
-   size_t nint = count_positive_intersections(iface0);
-   if(nint%2 != 0) {
-      // normal is pointing inwards, flip this face at once
-      m_poly.face_flip(iface0);
-      nflip++;
-   }
-
-   // we have now established that iface0 is pointing out of the polyhedron
+   // first make all faces oriented the same way as the first polyhedron face.
    // just follow the neighbours and make sure they are pointing the same way, using only edge winding order
+   id_face iface0 = 0;
 
-   // collect the edge to face relations
-   edge_face_map edge_faces = m_poly.get_edge_faces();
-
-   // create a set of all faces, except iface0
-   face_set all_faces;
- //  size_t nface = m_poly->face_size();
- //  for(id_face iface=0; iface<nface; iface++) all_faces.insert(iface);
-   for(auto i=m_poly.face_begin(); i!=m_poly.face_end(); i++) all_faces.insert(i->first);
-   all_faces.erase(iface0);
+   // done_faces = faces already checked for flipping
+   std::vector<char> done_faces(m_poly.face_capacity(),0);
+   done_faces[iface0] = 1;
+   size_t ndone = 1;
 
    // todo_faces represent those that have been seen but neigbours not processed yet
-   // every face in this set will be guaranteed correctly oriented outward
-
-   face_set todo_faces;
-   todo_faces.insert(iface0);
-
-   //done_faces = faces already checked for flipping
-   face_set done_faces;
+   // every face in this set is oriented the same way as iface0
+   std::vector<id_face> todo_faces;
+   todo_faces.push_back(iface0);
 
    while(todo_faces.size() > 0) {
 
       // we have a new face0
-      id_face iface0 = *todo_faces.begin();
-      todo_faces.erase(iface0);
-      done_faces.insert(iface0);
-
-      // traverse the iface0 coedges and look op neigbour faces
-      coedge_vector coedges0 = m_poly.get_face_coedges(iface0);
-      for(id_coedge coedge0 : coedges0) {
+      id_face iface0 = todo_faces.back();
+      todo_faces.pop_back();
 
-         // look up the neighbour faces to coedge0
-         id_edge edge0 = std::abs(coedge0);
-         const face_set& neighbour_faces = edge_faces[edge0];
+      // traverse the iface0 half-edges and look op neigbour faces
+      halfedge_mesh::id_halfedge ih_first = m_poly.face_halfedge(iface0);
+      halfedge_mesh::id_halfedge ih0      = ih_first;
+      do {
 
-         // check only previously unseen neighbour faces different from iface0
-         // in reality neighbour_faces.size() should always be 2
-         for(id_face iface1 : neighbour_faces) {
-            if( (iface1!=iface0) && (done_faces.find(iface1) == done_faces.end()) )  {
+         // check only previously unseen neighbour faces on the same edge
+         // in reality there should always be exactly one
+         for(halfedge_mesh::id_halfedge ih1=m_poly.opposite(ih0); ih1!=ih0; ih1=m_poly.opposite(ih1)) {
+            id_face iface1 = m_poly.halfedge_face(ih1);
+            if(!done_faces[iface1]) {
 
                // check the face flip state of iface1 and put it into todo set
                // so we can traverse its neighbours
-               nflip += check_neighbour_flip(iface0,coedge0,iface1);
-               done_faces.insert(iface0);
-               todo_faces.insert(iface1);
+               nflip += check_neighbour_flip(ih0,ih1);
+               done_faces[iface1] = 1;
+               ndone++;
+               todo_faces.push_back(iface1);
             }
          }
-      }
+         ih0 = m_poly.next(ih0);
+      } while(ih0 != ih_first);
    }
 
-   // erase the faces done in this round, so we can check that all have been processed
-   for(id_face iface : done_faces) {
-      all_faces.erase(iface);
+   // check that all faces have been processed
+   size_t nface = m_poly.face_size();
+   if(ndone != nface) {
+      throw std::logic_error("polyflip::flip_faces(...) not all faces visited, is this polyhedron a single, connected body?");
    }
 
-   if(all_faces.size() != 0) {
-      throw std::logic_error("polyflip::flip_faces(...) not all faces visited, is this polyhedron a single, connected body?");
+   // the orientation of the body is decided from the consistently oriented faces
+   build_bvh();
+   bool inwards = (m_method == winding_number)? inwards_by_winding_number() : inwards_by_ray_parity();
+
+   // when the body points inwards, it must be flipped.
+   // Faces already flipped above are then flipped back, all others are flipped
+   if(inwards) {
+      size_t ncap = m_poly.face_capacity();
+      for(id_face iface=0; iface<ncap; iface++) {
+         if(m_poly.face_valid(iface)) m_poly.face_flip(iface);
+      }
+      nflip = nface - nflip;
    }
 
    if(nflip > 0) {
@@ -233,27 +180,80 @@ size_t polyflip::flip_faces()
       m_poly.update_input();
    }
 
-
    return nflip;
 }
 
-size_t polyflip::check_neighbour_flip(id_face iface0, id_coedge coedge0, id_face iface1)
+bool polyflip::inwards_by_ray_parity()
 {
-   coedge_vector coedges1 = m_poly.get_face_coedges(iface1);
+   // determine the normal orientation of a few seed faces spread over the polyhedron, skipping zero area faces.
+   // if the number of intersections is an even number (including zero), the normal is pointing outwards
+   size_t nseed   = std::min(num_seed_faces,m_poly.face_size());
+   size_t inwards = 0;
+   size_t tested  = 0;
+   size_t ncap    = m_poly.face_capacity();
+   for(size_t iseed=0; iseed<nseed; iseed++) {
+      for(id_face iface=ncap*iseed/nseed; iface<ncap*(iseed+1)/nseed; iface++) {
+         if(m_poly.face_valid(iface) && m_poly.face_area(iface) > m_atol) {
+            if(count_positive_intersections(iface)%2 != 0) inwards++;
+            tested++;
+            break;
+         }
+      }
+   }
 
-   // find the matching coedge
-   for(id_coedge coedge1 : coedges1) {
-      if( std::abs(coedge0) ==  std::abs(coedge1) ) {
-         // found it
-         if((coedge0+coedge1) != 0) {
+   // the body points inwards when most seeds do
+   return (2*inwards > tested);
+}
 
-            // iface1 has the wrong winding order, so flip it
-            m_poly.face_flip(iface1);
-            return 1;
+bool polyflip::inwards_by_winding_number()
+{
+   // sample faces spread over the polyhedron, skipping zero area faces
+   size_t ncap    = m_poly.face_capacity();
+   size_t nsample = std::min(num_winding_faces,m_poly.face_size());
+   std::vector<id_face> samples;
+   samples.reserve(nsample);
+   for(size_t isample=0; isample<nsample; isample++) {
+      for(id_face iface=ncap*isample/nsample; iface<ncap*(isample+1)/nsample; iface++) {
+         if(m_poly.face_valid(iface) && m_poly.face_area(iface) > m_atol) {
+            samples.push_back(iface);
+            break;
          }
-         return 0;
       }
    }
 
-   throw std::logic_error("polyflip::check_neighbour_flip(...) matching coedge not found");
+   // evaluate the winding number just outside and just inside each sample face.
+   // With outward normals, the values are close to 0 and 1, with inward normals close to -1 and 0.
+   // Their sum is therefore positive for outward normals, also where the body has holes or overlaps
+   std::vector<double> score(samples.size());
+   parallel_for(samples.size(),0,16,[this,&samples,&score](size_t first, size_t last) {
+      for(size_t isample=first; isample<last; isample++) {
+         id_face iface = samples[isample];
+         const pface face = m_poly.face(iface);
+         pos3d centroid;
+         for(id_vertex iv : face) centroid += m_poly.vertex(iv);
+         centroid /= double(face.size());
+
+         double area   = m_poly.face_area(iface);
+         vec3d  offset = m_poly.face_normal(iface)*(winding_offset*std::sqrt(area));
+         double w_out  = m_bvh.winding_number(centroid+offset);
+         double w_in   = m_bvh.winding_number(centroid-offset);
+         score[isample] = area*(w_out + w_in);
+      }
+   });
+
+   double total = 0.0;
+   for(double s : score) total += s;
+   return (total < 0.0);
+}
+
+size_t polyflip::check_neighbour_flip(halfedge_mesh::id_halfedge ih0, halfedge_mesh::id_halfedge ih1)
+{
+   // consistently oriented neighbour faces traverse their common edge in opposite directions
+   if(m_poly.origin(ih0) == m_poly.origin(ih1)) {
+
+      // the face of ih1 has the wrong winding order, so flip it
+      m_poly.face_flip(m_poly.halfedge_face(ih1));
+      return 1;
+   }
+   return 0;
 }
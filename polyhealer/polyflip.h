@@ -15,7 +15,8 @@
 #ifndef POLYFLIP_H
 #define POLYFLIP_H
 
-#include "mutable_polyhedron3d.h"
+#include "halfedge_mesh.h"
+#include "spacemath/triangle_bvh.h"
 #include <memory>
 #include <utility>  // std::pair
 #include <string>
@@ -23,31 +24,47 @@
 
 // this class checks for wrong face orientations and flips such faces.
 // the distance tolerance is used only for comparing intersections, and should
-//  be smaller than ordinary coordinate tolerances
+//  be smaller than ordinary coordinate tolerances.
+// The faces are first oriented consistently with the first face, then the whole body is flipped if it
+// is found to point inwards. This is decided either by the parity of ray hits from a few seed faces,
+// or by the generalized winding number just outside and inside sampled faces, which also works for
+// bodies with holes or other defects. Both use a triangle_bvh over the faces.
 
 class POLYHEALER_PUBLIC polyflip {
 public:
 
-   polyflip(const std::shared_ptr<polyhedron3d> poly, double dtol, double m_atol);
+   // method for deciding the orientation of the body
+   enum orientation_method { ray_parity, winding_number };
+
+   polyflip(const std::shared_ptr<polyhedron3d> poly, double dtol, double m_atol, orientation_method method = ray_parity);
    virtual ~polyflip();
 
    // perform the actual face flipping, this modifies the polyhedron
    size_t flip_faces();
 
 protected:
-   // check if pont p is inside triangle a,b,c
-   bool p_in_triangle(const pos3d& p, const pos3d& a, const pos3d& b, const pos3d& c);
+   // build m_bvh from the current faces, throws logic_error for non-triangular faces
+   void build_bvh();
 
    // count the intersections with other faces in the positive direction of the face normal
    size_t count_positive_intersections(id_face iface0);
 
-   // having established iface0 and iface1 as neigbour faces, flip face1 if winding order so dictates
-   size_t check_neighbour_flip(id_face iface0, id_coedge coedge0, id_face iface1);
+   // return true when most seed faces have an odd number of positive intersections
+   bool inwards_by_ray_parity();
+
+   // return true when the area weighted generalized winding number at sampled faces indicates inward normals
+   bool inwards_by_winding_number();
+
+   // having established the faces of half-edges ih0 and ih1 on the same edge as neighbour faces,
+   // flip the face of ih1 if winding order so dictates
+   size_t check_neighbour_flip(halfedge_mesh::id_halfedge ih0, halfedge_mesh::id_halfedge ih1);
 
 private:
-   mutable_polyhedron3d  m_poly;
+   halfedge_mesh  m_poly;
+   triangle_bvh   m_bvh;      // face triangles, triangle ids are face indices
    double m_dtol;     // distance tolerance
    double m_atol;     // area tolerance
+   orientation_method m_method;  // how the orientation of the body is decided
 };
 
 #endif // POLYFLIP_H
@@ -22,6 +22,17 @@
 #include <sstream>
 using namespace std;
 
+// enables the derived data cache of a polyhedron while healing, so the healing steps share the
+// edge table as long as the polyhedron is unchanged. The caller's cache setting is restored afterwards
+class scoped_cache {
+public:
+   scoped_cache(polyhedron3d& poly) : m_poly(poly), m_enabled(poly.cache_enabled()) { m_poly.enable_cache(true); }
+   ~scoped_cache() { m_poly.enable_cache(m_enabled); }
+private:
+   polyhedron3d& m_poly;
+   bool          m_enabled;
+};
+
 polyhealer::polyhealer(const std::shared_ptr<polyhedron3d> poly,  double dtol, double atol, bool verbose)
 : m_poly(poly)
 , m_dtol(dtol)
@@ -42,6 +53,7 @@ std::string polyhealer::size_status() const
 
 std::list<std::string> polyhealer::warnings() const
 {
+   scoped_cache cache(*m_poly);
    polyfix pre_fix(m_poly,m_dtol,m_atol,m_verbose);
    std::list<std::string> warnings = pre_fix.check();
    if(warnings.size() == 0)warnings.push_back("no warnings");
@@ -140,6 +152,7 @@ void polyhealer::remove_nonmanifold_or_zero_faces()
 
 size_t polyhealer::run_healing_step()
 {
+   scoped_cache cache(*m_poly);
    m_nchanges=0;
 
    // add an initial status
@@ -163,6 +176,7 @@ size_t polyhealer::run_healing_step()
 
 std::string  polyhealer::run_healing(size_t maxiter, std::ostream& out)
 {
+   scoped_cache cache(*m_poly);
    std::string warning_summary = "";
 
    const string blanks = "             ";
@@ -192,11 +206,11 @@ std::string  polyhealer::run_healing(size_t maxiter, std::ostream& out)
    return warning_summary;
 }
 
-std::shared_ptr<ph3d_vector>  polyhealer::find_lumps(bool flip_faces)
+std::shared_ptr<ph3d_vector>  polyhealer::find_lumps(bool flip_faces, bool reorder, bool winding)
 {
    m_messages.clear();
    ostringstream out;
-   lump_finder lfinder(m_poly);
+   lump_finder lfinder(m_poly,reorder);
    std::shared_ptr<ph3d_vector> lumps = lfinder.find_lumps();
 
    if(lumps->size() == 0) {
@@ -211,7 +225,7 @@ std::shared_ptr<ph3d_vector>  polyhealer::find_lumps(bool flip_faces)
       size_t ilump=0;
       for(auto lump : *lumps) {
          ostringstream out;
-         polyflip flipper(lump,m_dtol,m_atol);
+         polyflip flipper(lump,m_dtol,m_atol,winding? polyflip::winding_number : polyflip::ray_parity);
          size_t nflip = flipper.flip_faces();
          out << "lump " << ilump << " flipped "<< nflip << ((nflip==1)? " face":" faces");
          m_messages.push_back(out.str());
@@ -30,6 +30,7 @@ public:
    typedef std::list<std::string> message_list;
    typedef message_list::iterator iterator;
 
+   // poly is healed in place. Its derived data cache is enabled during healing only, see polyhedron3d::enable_cache
    polyhealer(const std::shared_ptr<polyhedron3d> poly, double dist_tol, double area_tol, bool verbose);
    virtual ~polyhealer();
 
@@ -49,8 +50,10 @@ public:
    iterator begin() { return m_messages.begin(); }
    iterator end()   { return m_messages.end(); }
 
-   // findlumps from the input polyhedron
-   std::shared_ptr<ph3d_vector>  find_lumps(bool flip_faces);
+   // findlumps from the input polyhedron.
+   // With reorder=true, each lump is reordered for cache locality before faces are flipped
+   // With winding=true, lump orientation is decided by generalized winding numbers instead of ray parity, see polyflip
+   std::shared_ptr<ph3d_vector>  find_lumps(bool flip_faces, bool reorder = false, bool winding = false);
 
 protected:
    void remove_unused_vertices();
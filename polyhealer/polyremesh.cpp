@@ -15,6 +15,7 @@
 #include "polyremesh.h"
 #include "spacemath/line3d.h"
 #include <limits>
+#include <unordered_set>
 #include <sstream>
 #include <iomanip>
 #include <cmath>
@@ -38,10 +39,9 @@ polyremesh::edge_length_map polyremesh::compute_face_aspect_ratio_edges()
    std::unordered_set<id_edge> done_edges;
 
    // traverse all faces
-   const face_edge_map& face_edges = m_poly.get_face_edges();
-   for(auto p : face_edges) {
-      id_face   iface = p.first;
-      edge_set& edges = p.second;
+   size_t nface = m_poly.face_capacity();
+   for(id_face iface=0; iface<nface; iface++) {
+      if(!m_poly.face_valid(iface)) continue;
 
       // check if the face has poor aspect ratio
       double aspect_ratio = m_poly.face_aspect_ratio(iface);
@@ -49,9 +49,12 @@ polyremesh::edge_length_map polyremesh::compute_face_aspect_ratio_edges()
 
          // find the longest face edge and add it to the set
          edge_length_map face_edge_lengths;
-         for(id_edge iedge : edges) {
-            face_edge_lengths.insert(std::make_pair(m_poly.edge_length(iedge),iedge));
-         }
+         halfedge_mesh::id_halfedge ih0 = m_poly.face_halfedge(iface);
+         halfedge_mesh::id_halfedge ih  = ih0;
+         do {
+            face_edge_lengths.insert(std::make_pair(m_poly.edge_length(ih),m_poly.edge(ih)));
+            ih = m_poly.next(ih);
+         } while(ih != ih0);
 
          // keep the edge if not seen before
          auto i =  face_edge_lengths.rbegin();
@@ -69,21 +72,19 @@ polyremesh::edge_length_map polyremesh::compute_edge_lengths()
    edge_length_map edge_lengths;
 
    // traverse edges and sort on edge length
-   const edge_face_map& edges = m_poly.get_edge_faces();
-   for(auto& p : edges) {
-      id_edge iedge = p.first;
+   size_t nhe = m_poly.halfedge_capacity();
+   for(halfedge_mesh::id_halfedge ih=0; ih<nhe; ih++) {
+      if(!m_poly.halfedge_valid(ih) || !m_poly.edge_leader(ih)) continue;
 
       // edge length
-      const vertex_pair& vp = m_poly.edge_vertices(iedge);
-      const pos3d& p1 = m_poly.vertex(vp.first);
-      const pos3d& p2 = m_poly.vertex(vp.second);
-      double elen = p1.dist(p2);
+      double elen = m_poly.edge_length(ih);
 
       // TODO: replace this statement with an evaluation of edge elngth as function of xyz
       double tlen = m_edge_len;
 
       if(elen > tlen) {
-         edge_lengths.insert(std::make_pair(elen,iedge));
+         // edges are referred to by id_edge, since half-edges are reused as the mesh changes
+         edge_lengths.insert(std::make_pair(elen,m_poly.edge(ih)));
       }
    }
 
@@ -103,8 +104,7 @@ void polyremesh::flip_split()
 
       // obtain edges longer than limit and split them
       // note that edges will be added and removed as we traverse,
-      // but it seems to be ok because if an edge no longer exists
-      // it will return zero faces and therefore ignored.
+      // but it is ok because an edge that no longer exists is ignored.
       edge_length_map edge_lengths = compute_edge_lengths();
       for(auto i=edge_lengths.rbegin(); i!= edge_lengths.rend(); i++) {
          id_edge iedge = i->second;
@@ -152,25 +152,29 @@ void  polyremesh::aspect_ratio_flip()
 size_t polyremesh::flip_edge(id_edge iedge)
 {
    size_t nflip_split = 0;
-   auto& faces = m_poly.get_edge_faces(iedge);
-   if(faces.size() == 2) {
+
+   // look up the edge, it may have been removed
+   const vertex_pair vp = polyhedron3d::EDGE_VERTICES(iedge);
+   halfedge_mesh::id_halfedge ih = m_poly.find_halfedge(vp.first,vp.second);
+   if(ih == halfedge_mesh::npos) return 0;
+
+   if(m_poly.edge_use_count(ih) == 2) {
 
       // this is a 2-manifold edge
       // get the relevant existing vertices
-      const vertex_pair& vp = m_poly.edge_vertices(iedge);
       id_vertex iv1   = vp.first;
       id_vertex iv2   = vp.second;
       const pos3d& p1 = m_poly.vertex(iv1);
       const pos3d& p2 = m_poly.vertex(iv2);
       line3d edge_line(p1, p2);
 
-      auto i = faces.begin();
-      id_face face1   = *i++;
-      id_face face2   = *i;
+      halfedge_mesh::id_halfedge io = m_poly.opposite(ih);
+      id_face face1   = m_poly.halfedge_face(ih);
+      id_face face2   = m_poly.halfedge_face(io);
 
       // get opposite vertices
-      id_vertex iv3   = m_poly.opposite_vertex(face1,iedge);
-      id_vertex iv4   = m_poly.opposite_vertex(face2,iedge);
+      id_vertex iv3   = m_poly.opposite_vertex(ih);
+      id_vertex iv4   = m_poly.opposite_vertex(io);
       const pos3d& p3 = m_poly.vertex(iv3);
       const pos3d& p4 = m_poly.vertex(iv4);
       line3d flip_line(p3, p4);
@@ -210,16 +214,21 @@ size_t polyremesh::flip_edge(id_edge iedge)
                double aspect_new = std::min(m_poly.face_aspect_ratio(iv1,iv3,iv4),m_poly.face_aspect_ratio(iv3,iv2,iv4));
 
                if((aspect_new > aspect_old) && (aspect_new > m_min_aspect_ratio)) {
-                  // first get face normal from face1 to use as guide
-                  vec3d normal1 = m_poly.face_normal(face1);
 
-                  // then remove the 2 old faces
-                  remove_face(face1,iedge);
-                  remove_face(face2,iedge);
+                  // flip the edge in place when possible
+                  if(!m_poly.flip_edge(ih)) {
+
+                     // first get face normal from face1 to use as guide
+                     vec3d normal1 = m_poly.face_normal(face1);
 
-                  // add the replacement faces with check of normal vector
-                  add_face(normal1,iv1,iv3,iv4);
-                  add_face(normal1,iv3,iv2,iv4);
+                     // then remove the 2 old faces
+                     remove_face(face1);
+                     remove_face(face2);
+
+                     // add the replacement faces with check of normal vector
+                     add_face(normal1,iv1,iv3,iv4);
+                     add_face(normal1,iv3,iv2,iv4);
+                  }
 
                   nflip_split++;
                }
@@ -235,12 +244,15 @@ size_t polyremesh::flip_split(id_edge iedge)
 {
    size_t nflip_split = 0;
 
-   // get neighbour faces
-   auto& faces = m_poly.get_edge_faces(iedge);
-   if(faces.size() > 0) {
+   // look up the edge, it may have been removed
+   const vertex_pair vp = polyhedron3d::EDGE_VERTICES(iedge);
+   halfedge_mesh::id_halfedge ih = m_poly.find_halfedge(vp.first,vp.second);
+
+   // get number of neighbour faces
+   size_t nfaces = (ih == halfedge_mesh::npos)? 0 : m_poly.edge_use_count(ih);
+   if(nfaces > 0) {
 
       // get the relevant existing vertices
-      const vertex_pair& vp = m_poly.edge_vertices(iedge);
       id_vertex iv1   = vp.first;
       id_vertex iv2   = vp.second;
 
@@ -250,12 +262,12 @@ size_t polyremesh::flip_split(id_edge iedge)
       line3d edge_line(p1,p2);
       double edge_len = edge_line.length();
 
-      if(faces.size() == 1) {
+      if(nfaces == 1) {
 
          // Case 1
          // this is a free edge, we split it half way
-         id_face face  = *faces.begin();
-         id_vertex iv3 = m_poly.opposite_vertex(face,iedge);
+         id_face face  = m_poly.halfedge_face(ih);
+         id_vertex iv3 = m_poly.opposite_vertex(ih);
          vec3d normal  = m_poly.face_normal(face);
 
          // add the new vertex
@@ -263,7 +275,7 @@ size_t polyremesh::flip_split(id_edge iedge)
          id_vertex iv4 = m_poly.add_vertex(pmid);
 
          // remove the old face
-         remove_face(face,iedge);
+         remove_face(face);
 
          // add 2 faces with check of normal vector
          add_face(normal,iv1,iv3,iv4);
@@ -273,19 +285,19 @@ size_t polyremesh::flip_split(id_edge iedge)
          nflip_split++;
 
       }
-      else if(faces.size() == 2) {
+      else if(nfaces == 2) {
 
          // Cases 2, 3 or 4
          // this is a 2-manifold edge
 
          // we may flip or split
-         auto i = faces.begin();
-         id_face face1 = *i++;
-         id_face face2 = *i;
+         halfedge_mesh::id_halfedge io = m_poly.opposite(ih);
+         id_face face1 = m_poly.halfedge_face(ih);
+         id_face face2 = m_poly.halfedge_face(io);
 
          // get opposite vertices
-         id_vertex iv3 = m_poly.opposite_vertex(face1,iedge);
-         id_vertex iv4 = m_poly.opposite_vertex(face2,iedge);
+         id_vertex iv3 = m_poly.opposite_vertex(ih);
+         id_vertex iv4 = m_poly.opposite_vertex(io);
          const pos3d& p3 = m_poly.vertex(iv3);
          const pos3d& p4 = m_poly.vertex(iv4);
          line3d flip_line(p3,p4);
@@ -347,18 +359,20 @@ size_t polyremesh::flip_split(id_edge iedge)
          if((edge_len>flip_len) &&  (flip_dist <= m_dtol) && on_edge) {
 
             // Case 2
-            // ok, we shall flip this edge.
+            // ok, we shall flip this edge, in place when possible
+            if(!m_poly.flip_edge(ih)) {
 
-            // first get face normal from face1 to use as guide
-            vec3d normal = m_poly.face_normal(face1);
+               // first get face normal from face1 to use as guide
+               vec3d normal = m_poly.face_normal(face1);
 
-            // then remove the 2 old faces
-            remove_face(face1,iedge);
-            remove_face(face2,iedge);
+               // then remove the 2 old faces
+               remove_face(face1);
+               remove_face(face2);
 
-            // add the replacement faces with check of normal vector
-            add_face(normal,iv1,iv3,iv4);
-            add_face(normal,iv3,iv2,iv4);
+               // add the replacement faces with check of normal vector
+               add_face(normal,iv1,iv3,iv4);
+               add_face(normal,iv3,iv2,iv4);
+            }
 
             // indicate we performed a flip_split
             nflip_split++;
@@ -397,8 +411,8 @@ size_t polyremesh::flip_split(id_edge iedge)
                id_vertex iv5 = m_poly.add_vertex(pmid);
 
                // then remove the 2 old faces
-               remove_face(face1,iedge);
-               remove_face(face2,iedge);
+               remove_face(face1);
+               remove_face(face2);
 
                // add new faces
 
@@ -434,8 +448,8 @@ size_t polyremesh::flip_split(id_edge iedge)
                   vec3d normal2 = m_poly.face_normal(face2);
 
                   // then remove the 2 old faces
-                  remove_face(face1,iedge);
-                  remove_face(face2,iedge);
+                  remove_face(face1);
+                  remove_face(face2);
 
                   // add new faces
 
@@ -15,7 +15,8 @@
 #ifndef POLYREMESH_H
 #define POLYREMESH_H
 
-#include "mutable_polyhedron3d.h"
+#include "halfedge_mesh.h"
+#include <map>
 
 // polyremesh performs surface remeshing of input polyhedron
 // The main purpose is to prepare for 3d FEM meshing
@@ -40,10 +41,10 @@ protected:
    size_t flip_edge(id_edge iedge);
 
    id_face add_face(const vec3d& normal, id_vertex iv1, id_vertex iv2, id_vertex iv3);
-   inline void  remove_face(id_face iface, id_edge iedge) { m_poly.remove_face(iface,iedge); }
+   inline void  remove_face(id_face iface) { m_poly.remove_face(iface); }
 
 private:
-   mutable_polyhedron3d  m_poly;
+   halfedge_mesh         m_poly;
    double                m_dtol;             // distance tolerance
    double                m_edge_len;         // target edge lengths
    double                m_min_aspect_ratio; // minimum aspect ratio
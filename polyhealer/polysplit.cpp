@@ -14,9 +14,13 @@
 // EndLicense:
 #include "polysplit.h"
 #include "spacemath/line3d.h"
+#include "spacemath/bbox3d.h"
+#include "spacemath/parallel_for.h"
 
 #include <iostream>
 #include <limits>
+#include <cmath>
+#include <vector>
 
 polysplit::polysplit(std::shared_ptr<polyhedron3d> poly, double dtol, double atol)
 : m_poly(poly)
@@ -55,74 +59,186 @@ void polysplit::build_free_edges()
    m_free_edges.clear();
 
    // perform edge use count
-   std::map<id_edge,size_t> edge_count;
-   edge_map all_edges;
+   m_edges = m_poly->edges();
+
+   // build free edge set
    size_t nface = m_poly->face_size();
    for(size_t iface=0; iface<nface; iface++) {
 
       const pface& face = m_poly->face(iface);
 
-      // count edges
       // number of edges == number of vertices
       size_t nedge     = face.size();
       size_t last_edge = nedge-1;
       for(size_t iedge=0; iedge<nedge; iedge++) {
-         id_vertex iv0 = face[iedge];
-         id_vertex iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         id_edge  edge =  polyhedron3d::EDGE(iv0,iv1);
-         edge_count[edge]++;
-         all_edges[edge] = std::make_pair(iv0,iv1);
+         size_t ie = m_edges->face_edge(iface,iedge);
+         if(m_edges->use_count(ie) == 1) {
+            // insert free edge and its vertices, in face order
+            id_vertex iv0 = face[iedge];
+            id_vertex iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
+            m_free_edges.insert(std::make_pair(m_edges->edge(ie),std::make_pair(iv0,iv1)));
+         }
       }
    }
+}
 
-   // build free edge set
-   for(auto& p : edge_count) {
-      if(p.second == 1) {
-         // insert free edge and its vertices
-         m_free_edges.insert(std::make_pair(p.first,all_edges[p.first]));
-      }
-   }
+
+// T-junction search support: the free edges are indexed in a uniform grid, each edge is registered in all
+// cells overlapped by its bounding box inflated by the distance tolerance. A vertex can then only split
+// edges registered in its own cell. Edges covering very many cells are tested against all vertices instead.
+
+static const int      split_cell_bits  = 21;
+static const uint64_t split_cell_max   = (uint64_t(1) << split_cell_bits) - 1;
+static const size_t   split_edge_cells = 512;  // edges covering more cells are not registered in the grid
+
+// free edge with its vertices in face order
+struct split_edge {
+   polysplit::id_edge   edge;
+   polysplit::id_vertex iv0;
+   polysplit::id_vertex iv1;
+};
+
+// vertex found to split an edge at parameter par
+struct split_hit {
+   polysplit::id_edge   edge;
+   double               par;
+   polysplit::id_vertex iv;
+};
+
+// cell coordinate of a position component
+static inline uint64_t split_cell(double value, double vmin, double cell)
+{
+   double f = std::floor((value-vmin)/cell);
+   if(!(f >= 0.0)) f = 0.0;
+   if(f > split_cell_max) f = double(split_cell_max);
+   return uint64_t(f);
 }
 
+static inline uint64_t split_cell_key(uint64_t ix, uint64_t iy, uint64_t iz)
+{
+   return (ix << (2*split_cell_bits)) | (iy << split_cell_bits) | iz;
+}
 
 void polysplit::build_edge_splits()
 {
-   m_edge_splits.clear();
+   const polyhedron3d& poly = *m_poly;
 
-   // traverse vertices
-   size_t nvert = m_poly->vertex_size();
-   for(size_t ivert=0; ivert<nvert; ivert++) {
+   m_edge_splits.clear();
+   if(m_free_edges.size() == 0) return;
+
+   // free edges in edge order, indexed by position
+   std::vector<split_edge> edges;
+   edges.reserve(m_free_edges.size());
+   for(auto& p : m_free_edges) edges.push_back(split_edge{p.first,p.second.first,p.second.second});
+   size_t nedge = edges.size();
+
+   // edge boxes, the mean box size decides the grid cell size
+   std::vector<bbox3d> edge_box(nedge);
+   bbox3d box;
+   double mean_size = 0.0;
+   for(size_t ie=0; ie<nedge; ie++) {
+      bbox3d& ebox = edge_box[ie];
+      ebox.enclose(poly.vertex(edges[ie].iv0));
+      ebox.enclose(poly.vertex(edges[ie].iv1));
+      box.enclose(ebox.p1());
+      box.enclose(ebox.p2());
+      mean_size += std::max(ebox.dx(),std::max(ebox.dy(),ebox.dz()));
+   }
+   mean_size /= nedge;
+
+   // the boxes are inflated by the tolerance, plus some slack for rounding in the projection.
+   // Only vertices inside the inflated union box can split an edge
+   double extent = std::max(box.dx(),std::max(box.dy(),box.dz()));
+   double margin = m_dtol + 1.0e-9*extent;
+   box.enclose(box.p1(),margin);
+   box.enclose(box.p2(),margin);
+   double cell   = std::max(std::max(mean_size,2*margin),(extent+2*margin)/double(split_cell_max-1));
+   if(!(cell > 0.0)) cell = 1.0;
+   const pos3d& p0 = box.p1();
+
+   // register each edge in the cells it overlaps, or in the list of large edges
+   std::vector<std::pair<uint64_t,uint32_t>> cell_edges;
+   std::vector<uint32_t> large_edges;
+   for(size_t ie=0; ie<nedge; ie++) {
+      const bbox3d& ebox = edge_box[ie];
+      uint64_t ix0 = split_cell(ebox.p1().x()-margin,p0.x(),cell), ix1 = split_cell(ebox.p2().x()+margin,p0.x(),cell);
+      uint64_t iy0 = split_cell(ebox.p1().y()-margin,p0.y(),cell), iy1 = split_cell(ebox.p2().y()+margin,p0.y(),cell);
+      uint64_t iz0 = split_cell(ebox.p1().z()-margin,p0.z(),cell), iz1 = split_cell(ebox.p2().z()+margin,p0.z(),cell);
+      if((ix1-ix0+1)*(iy1-iy0+1)*(iz1-iz0+1) > split_edge_cells) {
+         large_edges.push_back(uint32_t(ie));
+         continue;
+      }
+      for(uint64_t ix=ix0; ix<=ix1; ix++) {
+         for(uint64_t iy=iy0; iy<=iy1; iy++) {
+            for(uint64_t iz=iz0; iz<=iz1; iz++) {
+               cell_edges.push_back(std::make_pair(split_cell_key(ix,iy,iz),uint32_t(ie)));
+            }
+         }
+      }
+   }
+   parallel_sort(cell_edges.begin(),cell_edges.end(),std::less<std::pair<uint64_t,uint32_t>>());
+
+   // occupied cells and their edge ranges
+   std::vector<uint64_t> cell_key;
+   std::vector<size_t>   cell_start;
+   for(size_t i=0; i<cell_edges.size(); i++) {
+      if(i==0 || cell_edges[i].first != cell_edges[i-1].first) {
+         cell_key.push_back(cell_edges[i].first);
+         cell_start.push_back(i);
+      }
+   }
+   cell_start.push_back(cell_edges.size());
 
-      // get vertex position
-      const pos3d& pos = m_poly->vertex(ivert);
+   // query the vertices in parallel blocks, each block collects its splits in vertex order
+   size_t nvert  = poly.vertex_size();
+   size_t nblock = std::max(std::min(parallel_threads(0),nvert/(1<<12)),size_t(1));
+   std::vector<std::vector<split_hit>> block_hits(nblock);
+   parallel_tasks(nblock,nblock,[&](size_t iblock) {
 
-      // traverse free edges and check for splits
-      for(auto& p : m_free_edges) {
+      std::vector<split_hit>& hits = block_hits[iblock];
 
-         // get the edge and its vertices
-         id_edge   edge = p.first;
-         id_vertex iv0  = (p.second).first;
-         id_vertex iv1  = (p.second).second;
+      // check if the vertex splits the edge
+      auto test_edge = [&](id_vertex ivert, const pos3d& pos, const split_edge& e) {
          // skip if the current vertex is one of the end vertices of the edge
-         if( (ivert!=iv0) && (ivert!=iv1) ) {
+         if( (ivert!=e.iv0) && (ivert!=e.iv1) ) {
 
             // compute projection onto edge line
-            line3d edge_line(m_poly->vertex(iv0),m_poly->vertex(iv1));
+            line3d edge_line(poly.vertex(e.iv0),poly.vertex(e.iv1));
             double par = edge_line.project(pos);
             if( par>0.0 && par<1.0 ) {
                // the projection is on the edge, is the vertex actually on the edge?
                double dist = pos.dist(edge_line.interpolate(par));
                if(dist <= m_dtol) {
                   // yes, this vertex is splitting the edge
-                  m_edge_splits[edge][par] = ivert;
+                  hits.push_back(split_hit{e.edge,par,ivert});
                }
             }
          }
+      };
+
+      for(size_t ivert=nvert*iblock/nblock; ivert<nvert*(iblock+1)/nblock; ivert++) {
+
+         // get vertex position
+         const pos3d& pos = poly.vertex(ivert);
+
+         // free edges registered in the vertex cell
+         if(box.is_enclosed(pos)) {
+            uint64_t key = split_cell_key(split_cell(pos.x(),p0.x(),cell),split_cell(pos.y(),p0.y(),cell),split_cell(pos.z(),p0.z(),cell));
+            auto it = std::lower_bound(cell_key.begin(),cell_key.end(),key);
+            if(it != cell_key.end() && *it == key) {
+               size_t icell = it - cell_key.begin();
+               for(size_t i=cell_start[icell]; i<cell_start[icell+1]; i++) test_edge(ivert,pos,edges[cell_edges[i].second]);
+            }
+         }
 
-      // next free edge
+         // large edges are always tested
+         for(uint32_t ie : large_edges) test_edge(ivert,pos,edges[ie]);
       }
+   });
 
-   // next vertex
+   // the blocks are merged in vertex order, so the result is the same as for a serial vertex traversal
+   for(auto& hits : block_hits) {
+      for(auto& hit : hits) m_edge_splits[hit.edge][hit.par] = hit.iv;
    }
 }
 
@@ -130,23 +246,11 @@ void polysplit::build_edge_faces()
 {
    m_edge_faces.clear();
 
-   // traverse faces and register the faces affected by edge splits
-   size_t nface = m_poly->face_size();
-   for(size_t iface=0; iface<nface; iface++) {
-      const pface& face = m_poly->face(iface);
-
-      // number of face edges == number of vertices
-      size_t nedge     = face.size();
-      size_t last_edge = nedge-1;
-      for(size_t iedge=0; iedge<nedge; iedge++) {
-         id_vertex iv0 = face[iedge];
-         id_vertex iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         id_edge  edge =  polyhedron3d::EDGE(iv0,iv1);
-         if(m_free_edges.find(edge) != m_free_edges.end()) {
-            // this is one of the free edges, therefore add this face to its reference
-            m_edge_faces[edge].insert(iface);
-         }
-      }
+   // register the faces affected by edge splits
+   for(auto& p : m_free_edges) {
+      id_edge edge = p.first;
+      size_t  ie   = m_edges->find(edge);
+      m_edge_faces[edge].insert(m_edges->face_begin(ie),m_edges->face_end(ie));
    }
 }
 
@@ -17,6 +17,7 @@
 #include "polyhealer_config.h"
 
 #include "spacemath/polyhedron3d.h"
+#include "spacemath/edge_table.h"
 #include <memory>
 #include <algorithm>
 #include <utility>  // std::pair
@@ -62,6 +63,7 @@ private:
    std::shared_ptr<polyhedron3d>  m_poly;  // original polyhedron
 
 private:
+   std::shared_ptr<const edge_table> m_edges;  // all polyhedron edges and their faces
    edge_map    m_free_edges;    // contains edges with use-count=1
    edge_faces  m_edge_faces;    // m_edge_faces[edge]  = faces referencing id_edge
    edge_splits m_edge_splits;   // m_edge_splits[edge] = vertices causing edge split
@@ -0,0 +1,110 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+#ifndef UNION_FIND_H
+#define UNION_FIND_H
+
+// union_find is a lock-free disjoint set structure over the indices [0,size()),
+// so several threads may join sets at the same time. Parents only ever decrease,
+// since the higher root is always linked below the lower one. The root of each set
+// is therefore its lowest index, which makes the final set numbering deterministic.
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "spacemath/parallel_for.h"
+
+class union_find {
+public:
+   // every index starts in a set of its own. nthreads is the maximum number of threads to use, 0=all hardware threads
+   union_find(size_t n, size_t nthreads = 0)
+   : m_parent(n)
+   , m_nthreads(nthreads)
+   {
+      spacemath::parallel_for(n,m_nthreads,1<<16,[this](size_t first, size_t last) {
+         for(size_t i=first; i<last; i++) m_parent[i].store(uint32_t(i),std::memory_order_relaxed);
+      });
+   }
+
+   inline size_t size() const { return m_parent.size(); }
+
+   // return the root of the set containing x, with path halving. Safe for concurrent use
+   inline uint32_t find(uint32_t x)
+   {
+      for(;;) {
+         uint32_t p = m_parent[x].load(std::memory_order_relaxed);
+         if(p == x) return x;
+         uint32_t gp = m_parent[p].load(std::memory_order_relaxed);
+         if(p != gp) m_parent[x].compare_exchange_weak(p,gp,std::memory_order_relaxed);
+         x = gp;
+      }
+   }
+
+   // join the sets containing a and b. Safe for concurrent use
+   inline void unite(uint32_t a, uint32_t b)
+   {
+      for(;;) {
+         a = find(a);
+         b = find(b);
+         if(a == b) return;
+         if(a > b) std::swap(a,b);
+         uint32_t expected = b;
+         if(m_parent[b].compare_exchange_strong(expected,a,std::memory_order_relaxed)) return;
+      }
+   }
+
+   // number the sets in order of their root, i.e. their lowest index, and set label[i] to the set number of i.
+   // Must not run concurrently with unite. Returns the number of sets
+   size_t label(std::vector<uint32_t>& label)
+   {
+      size_t n = size();
+      label.resize(n);
+      if(n == 0) return 0;
+
+      // flatten, so every parent is a root, and count the roots in each block
+      size_t nblock = std::min(spacemath::parallel_threads(m_nthreads),n);
+      std::vector<size_t> block_roots(nblock+1,0);
+      spacemath::parallel_tasks(nblock,nblock,[this,n,nblock,&block_roots](size_t iblock) {
+         size_t nroot = 0;
+         for(size_t i=n*iblock/nblock; i<n*(iblock+1)/nblock; i++) {
+            uint32_t root = find(uint32_t(i));
+            m_parent[i].store(root,std::memory_order_relaxed);
+            if(root == i) nroot++;
+         }
+         block_roots[iblock+1] = nroot;
+      });
+      for(size_t iblock=0; iblock<nblock; iblock++) block_roots[iblock+1] += block_roots[iblock];
+
+      // number the roots, then the other indices from their root
+      spacemath::parallel_tasks(nblock,nblock,[this,n,nblock,&block_roots,&label](size_t iblock) {
+         uint32_t iset = uint32_t(block_roots[iblock]);
+         for(size_t i=n*iblock/nblock; i<n*(iblock+1)/nblock; i++) {
+            if(m_parent[i].load(std::memory_order_relaxed) == i) label[i] = iset++;
+         }
+      });
+      spacemath::parallel_for(n,m_nthreads,1<<16,[this,&label](size_t first, size_t last) {
+         for(size_t i=first; i<last; i++) {
+            uint32_t root = m_parent[i].load(std::memory_order_relaxed);
+            if(root != i) label[i] = label[root];
+         }
+      });
+      return block_roots[nblock];
+   }
+
+private:
+   std::vector<std::atomic<uint32_t>> m_parent;
+   size_t                             m_nthreads;
+};
+
+#endif // UNION_FIND_H
@@ -0,0 +1,165 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "vertex_welder.h"
+#include "union_find.h"
+#include "spacemath/bbox3d.h"
+#include "spacemath/parallel_for.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// vertices are sorted by grid cell key, the cell coordinates are packed as 21 bits each
+struct weld_entry {
+   uint64_t key;
+   uint32_t iv;
+};
+
+inline bool operator<(const weld_entry& a, const weld_entry& b)
+{
+   return (a.key < b.key) || ((a.key == b.key) && (a.iv < b.iv));
+}
+
+static const int      cell_bits = 21;
+static const uint64_t cell_max  = (uint64_t(1) << cell_bits) - 3;  // highest cell coordinate, leaves room for neighbours on both sides
+
+vertex_welder::vertex_welder(double dtol, size_t nthreads)
+: m_dtol(dtol)
+, m_nthreads(nthreads)
+{}
+
+vertex_welder::~vertex_welder()
+{}
+
+size_t vertex_welder::weld(const polyhedron3d& poly, std::vector<uint32_t>& remap, vtx_vec& welded) const
+{
+   size_t nv = poly.vertex_size();
+   if(nv >= std::numeric_limits<uint32_t>::max()) {
+      throw std::logic_error("vertex_welder::weld, too many vertices: " + std::to_string(nv));
+   }
+
+   remap.resize(nv);
+   welded.clear();
+   if(nv == 0) return 0;
+
+   // grid cells must be at least as large as the tolerance,
+   // and large enough for the cell coordinates to fit the key
+   bbox3d box = poly.bbox();
+   const pos3d& p0 = box.p1();
+   double extent = std::max(box.dx(),std::max(box.dy(),box.dz()));
+   double cell   = std::max(m_dtol,extent/double(cell_max-1));
+   if(!(cell > 0.0)) cell = 1.0;
+
+   // compute the cell key of every vertex and sort by it
+   std::vector<weld_entry> entries(nv);
+   parallel_for(nv,m_nthreads,1<<16,[&poly,&entries,&p0,cell](size_t first, size_t last) {
+      for(size_t iv=first; iv<last; iv++) {
+         const pos3d& p = poly.vertex(iv);
+         double f[3] = { (p.x()-p0.x())/cell, (p.y()-p0.y())/cell, (p.z()-p0.z())/cell };
+         uint64_t key = 0;
+         for(size_t k=0; k<3; k++) {
+            double fk = std::floor(f[k]);
+            if(!(fk >= 0.0))         fk = 0.0;
+            if(fk > cell_max-1)      fk = double(cell_max-1);
+            key = (key << cell_bits) | (uint64_t(fk) + 1);
+         }
+         entries[iv].key = key;
+         entries[iv].iv  = uint32_t(iv);
+      }
+   });
+   parallel_sort(entries.begin(),entries.end(),std::less<weld_entry>(),m_nthreads);
+
+   // occupied cells and their vertex ranges
+   std::vector<uint64_t> cell_key;
+   std::vector<size_t>   cell_start;
+   for(size_t i=0; i<nv; i++) {
+      if(i==0 || entries[i].key != entries[i-1].key) {
+         cell_key.push_back(entries[i].key);
+         cell_start.push_back(i);
+      }
+   }
+   size_t ncell = cell_key.size();
+   cell_start.push_back(nv);
+
+   // union-find over vertex indices
+   union_find parent(nv,m_nthreads);
+
+   // compare each cell with itself and its 13 forward neighbours.
+   // The forward neighbours are cell z+1 and the 3 cells z-1..z+1 in the rows
+   // (x,y+1), (x+1,y-1), (x+1,y), (x+1,y+1). Since the keys are linear in the cell
+   // coordinates, each row starts at a constant key offset from the current cell
+   const uint64_t dy = uint64_t(1) << cell_bits;
+   const uint64_t dx = uint64_t(1) << (2*cell_bits);
+   const uint64_t row_offset[4] = { dy-1, dx-dy-1, dx-1, dx+dy-1 };
+   const double   tol = m_dtol;
+
+   parallel_for(ncell,m_nthreads,1<<12,[&](size_t first, size_t last) {
+
+      // test all vertex pairs between 2 cells, or within one cell when ca==cb
+      auto test_cells = [&](size_t ca, size_t cb) {
+         for(size_t ia=cell_start[ca]; ia<cell_start[ca+1]; ia++) {
+            uint32_t iva = entries[ia].iv;
+            const pos3d& pa = poly.vertex(iva);
+            size_t ib0 = (ca==cb)? ia+1 : cell_start[cb];
+            for(size_t ib=ib0; ib<cell_start[cb+1]; ib++) {
+               uint32_t ivb = entries[ib].iv;
+               if(pa.dist(poly.vertex(ivb)) <= tol) parent.unite(iva,ivb);
+            }
+         }
+      };
+
+      // row cursors only move forward as the cells are traversed in key order
+      size_t cursor[4];
+      for(size_t r=0; r<4; r++) {
+         cursor[r] = std::lower_bound(cell_key.begin(),cell_key.end(),cell_key[first]+row_offset[r]) - cell_key.begin();
+      }
+
+      for(size_t c=first; c<last; c++) {
+         uint64_t key = cell_key[c];
+
+         test_cells(c,c);
+         if(c+1<ncell && cell_key[c+1]==key+1) test_cells(c,c+1);
+
+         for(size_t r=0; r<4; r++) {
+            uint64_t lo = key + row_offset[r];
+            uint64_t hi = lo + 2;
+            size_t& j = cursor[r];
+            while(j<ncell && cell_key[j]<lo) j++;
+            for(size_t jc=j; jc<ncell && cell_key[jc]<=hi; jc++) test_cells(c,jc);
+         }
+      }
+   });
+
+   // number the clusters in order of their root, i.e. lowest vertex
+   size_t ncluster = parent.label(remap);
+
+   // cluster positions are the average of the cluster vertices
+   welded.assign(ncluster,pos3d(0,0,0));
+   std::vector<uint32_t> count(ncluster,0);
+   for(size_t iv=0; iv<nv; iv++) {
+      uint32_t iv_new = remap[iv];
+      welded[iv_new] += poly.vertex(iv);
+      count[iv_new]++;
+   }
+   parallel_for(ncluster,m_nthreads,1<<16,[&welded,&count](size_t first, size_t last) {
+      for(size_t iv=first; iv<last; iv++) {
+         if(count[iv] > 1) welded[iv] /= double(count[iv]);
+      }
+   });
+
+   return nv - ncluster;
+}
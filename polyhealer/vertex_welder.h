@@ -0,0 +1,49 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef VERTEX_WELDER_H
+#define VERTEX_WELDER_H
+
+#include "polyhealer_config.h"
+
+#include "spacemath/polyhedron3d.h"
+#include <cstdint>
+#include <vector>
+using namespace spacemath;
+
+// vertex_welder merges polyhedron vertices closer to each other than a distance tolerance.
+// Vertices are sorted into a uniform grid with cells no smaller than the tolerance, and each
+// cell is compared with itself and its 13 forward neighbour cells, so every pair within tolerance
+// is tested exactly once. Matching pairs are joined in a lock-free union-find structure, which lets
+// all threads work on different parts of the grid at the same time. Clusters are transitive, i.e.
+// a chain of vertices each within tolerance of the next becomes one cluster.
+
+class POLYHEALER_PUBLIC vertex_welder {
+public:
+   // nthreads is the maximum number of threads to use, 0=all hardware threads
+   vertex_welder(double dtol, size_t nthreads = 0);
+   virtual ~vertex_welder();
+
+   // compute the welded vertices of poly. On return remap[iv_old]=iv_new, and welded contains the new vertices.
+   // New vertices are numbered in order of the lowest original vertex in each cluster,
+   // and positioned at the cluster average. Returns number of vertices removed
+   size_t weld(const polyhedron3d& poly, std::vector<uint32_t>& remap, vtx_vec& welded) const;
+
+private:
+   double m_dtol;      // distance tolerance
+   size_t m_nthreads;  // maximum number of threads
+};
+
+#endif // VERTEX_WELDER_H
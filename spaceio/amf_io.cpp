@@ -14,6 +14,7 @@
 // EndLicense:
    
 #include "amf_io.h"
+#include "polyhedron_builder.h"
 #include "xml_tree.h"
 #include <ctime>
 
@@ -32,6 +33,13 @@ bool amf_io::is_amf(const std::string& file_path)
 }
 
 std::shared_ptr<ph3d_vector> amf_io::read(const std::string& file_path)
+{
+   polyhedron_builder builder;
+   read(file_path,builder);
+   return builder.polyset();
+}
+
+void amf_io::read(const std::string& file_path, polyhedron_sink& sink)
 {
    boost::filesystem::path fullpath(file_path);
 
@@ -45,8 +53,6 @@ std::shared_ptr<ph3d_vector> amf_io::read(const std::string& file_path)
       throw logic_error(message);
    }
 
-   std::shared_ptr<ph3d_vector> polyset(new ph3d_vector);
-
    xml_tree tree;
    if(tree.read_xml(file_path)) {
       xml_node root;
@@ -60,11 +66,7 @@ std::shared_ptr<ph3d_vector> amf_io::read(const std::string& file_path)
             for(auto i=root.begin(); i!=root.end(); i++) {
                xml_node node(i);
                if(node.tag() == "object") {
-                   size_t file_id = node.get_property("id",-1);
-                   std::shared_ptr<polyhedron3d> poly = read_object(node,unit_factor);
-                   if(poly.get()) {
-                      polyset->push_back(poly);
-                   }
+                   read_object(node,unit_factor,sink);
                }
             }
          }
@@ -78,26 +80,24 @@ std::shared_ptr<ph3d_vector> amf_io::read(const std::string& file_path)
          throw logic_error(message);
       }
    }
-
-   return polyset;
 }
 
 
-std::shared_ptr<polyhedron3d> amf_io::read_object(xml_node& parent, double unit_factor)
+void amf_io::read_object(xml_node& parent, double unit_factor, polyhedron_sink& sink)
 {
-   vtx_vec   vert;
-   pface_vec faces;
+   vtx_vec                vert;
+   std::vector<id_vertex> index;
 
    // reserve some, does not matter if the number isn't right
    vert.reserve(1024);
-   faces.reserve(1024);
+   index.reserve(3*1024);
 
    xml_node mesh;
    if(parent.get_child("mesh",mesh)) {
       for(auto imesh=mesh.begin(); imesh!=mesh.end(); imesh++) {
          xml_node node(imesh);
          if(node.tag() == "vertices") read_vertices(node,vert);
-         if(node.tag() == "volume")   read_faces(node,faces);
+         if(node.tag() == "volume")   read_faces(node,index);
       }
    }
    else {
@@ -105,11 +105,17 @@ std::shared_ptr<polyhedron3d> amf_io::read_object(xml_node& parent, double unit_
       throw logic_error(message);
    }
 
-   if(vert.size()==0 || faces.size()==0) {
+   if(vert.size()==0 || index.size()==0) {
       throw logic_error("amf_io::read_object(...) zero vertices or faces found");
    }
 
-   return std::shared_ptr<polyhedron3d>(new polyhedron3d(vert,faces));
+   // AMF faces are always triangles
+   std::vector<size_t> face_size(index.size()/3,3);
+
+   sink.begin_polyhedron();
+   sink.add_vertices(&vert[0],vert.size());
+   sink.add_faces(&index[0],&face_size[0],face_size.size());
+   sink.end_polyhedron();
 }
 
 bool amf_io::read_vertices(xml_node& node, vtx_vec& vert)
@@ -135,7 +141,7 @@ bool amf_io::read_vertices(xml_node& node, vtx_vec& vert)
    return true;
 }
 
-bool amf_io::read_faces(xml_node& node, pface_vec& faces)
+bool amf_io::read_faces(xml_node& node, std::vector<id_vertex>& index)
 {
    for(auto i=node.begin(); i!=node.end(); i++) {
       xml_node child(i);
@@ -144,17 +150,14 @@ bool amf_io::read_faces(xml_node& node, pface_vec& faces)
          xml_node v1,v2,v3;
          if(child.get_child("v1",v1) && child.get_child("v2",v2) && child.get_child("v3",v3)) {
 
-            pface face;
-            face.reserve(3);
-            face.push_back(v1.get_value(0));
-            face.push_back(v2.get_value(0));
-            face.push_back(v3.get_value(0));
-            faces.push_back(face);
+            index.push_back(v1.get_value(0));
+            index.push_back(v2.get_value(0));
+            index.push_back(v3.get_value(0));
 
             ok_triangle = true;
          }
          if(!ok_triangle) {
-            string message = "amf_io::read_faces(...) error reading triangle with index = " + std::to_string(faces.size());
+            string message = "amf_io::read_faces(...) error reading triangle with index = " + std::to_string(index.size()/3);
             throw logic_error(message);
          }
       }
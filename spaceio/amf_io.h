@@ -17,6 +17,7 @@
 #define AMF_IO_H
 
 #include "spaceio_config.h"
+#include "polyhedron_sink.h"
 
 #include "spacemath/polyhedron3d.h"
 #include <memory>
@@ -37,6 +38,9 @@ public:
    // read from AMF, return as vector of polyhedra, one per AMF object
    static std::shared_ptr<ph3d_vector> read(const std::string& file_path);
 
+   // read from AMF, pass each AMF object to the sink as a polyhedron
+   static void read(const std::string& file_path, polyhedron_sink& sink);
+
    // write to AMF, return the path to the file created
    // input is full path to file, file extension will be replaced to ".amf"
    static std::string  write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path);
@@ -46,9 +50,9 @@ public:
 
 protected:
    static bool write_object(xml_node& parent, std::shared_ptr<ph3d_vector> polyset, size_t index);
-   static std::shared_ptr<polyhedron3d> read_object(xml_node& parent, double unit_factor);
+   static void read_object(xml_node& parent, double unit_factor, polyhedron_sink& sink);
    static bool read_vertices(xml_node& node, vtx_vec& vert);
-   static bool read_faces(xml_node& node, pface_vec& faces);
+   static bool read_faces(xml_node& node, std::vector<id_vertex>& index);
 };
 
 } // namespace spaceio
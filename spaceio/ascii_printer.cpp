@@ -0,0 +1,377 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "ascii_printer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+// Shortest round trip formatting of doubles using the Grisu2 algorithm:
+// Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010.
+// The structure follows the widely used implementation by Milo Yip (RapidJSON, MIT license).
+// Grisu2 output always reads back as the identical double, and is the shortest such
+// representation in the vast majority of cases.
+
+namespace spaceio {
+
+   // diy_fp represents the value f*2^e
+   struct diy_fp {
+      diy_fp() : f(0), e(0) {}
+      diy_fp(uint64_t f_, int e_) : f(f_), e(e_) {}
+
+      uint64_t f;
+      int      e;
+   };
+
+   static inline diy_fp subtract(const diy_fp& a, const diy_fp& b)
+   {
+      return diy_fp(a.f - b.f, a.e);
+   }
+
+   // upper 64 bits of the 128 bit product, rounded
+   static inline diy_fp multiply(const diy_fp& a, const diy_fp& b)
+   {
+      const uint64_t mask32 = 0xFFFFFFFF;
+      uint64_t ah = a.f >> 32, al = a.f & mask32;
+      uint64_t bh = b.f >> 32, bl = b.f & mask32;
+      uint64_t hh = ah*bh, lh = al*bh, hl = ah*bl, ll = al*bl;
+      uint64_t tmp = (ll >> 32) + (hl & mask32) + (lh & mask32);
+      tmp += uint64_t(1) << 31;
+      return diy_fp(hh + (hl >> 32) + (lh >> 32) + (tmp >> 32), a.e + b.e + 64);
+   }
+
+   static inline diy_fp normalize(diy_fp x)
+   {
+      while(!(x.f & 0xFFC0000000000000ULL)) { x.f <<= 10; x.e -= 10; }
+      while(!(x.f & 0x8000000000000000ULL)) { x.f <<= 1;  x.e -= 1;  }
+      return x;
+   }
+
+   // power10_table holds normalized 64 bit approximations of 10^k, k = -348 + 8*i, i = 0..86,
+   // correctly rounded. The values are computed exactly once using big integer arithmetic.
+   class power10_table {
+   public:
+      static const int first_exponent = -348;
+      static const int exponent_step  = 8;
+      static const int size           = 87;
+
+      power10_table()
+      {
+         for(int i=0; i<size; i++) m_power[i] = compute(first_exponent + i*exponent_step);
+      }
+
+      inline const diy_fp& operator[](size_t i) const { return m_power[i]; }
+
+   private:
+      typedef std::vector<uint32_t> bigint;   // little endian 32 bit words
+
+      static void multiply_small(bigint& a, uint32_t m)
+      {
+         uint64_t carry = 0;
+         for(size_t i=0; i<a.size(); i++) {
+            uint64_t t = uint64_t(a[i])*m + carry;
+            a[i]  = static_cast<uint32_t>(t);
+            carry = t >> 32;
+         }
+         if(carry) a.push_back(static_cast<uint32_t>(carry));
+      }
+
+      static void shift_left_1(bigint& a)
+      {
+         uint32_t carry = 0;
+         for(size_t i=0; i<a.size(); i++) {
+            uint32_t next = a[i] >> 31;
+            a[i]  = (a[i] << 1) | carry;
+            carry = next;
+         }
+         if(carry) a.push_back(carry);
+      }
+
+      static int compare(const bigint& a, const bigint& b)
+      {
+         size_t n = std::max(a.size(),b.size());
+         for(size_t i=n; i-- > 0; ) {
+            uint32_t ai = (i<a.size())? a[i] : 0;
+            uint32_t bi = (i<b.size())? b[i] : 0;
+            if(ai != bi) return (ai < bi)? -1 : 1;
+         }
+         return 0;
+      }
+
+      // a -= b, requires a >= b
+      static void subtract(bigint& a, const bigint& b)
+      {
+         int64_t borrow = 0;
+         for(size_t i=0; i<a.size(); i++) {
+            int64_t t = int64_t(a[i]) - ((i<b.size())? b[i] : 0) - borrow;
+            borrow = (t < 0)? 1 : 0;
+            a[i]   = static_cast<uint32_t>(t + (borrow << 32));
+         }
+      }
+
+      static int bit_length(const bigint& a)
+      {
+         for(size_t i=a.size(); i-- > 0; ) {
+            if(a[i]) {
+               int n = 0;
+               for(uint32_t w=a[i]; w; w>>=1) n++;
+               return static_cast<int>(i*32) + n;
+            }
+         }
+         return 0;
+      }
+
+      static bool bit(const bigint& a, int i)
+      {
+         return (i >= 0) && (a[i/32] >> (i%32)) & 1;
+      }
+
+      static diy_fp compute(int k)
+      {
+         bigint p(1,1);
+         for(int i=0; i<std::abs(k); i++) multiply_small(p,10);
+         int len = bit_length(p);
+
+         uint64_t f = 0;
+         int      e = 0;
+         bool     round_up = false;
+         if(k >= 0) {
+            // top 64 bits of 10^k
+            for(int i=1; i<=64; i++) f = (f << 1) | (bit(p,len-i)? 1 : 0);
+            round_up = bit(p,len-65);
+            e = len - 64;
+         }
+         else {
+            // 2^(len-1+64)/10^-k by binary long division, remainder starts at 2^(len-1) < 10^-k
+            bigint r((len+31)/32,0);
+            r[(len-1)/32] = uint32_t(1) << ((len-1)%32);
+            for(int i=0; i<65; i++) {
+               shift_left_1(r);
+               bool q = (compare(r,p) >= 0);
+               if(q) subtract(r,p);
+               if(i < 64) f = (f << 1) | (q? 1 : 0);
+               else round_up = q;
+            }
+            e = -(len + 63);
+         }
+         if(round_up && ++f == 0) {
+            f = uint64_t(1) << 63;
+            e++;
+         }
+         return diy_fp(f,e);
+      }
+
+   private:
+      diy_fp m_power[size];
+   };
+
+   // return cached power c = 10^-k such that the product with a number of binary exponent e
+   // gets its binary exponent in the range [-60,-32]
+   static inline diy_fp cached_power(int e, int& k)
+   {
+      static const power10_table table;
+
+      double dk = (-61 - e)*0.30102999566398114 + 347;
+      int ik = static_cast<int>(dk);
+      if(dk - ik > 0.0) ik++;
+      size_t index = static_cast<size_t>((ik >> 3) + 1);
+      k = -(power10_table::first_exponent + static_cast<int>(index)*power10_table::exponent_step);
+      return table[index];
+   }
+
+   static const uint64_t pow10_table[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+                                           10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+                                           100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+                                           100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+                                           100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL };
+
+   static inline void grisu_round(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+   {
+      while(rest < wp_w && delta - rest >= ten_kappa &&
+            (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+         buffer[len-1]--;
+         rest += ten_kappa;
+      }
+   }
+
+   static inline int count_decimal_digits(uint32_t n)
+   {
+      int count = 1;
+      while(count < 10 && n >= pow10_table[count]) count++;
+      return count;
+   }
+
+   // generate the shortest digits of W within the interval (Mp-delta,Mp), value = digits*10^k
+   static inline void digit_gen(const diy_fp& W, const diy_fp& Mp, uint64_t delta, char* buffer, int& len, int& k)
+   {
+      const diy_fp one(uint64_t(1) << -Mp.e, Mp.e);
+      const diy_fp wp_w = subtract(Mp,W);
+      uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
+      uint64_t p2 = Mp.f & (one.f - 1);
+      int kappa = count_decimal_digits(p1);
+      len = 0;
+
+      while(kappa > 0) {
+         uint32_t div = static_cast<uint32_t>(pow10_table[kappa-1]);
+         uint32_t d   = p1/div;
+         p1 %= div;
+         if(d || len) buffer[len++] = static_cast<char>('0' + d);
+         kappa--;
+         uint64_t tmp = (static_cast<uint64_t>(p1) << -one.e) + p2;
+         if(tmp <= delta) {
+            k += kappa;
+            grisu_round(buffer,len,delta,tmp,pow10_table[kappa] << -one.e,wp_w.f);
+            return;
+         }
+      }
+
+      for(;;) {
+         p2    *= 10;
+         delta *= 10;
+         char d = static_cast<char>(p2 >> -one.e);
+         if(d || len) buffer[len++] = static_cast<char>('0' + d);
+         p2 &= one.f - 1;
+         kappa--;
+         if(p2 < delta) {
+            k += kappa;
+            int index = -kappa;
+            grisu_round(buffer,len,delta,p2,one.f,(index < 20)? wp_w.f*pow10_table[index] : 0);
+            return;
+         }
+      }
+   }
+
+   // shortest digits of positive, finite, non-zero value: value = digits*10^k
+   static inline void grisu2(double value, char* buffer, int& len, int& k)
+   {
+      const uint64_t hidden_bit = uint64_t(1) << 52;
+      uint64_t bits = 0;
+      std::memcpy(&bits,&value,sizeof(bits));
+      int      biased_e    = static_cast<int>((bits >> 52) & 0x7FF);
+      uint64_t significand = bits & (hidden_bit - 1);
+
+      diy_fp v = (biased_e)? diy_fp(significand + hidden_bit, biased_e - 1075) : diy_fp(significand, -1074);
+
+      // boundaries halfway to the neighbouring doubles, the lower one is closer at powers of 2
+      diy_fp plus  = normalize(diy_fp((v.f << 1) + 1, v.e - 1));
+      diy_fp minus = (v.f == hidden_bit && biased_e > 1)? diy_fp((v.f << 2) - 1, v.e - 2) : diy_fp((v.f << 1) - 1, v.e - 1);
+      minus.f <<= minus.e - plus.e;
+      minus.e   = plus.e;
+
+      const diy_fp c = cached_power(plus.e,k);
+      const diy_fp W = multiply(normalize(v),c);
+      diy_fp Wp = multiply(plus,c);
+      diy_fp Wm = multiply(minus,c);
+      Wm.f++;
+      Wp.f--;
+      digit_gen(W,Wp,Wp.f - Wm.f,buffer,len,k);
+   }
+
+   // write digits*10^k in %g style notation, return number of characters written
+   static inline size_t write_decimal(char* buf, const char* digits, int len, int k)
+   {
+      char* p = buf;
+      int kk = len + k;  // position of decimal point relative to first digit
+      if(kk > -4 && kk <= 17) {
+         if(kk >= len) {
+            // 1234e2 -> 123400
+            std::memcpy(p,digits,len);    p += len;
+            for(int i=len; i<kk; i++) *p++ = '0';
+         }
+         else if(kk > 0) {
+            // 1234e-2 -> 12.34
+            std::memcpy(p,digits,kk);     p += kk;
+            *p++ = '.';
+            std::memcpy(p,digits+kk,len-kk); p += len-kk;
+         }
+         else {
+            // 1234e-6 -> 0.001234
+            *p++ = '0';
+            *p++ = '.';
+            for(int i=kk; i<0; i++) *p++ = '0';
+            std::memcpy(p,digits,len);    p += len;
+         }
+      }
+      else {
+         // 1234e30 -> 1.234e+33
+         *p++ = digits[0];
+         if(len > 1) {
+            *p++ = '.';
+            std::memcpy(p,digits+1,len-1); p += len-1;
+         }
+         int exp10 = kk - 1;
+         *p++ = 'e';
+         *p++ = (exp10 < 0)? '-' : '+';
+         if(exp10 < 0) exp10 = -exp10;
+         if(exp10 >= 100) *p++ = static_cast<char>('0' + exp10/100);
+         *p++ = static_cast<char>('0' + (exp10/10)%10);
+         *p++ = static_cast<char>('0' + exp10%10);
+      }
+      return p - buf;
+   }
+
+   size_t ascii_printer::format_double(char* buf, double value, int precision)
+   {
+      char* p = buf;
+      uint64_t bits = 0;
+      std::memcpy(&bits,&value,sizeof(bits));
+      if(bits >> 63) *p++ = '-';
+
+      if(value != value) {
+         std::memcpy(buf,"nan",3);
+         return 3;
+      }
+      if(value == 0.0) {
+         *p++ = '0';
+         return p - buf;
+      }
+      if(value-value != 0.0) {
+         std::memcpy(p,"inf",3);
+         return p - buf + 3;
+      }
+
+      char digits[20];
+      int len = 0;
+      int k   = 0;
+      double magnitude = (value < 0.0)? -value : value;
+      if(precision > 0 && precision < 17) {
+         // correctly rounded to the requested number of significant digits in a single step.
+         // Rounding the shortest digits again could round twice, e.g. 0.1449999999999999956 -> 0.145 -> 0.15.
+         // Only the digits and the exponent are taken from printf, so the locale's decimal point does not matter
+         char tmp[40];
+         std::snprintf(tmp,sizeof(tmp),"%.*e",precision-1,magnitude);
+         const char* c = tmp;
+         for(; *c && *c != 'e'; c++) {
+            if(*c >= '0' && *c <= '9') digits[len++] = *c;
+         }
+         k = std::atoi(c+1) - (len-1);
+      }
+      else {
+         grisu2(magnitude,digits,len,k);
+      }
+
+      // remove trailing zeros
+      while(len > 1 && digits[len-1] == '0') {
+         len--;
+         k++;
+      }
+
+      return (p - buf) + write_decimal(p,digits,len,k);
+   }
+
+} // namespace spaceio
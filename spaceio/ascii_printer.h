@@ -0,0 +1,87 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef ASCII_PRINTER_H
+#define ASCII_PRINTER_H
+
+#include "buffered_output_file.h"
+#include <cstring>
+
+namespace spaceio {
+
+// ascii_printer formats text and numbers directly into a buffered_output_file, without iostreams.
+// With precision 0, floating point values are written using the shortest representation
+// that reads back as the identical double. Otherwise precision limits the number of significant digits.
+// The output does not depend on the current locale.
+
+class ascii_printer {
+public:
+   ascii_printer(buffered_output_file& out, int precision = 0) : m_out(out), m_precision(precision) {}
+
+   inline ascii_printer& text(const char* s)
+   {
+      m_out.write(s,std::strlen(s));
+      return *this;
+   }
+
+   inline ascii_printer& character(char c)
+   {
+      *m_out.reserve(1) = c;
+      m_out.commit(1);
+      return *this;
+   }
+
+   inline ascii_printer& integer(unsigned long long value)
+   {
+      m_out.commit(format_integer(m_out.reserve(max_length),value));
+      return *this;
+   }
+
+   inline ascii_printer& real(double value) { return real(value,m_precision); }
+
+   inline ascii_printer& real(double value, int precision)
+   {
+      m_out.commit(format_double(m_out.reserve(max_length),value,precision));
+      return *this;
+   }
+
+   // maximum number of characters written by format_integer and format_double
+   static const size_t max_length = 32;
+
+   // format unsigned integer into buf, return number of characters written
+   static size_t format_integer(char* buf, unsigned long long value)
+   {
+      char digits[24];
+      size_t n = 0;
+      do {
+         digits[n++] = static_cast<char>('0' + value%10);
+         value /= 10;
+      } while(value > 0);
+      for(size_t i=0; i<n; i++) buf[i] = digits[n-1-i];
+      return n;
+   }
+
+   // format double into buf, return number of characters written.
+   // precision 0 means shortest round trip representation, otherwise max significant digits (max 17)
+   static size_t format_double(char* buf, double value, int precision);
+
+private:
+   buffered_output_file& m_out;
+   int                   m_precision;
+};
+
+} // namespace spaceio
+
+#endif // ASCII_PRINTER_H
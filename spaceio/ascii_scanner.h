@@ -0,0 +1,230 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef ASCII_SCANNER_H
+#define ASCII_SCANNER_H
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <stdint.h>
+
+namespace spaceio {
+
+// ascii_scanner is a simple tokenizer for ASCII mesh formats (STL, OBJ, OFF),
+// scanning a memory buffer [begin,end) directly, i.e. without std::getline or std::istringstream.
+// Tokens are separated by whitespace. The buffer is not required to be zero terminated.
+
+class ascii_scanner {
+public:
+   ascii_scanner(const char* begin, const char* end) : m_begin(begin), m_pos(begin), m_end(end) {}
+
+   // current position in the buffer
+   inline const char* pos() const      { return m_pos; }
+   inline void set_pos(const char* pos) { m_pos = pos; }
+
+   // skip all whitespace including line breaks, return false if the end was reached
+   inline bool skip_space()
+   {
+      while(m_pos<m_end && is_space(*m_pos)) m_pos++;
+      return m_pos<m_end;
+   }
+
+   // skip spaces and tabs, but stop at line breaks. Return false at end of line or end of buffer
+   inline bool skip_blanks()
+   {
+      while(m_pos<m_end && (*m_pos==' ' || *m_pos=='\t' || *m_pos=='\r')) m_pos++;
+      return (m_pos<m_end) && (*m_pos!='\n');
+   }
+
+   // skip to the start of the next line
+   inline void skip_line()
+   {
+      const char* eol = static_cast<const char*>(std::memchr(m_pos,'\n',m_end-m_pos));
+      m_pos = (eol)? eol+1 : m_end;
+   }
+
+   // skip the remainder of the current token
+   inline void skip_token()
+   {
+      while(m_pos<m_end && !is_space(*m_pos)) m_pos++;
+   }
+
+   // return next whitespace separated token as [tb,te), false if no more tokens
+   inline bool next_token(const char*& tb, const char*& te)
+   {
+      if(!skip_space()) return false;
+      tb = m_pos;
+      while(m_pos<m_end && !is_space(*m_pos)) m_pos++;
+      te = m_pos;
+      return true;
+   }
+
+   // consume the next token if it matches the keyword (case insensitive), return true if matched
+   inline bool keyword(const char* kw)
+   {
+      const char* save = m_pos;
+      const char* tb = 0;
+      const char* te = 0;
+      if(next_token(tb,te) && equal(tb,te,kw)) return true;
+      m_pos = save;
+      return false;
+   }
+
+   // read a floating point number, return false if not a valid number
+   inline bool read_double(double& value)
+   {
+      if(!skip_space()) return false;
+      const char* p = parse_double(m_pos,m_end,value);
+      if(!p) return false;
+      m_pos = p;
+      return true;
+   }
+
+   // read a signed integer, stopping at the first non-digit. Return false if no digits found
+   inline bool read_integer(long long& value)
+   {
+      if(!skip_space()) return false;
+      const char* p = m_pos;
+      bool neg = false;
+      if(p<m_end && (*p=='-' || *p=='+')) neg = (*p++ == '-');
+      const char* digits = p;
+      long long v = 0;
+      while(p<m_end && is_digit(*p)) v = v*10 + (*p++ - '0');
+      if(p == digits) return false;
+      value = (neg)? -v : v;
+      m_pos = p;
+      return true;
+   }
+
+   // return the 1-based line number of the current position, for error messages
+   size_t line_number() const
+   {
+      size_t line = 1;
+      for(const char* p=m_begin; p<m_pos; p++) if(*p=='\n') line++;
+      return line;
+   }
+
+   // return the next token as a string without consuming it, for error messages
+   std::string peek_token() const
+   {
+      ascii_scanner tmp(*this);
+      const char* tb = 0;
+      const char* te = 0;
+      if(tmp.next_token(tb,te)) return std::string(tb,te);
+      return "<end of file>";
+   }
+
+   // case insensitive comparison of token [tb,te) with zero terminated keyword
+   static inline bool equal(const char* tb, const char* te, const char* kw)
+   {
+      for(; tb<te; tb++, kw++) {
+         if(*kw == 0) return false;
+         char c = *tb;
+         if(c>='A' && c<='Z') c += 'a'-'A';
+         if(c != *kw) return false;
+      }
+      return (*kw == 0);
+   }
+
+   static inline bool is_space(char c) { return c==' ' || c=='\n' || c=='\r' || c=='\t' || c=='\f' || c=='\v'; }
+   static inline bool is_digit(char c) { return c>='0' && c<='9'; }
+
+   // parse a floating point number starting at p, return pointer past the number or 0 if invalid.
+   // The number must be followed by whitespace or end of buffer.
+   // Numbers with up to 19 significant digits and moderate exponents are converted exactly
+   // using the fast path (mantissa*10^exp in double precision, see Clinger 1990),
+   // everything else is passed to strtod.
+   static const char* parse_double(const char* p, const char* end, double& value)
+   {
+      static const double pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                      1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                      1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+      const char* start = p;
+      bool neg = false;
+      if(p<end && (*p=='-' || *p=='+')) neg = (*p++ == '-');
+
+      uint64_t mant = 0;
+      int  ndigits  = 0;     // significant digits in mant
+      int  exp10    = 0;     // decimal exponent to apply to mant
+      bool any      = false; // at least one digit seen
+      bool exact    = true;  // false if digits were dropped
+
+      for(; p<end && is_digit(*p); p++) {
+         any = true;
+         if(ndigits < 19) {
+            mant = mant*10 + (*p-'0');
+            if(mant > 0) ndigits++;
+         }
+         else {
+            exp10++;
+            if(*p != '0') exact = false;
+         }
+      }
+      if(p<end && *p=='.') {
+         for(p++; p<end && is_digit(*p); p++) {
+            any = true;
+            if(ndigits < 19) {
+               mant = mant*10 + (*p-'0');
+               if(mant > 0) ndigits++;
+               exp10--;
+            }
+            else if(*p != '0') exact = false;
+         }
+      }
+      if(any && p<end && (*p=='e' || *p=='E')) {
+         const char* q = p+1;
+         bool eneg = false;
+         if(q<end && (*q=='-' || *q=='+')) eneg = (*q++ == '-');
+         if(q<end && is_digit(*q)) {
+            int e = 0;
+            for(; q<end && is_digit(*q); q++) if(e < 10000) e = e*10 + (*q-'0');
+            exp10 += (eneg)? -e : e;
+            p = q;
+         }
+      }
+
+      if(any && (p==end || is_space(*p))) {
+         if(mant == 0) {
+            value = (neg)? -0.0 : 0.0;
+            return p;
+         }
+         if(exact && mant <= (uint64_t(1)<<53) && exp10 >= -22 && exp10 <= 22) {
+            double v = static_cast<double>(mant);
+            v = (exp10 < 0)? v/pow10[-exp10] : v*pow10[exp10];
+            value = (neg)? -v : v;
+            return p;
+         }
+      }
+
+      // slow path: anything not handled above, including nan, inf and long mantissas
+      const char* te = start;
+      while(te<end && !is_space(*te)) te++;
+      std::string token(start,te);
+      char* tend = 0;
+      value = std::strtod(token.c_str(),&tend);
+      if(token.empty() || tend != token.c_str()+token.size()) return 0;
+      return te;
+   }
+
+private:
+   const char* m_begin;
+   const char* m_pos;
+   const char* m_end;
+};
+
+} // namespace spaceio
+
+#endif // ASCII_SCANNER_H
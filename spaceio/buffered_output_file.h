@@ -0,0 +1,101 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef BUFFERED_OUTPUT_FILE_H
+#define BUFFERED_OUTPUT_FILE_H
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace spaceio {
+
+// buffered_output_file collects output in a large memory buffer and writes it to the file
+// in big blocks, so writers can serialize small records without per-record I/O calls.
+// close() must be called to complete the file, errors are reported as logic_error.
+
+class buffered_output_file {
+public:
+   // open the file for binary writing, throw logic_error on failure. caller is used in error messages
+   buffered_output_file(const std::string& file_path, const std::string& caller, size_t capacity = size_t(8)<<20)
+   : m_path(file_path), m_caller(caller), m_file(std::fopen(file_path.c_str(),"wb")), m_buffer(capacity), m_used(0)
+   {
+      if(!m_file) throw std::logic_error(m_caller + "  Failed to open: " + m_path);
+   }
+
+   buffered_output_file(const buffered_output_file&) = delete;
+   buffered_output_file& operator=(const buffered_output_file&) = delete;
+
+   // an unclosed file is closed without reporting errors
+   ~buffered_output_file()
+   {
+      if(m_file) std::fclose(m_file);
+   }
+
+   // return pointer to at least n bytes of free buffer space, use commit() to accept what was written
+   inline char* reserve(size_t n)
+   {
+      if(m_used+n > m_buffer.size()) {
+         flush();
+         if(n > m_buffer.size()) m_buffer.resize(n);
+      }
+      return &m_buffer[m_used];
+   }
+
+   // accept n bytes written after reserve()
+   inline void commit(size_t n) { m_used += n; }
+
+   // append n bytes to the buffer
+   inline void write(const void* data, size_t n)
+   {
+      std::memcpy(reserve(n),data,n);
+      commit(n);
+   }
+
+   inline void write(const std::string& text) { write(text.data(),text.size()); }
+
+   // write the buffer contents to file
+   void flush()
+   {
+      if(m_used > 0) {
+         if(std::fwrite(&m_buffer[0],1,m_used,m_file) != m_used) {
+            throw std::logic_error(m_caller + "  Failed to write: " + m_path);
+         }
+         m_used = 0;
+      }
+   }
+
+   // flush remaining data and close the file
+   void close()
+   {
+      flush();
+      std::FILE* file = m_file;
+      m_file = 0;
+      if(std::fclose(file) != 0) throw std::logic_error(m_caller + "  Failed to write: " + m_path);
+   }
+
+private:
+   std::string       m_path;
+   std::string       m_caller;
+   std::FILE*        m_file;
+   std::vector<char> m_buffer;
+   size_t            m_used;
+};
+
+} // namespace spaceio
+
+#endif // BUFFERED_OUTPUT_FILE_H
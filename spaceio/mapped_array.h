@@ -0,0 +1,137 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef MAPPED_ARRAY_H
+#define MAPPED_ARRAY_H
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace spaceio {
+
+// mapped_array is a growable array of plain data elements (no constructors or destructors are run),
+// stored in a memory mapped temporary file rather than on the heap. The operating system keeps only the
+// recently used parts resident, so arrays much larger than physical memory can be used.
+// The temporary file is removed when the array is destroyed.
+
+template <class T>
+class mapped_array {
+public:
+   // create an empty array backed by a new temporary file in temp_dir, or in the system temporary directory if empty
+   explicit mapped_array(const std::string& temp_dir = "")
+   : m_data(0), m_size(0), m_capacity(0)
+   {
+      namespace fs = boost::filesystem;
+      fs::path dir = (temp_dir.empty())? fs::temp_directory_path() : fs::path(temp_dir);
+      m_path = (dir / fs::unique_path("spaceio-%%%%-%%%%-%%%%-%%%%.tmp")).string();
+      std::FILE* file = std::fopen(m_path.c_str(),"wb");
+      if(!file) throw std::logic_error("mapped_array  Failed to create temporary file: " + m_path);
+      std::fclose(file);
+   }
+
+   mapped_array(const mapped_array&) = delete;
+   mapped_array& operator=(const mapped_array&) = delete;
+
+   ~mapped_array()
+   {
+      unmap();
+      boost::system::error_code ec;
+      boost::filesystem::remove(m_path,ec);
+   }
+
+   inline size_t   size() const                  { return m_size; }
+   inline bool     empty() const                 { return m_size == 0; }
+   inline T*       data()                        { return m_data; }
+   inline const T* data() const                  { return m_data; }
+   inline T*       begin()                       { return m_data; }
+   inline T*       end()                         { return m_data + m_size; }
+   inline const T* begin() const                 { return m_data; }
+   inline const T* end() const                   { return m_data + m_size; }
+   inline T&       operator[](size_t i)          { return m_data[i]; }
+   inline const T& operator[](size_t i) const    { return m_data[i]; }
+
+   // make room for n elements, the file grows at least by doubling
+   void reserve(size_t n)
+   {
+      if(n <= m_capacity) return;
+
+      const size_t min_capacity = (size_t(1)<<20)/sizeof(T) + 1;
+      size_t capacity = std::max(n,std::max(2*m_capacity,min_capacity));
+
+      // the file cannot be resized while mapped on all platforms, so it is remapped
+      using namespace boost::interprocess;
+      unmap();
+      try {
+         boost::filesystem::resize_file(m_path,capacity*sizeof(T));
+         file_mapping(m_path.c_str(),read_write).swap(m_mapping);
+         mapped_region(m_mapping,read_write).swap(m_region);
+      }
+      catch(std::exception& ex) {
+         throw std::logic_error("mapped_array  Failed to map temporary file: " + m_path + " (" + ex.what() + ")");
+      }
+      m_data     = static_cast<T*>(m_region.get_address());
+      m_capacity = capacity;
+   }
+
+   // change the number of elements, new elements are zero filled
+   void resize(size_t n)
+   {
+      reserve(n);
+      if(n > m_size) std::memset(static_cast<void*>(m_data+m_size),0,(n-m_size)*sizeof(T));
+      m_size = n;
+   }
+
+   inline void push_back(const T& value)
+   {
+      if(m_size == m_capacity) reserve(m_size+1);
+      m_data[m_size++] = value;
+   }
+
+   void append(const T* values, size_t n)
+   {
+      reserve(m_size+n);
+      std::memcpy(static_cast<void*>(m_data+m_size),values,n*sizeof(T));
+      m_size += n;
+   }
+
+   // remove all elements, the file keeps its size
+   inline void clear() { m_size = 0; }
+
+private:
+   void unmap()
+   {
+      boost::interprocess::mapped_region().swap(m_region);
+      boost::interprocess::file_mapping().swap(m_mapping);
+      m_data = 0;
+   }
+
+private:
+   std::string                         m_path;      // temporary file
+   boost::interprocess::file_mapping   m_mapping;
+   boost::interprocess::mapped_region  m_region;
+   T*                                  m_data;
+   size_t                              m_size;      // number of elements in use
+   size_t                              m_capacity;  // number of elements mapped
+};
+
+} // namespace spaceio
+
+#endif // MAPPED_ARRAY_H
@@ -0,0 +1,66 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef MAPPED_INPUT_FILE_H
+#define MAPPED_INPUT_FILE_H
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <stdexcept>
+#include <string>
+
+namespace spaceio {
+
+// mapped_input_file maps a whole file read-only into memory, so readers
+// can decode it directly without intermediate copies or per-record I/O calls.
+// The file contents are available as the range [begin(),end()) while the object lives.
+
+class mapped_input_file {
+public:
+   // map the file, throw logic_error on failure. caller is used in error messages
+   mapped_input_file(const std::string& file_path, const std::string& caller)
+   : m_data(0), m_size(0)
+   {
+      using namespace boost::interprocess;
+      try {
+         file_mapping(file_path.c_str(),read_only).swap(m_mapping);
+
+         // an empty file cannot be mapped, it is simply left as an empty range
+         if(boost::filesystem::file_size(file_path) > 0) {
+            mapped_region(m_mapping,read_only).swap(m_region);
+            m_data = static_cast<const char*>(m_region.get_address());
+            m_size = m_region.get_size();
+         }
+      }
+      catch(interprocess_exception& ex) {
+         throw std::logic_error(caller + "  Failed to open: " + file_path + " (" + ex.what() + ")");
+      }
+   }
+
+   inline const char* begin() const { return m_data; }
+   inline const char* end() const   { return m_data + m_size; }
+   inline size_t      size() const  { return m_size; }
+
+private:
+   boost::interprocess::file_mapping  m_mapping;
+   boost::interprocess::mapped_region m_region;
+   const char*                        m_data;
+   size_t                             m_size;
+};
+
+} // namespace spaceio
+
+#endif // MAPPED_INPUT_FILE_H
@@ -0,0 +1,183 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "mapped_mesh.h"
+#include "spacemath/polygon_normal.h"
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+namespace spaceio {
+
+   // coordinate bits mapped so that unsigned integer order is the numeric order of the coordinates.
+   // -0.0 is mapped as +0.0 and all NaNs to one value after +infinity, so corrupt input still gives a total order
+   static inline uint64_t order_bits(double v)
+   {
+      const uint64_t sign_bit = uint64_t(1) << 63;
+      if(v != v) return ~uint64_t(0);
+      v += 0.0;
+      uint64_t b;
+      std::memcpy(&b,&v,sizeof(b));
+      return (b & sign_bit)? ~b : (b | sign_bit);
+   }
+
+   // sort key for merging vertices, ties are broken by vertex index so the first vertex represents the group
+   struct vertex_key {
+      uint64_t  x,y,z;
+      id_vertex iv;
+
+      // vertices with NaN coordinates are never merged
+      inline bool same_position(const vertex_key& other) const
+      {
+         return x==other.x && y==other.y && z==other.z && x!=~uint64_t(0) && y!=~uint64_t(0) && z!=~uint64_t(0);
+      }
+
+      inline bool operator<(const vertex_key& other) const
+      {
+         if(x != other.x) return x < other.x;
+         if(y != other.y) return y < other.y;
+         if(z != other.z) return z < other.z;
+         return iv < other.iv;
+      }
+   };
+
+   mapped_mesh::mapped_mesh(const std::string& temp_dir)
+   : m_temp_dir(temp_dir)
+   , m_vert(temp_dir)
+   , m_index(temp_dir)
+   , m_face_end(temp_dir)
+   , m_vert_offset(0)
+   {}
+
+   mapped_mesh::~mapped_mesh()
+   {}
+
+   void mapped_mesh::begin_polyhedron()
+   {
+      m_vert_offset = m_vert.size();
+   }
+
+   void mapped_mesh::reserve(size_t nvert, size_t nface)
+   {
+      m_vert.reserve(m_vert.size()+nvert);
+      m_face_end.reserve(m_face_end.size()+nface);
+   }
+
+   void mapped_mesh::add_vertices(const spacemath::pos3d* vert, size_t nvert)
+   {
+      m_vert.append(vert,nvert);
+   }
+
+   void mapped_mesh::add_faces(const id_vertex* index, const size_t* face_size, size_t nface)
+   {
+      size_t nindex = 0;
+      for(size_t iface=0; iface<nface; iface++) nindex += face_size[iface];
+
+      size_t first = m_index.size();
+      m_index.resize(first+nindex);
+      id_vertex* dest = m_index.data()+first;
+      for(size_t i=0; i<nindex; i++) dest[i] = index[i] + m_vert_offset;
+
+      m_face_end.reserve(m_face_end.size()+nface);
+      for(size_t iface=0; iface<nface; iface++) {
+         first += face_size[iface];
+         m_face_end.push_back(first);
+      }
+   }
+
+   spacemath::vec3d mapped_mesh::face_normal(id_face iface) const
+   {
+      return spacemath::polygon_normal(*this,face(iface));
+   }
+
+   size_t mapped_mesh::merge_vertices()
+   {
+      const size_t nvert = m_vert.size();
+
+      // The vertex positions are sorted as self-contained keys instead of sorting indices,
+      // so the sort only scans the key file and does not jump around in the vertex file.
+      // The remap table is built in a second mapped file, only the arrays being scanned need to be resident.
+      mapped_array<id_vertex> remap(m_temp_dir);
+      {
+         mapped_array<vertex_key> keys(m_temp_dir);
+         keys.resize(nvert);
+         for(size_t iv=0; iv<nvert; iv++) {
+            const spacemath::pos3d& p = m_vert[iv];
+            vertex_key& key = keys[iv];
+            key.x = order_bits(p.x()); key.y = order_bits(p.y()); key.z = order_bits(p.z());
+            key.iv = iv;
+         }
+         std::sort(keys.begin(),keys.end());
+
+         // first let each vertex refer to the lowest index vertex at the same position
+         remap.resize(nvert);
+         for(size_t i=0; i<nvert; ) {
+            size_t j = i;
+            for(; j<nvert && keys[j].same_position(keys[i]); j++) remap[keys[j].iv] = keys[i].iv;
+            i = j;
+         }
+      }
+
+      // compact the vertices in their original order, representatives always precede the vertices they replace
+      size_t nkeep = 0;
+      for(size_t iv=0; iv<nvert; iv++) {
+         if(remap[iv] == iv) {
+            m_vert[nkeep] = m_vert[iv];
+            remap[iv]     = nkeep++;
+         }
+         else {
+            remap[iv] = remap[remap[iv]];
+         }
+      }
+      m_vert.resize(nkeep);
+
+      // renumber the faces, dropping repeated vertices and faces left with less than 3 vertices
+      const size_t nface = m_face_end.size();
+      size_t first  = 0;
+      size_t nindex = 0;
+      size_t nface_keep = 0;
+      for(size_t iface=0; iface<nface; iface++) {
+         size_t face_begin = nindex;
+         size_t last = m_face_end[iface];
+         for(size_t i=first; i<last; i++) {
+            id_vertex iv = remap[m_index[i]];
+            if(nindex == face_begin || m_index[nindex-1] != iv) m_index[nindex++] = iv;
+         }
+         while(nindex-face_begin > 1 && m_index[nindex-1] == m_index[face_begin]) nindex--;
+         first = last;
+
+         if(nindex-face_begin < 3) nindex = face_begin;
+         else                      m_face_end[nface_keep++] = nindex;
+      }
+      m_index.resize(nindex);
+      m_face_end.resize(nface_keep);
+      m_vert_offset = 0;
+
+      return nvert - nkeep;
+   }
+
+   std::shared_ptr<spacemath::polyhedron3d> mapped_mesh::create_polyhedron() const
+   {
+      vtx_vec vert(m_vert.begin(),m_vert.end());
+      pface_vec faces;
+      faces.reserve(face_size());
+      for(id_face iface=0; iface<face_size(); iface++) {
+         mapped_face face = this->face(iface);
+         faces.emplace_back(face.begin(),face.end());
+      }
+      return std::make_shared<spacemath::polyhedron3d>(std::move(vert),std::move(faces));
+   }
+
+} // namespace spaceio
@@ -0,0 +1,96 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef MAPPED_MESH_H
+#define MAPPED_MESH_H
+
+#include "polyhedron_sink.h"
+#include "mapped_array.h"
+#include <memory>
+
+namespace spaceio {
+
+// mapped_face is a read-only view of the vertex indices of one mapped_mesh face
+class mapped_face {
+public:
+   mapped_face(const id_vertex* first, size_t size) : m_first(first), m_size(size) {}
+
+   inline size_t           size() const                { return m_size; }
+   inline const id_vertex* begin() const               { return m_first; }
+   inline const id_vertex* end() const                 { return m_first + m_size; }
+   inline id_vertex        operator[](size_t i) const  { return m_first[i]; }
+
+private:
+   const id_vertex* m_first;
+   size_t           m_size;
+};
+
+// mapped_mesh is an out-of-core polyhedron: vertices and faces are kept in memory mapped
+// temporary files (see mapped_array), so meshes larger than physical memory can be read,
+// have their vertices merged and be written with a bounded resident memory footprint.
+//
+// It is a polyhedron_sink, so any streaming reader can fill it:
+//
+//    mapped_mesh mesh;
+//    polyhedron_io::read(path,mesh);
+//    mesh.merge_vertices();
+//    stl_io::write(mesh,out_path);
+//
+// All received polyhedra are appended to the same mesh. Read without read_options::weld_vertices(),
+// welding while reading keeps all unique vertices in memory; merge_vertices() does the same out-of-core.
+
+class SPACEIO_PUBLIC mapped_mesh : public polyhedron_sink {
+public:
+   // temporary files are created in temp_dir, or in the system temporary directory if empty
+   explicit mapped_mesh(const std::string& temp_dir = "");
+   virtual ~mapped_mesh();
+
+   // polyhedron_sink interface
+   virtual void begin_polyhedron();
+   virtual void reserve(size_t nvert, size_t nface);
+   virtual void add_vertices(const spacemath::pos3d* vert, size_t nvert);
+   virtual void add_faces(const id_vertex* index, const size_t* face_size, size_t nface);
+
+   inline size_t                  vertex_size() const           { return m_vert.size(); }
+   inline const spacemath::pos3d& vertex(id_vertex iv) const    { return m_vert[iv]; }
+
+   inline size_t                  face_size() const             { return m_face_end.size(); }
+   inline mapped_face             face(id_face iface) const
+   {
+      size_t first = (iface > 0)? m_face_end[iface-1] : 0;
+      return mapped_face(m_index.data()+first,m_face_end[iface]-first);
+   }
+
+   // face normal, length equal to twice the face area
+   spacemath::vec3d face_normal(id_face iface) const;
+
+   // merge vertices with identical coordinates and remove faces degenerated by it,
+   // returns the number of vertices removed
+   size_t merge_vertices();
+
+   // copy the mesh into an in-memory polyhedron
+   std::shared_ptr<spacemath::polyhedron3d> create_polyhedron() const;
+
+private:
+   std::string                    m_temp_dir;
+   mapped_array<spacemath::pos3d> m_vert;         // vertex coordinates
+   mapped_array<id_vertex>        m_index;        // vertex indices of all faces, concatenated
+   mapped_array<size_t>           m_face_end;     // end of each face in m_index
+   size_t                         m_vert_offset;  // first vertex of current polyhedron
+};
+
+} // namespace spaceio
+
+#endif // MAPPED_MESH_H
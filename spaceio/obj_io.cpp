@@ -14,59 +14,92 @@
 // EndLicense:
 
 #include "obj_io.h"
+#include "polyhedron_builder.h"
+#include "mapped_input_file.h"
+#include "ascii_scanner.h"
+#include "buffered_output_file.h"
+#include "ascii_printer.h"
+#include "spacemath/parallel_for.h"
 #include <boost/filesystem.hpp>
-#include <boost/lexical_cast.hpp>
-#include <fstream>
-#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
 
 namespace spaceio {
 
-   static void tokenize(const std::string& input,
-                        const std::string& delimiters,
-                        std::vector<std::string>& tokens)
-   {
-      using namespace std;
-      string::size_type last_pos = 0;
-      string::size_type pos = 0;
-      while(true) {
-         pos = input.find_first_of(delimiters, last_pos);
-         if( pos == string::npos ) {
-            if(input.length()-last_pos > 0)tokens.push_back(input.substr(last_pos));
-            break;
-         }
-         else {
-            if(pos-last_pos > 0)tokens.push_back(input.substr(last_pos, pos - last_pos));
-            last_pos = pos + 1;
-         }
+   // obj_chunk holds vertices and faces parsed from one part of an OBJ file.
+   // Absolute vertex indices are stored 0-based. Relative (negative) indices refer to vertices
+   // counted from the end of the chunk so far, they are stored as local index minus relative_bias
+   // and resolved when the vertex offset of the chunk is known.
+   struct obj_chunk {
+      static const long long relative_bias = 1LL<<62;
+
+      vtx_vec                 vert;    // vertices defined in this chunk
+      std::vector<long long>  index;   // face vertex indices, all faces concatenated
+      std::vector<size_t>     nvface;  // number of vertices in each face
+
+      void clear()
+      {
+         vert.clear();
+         index.clear();
+         nvface.clear();
       }
-   }
+   };
 
-   static pface read_face(const std::string& input)
+   static void read_chunk(ascii_scanner& in, obj_chunk& chunk)
    {
       // https://en.wikipedia.org/wiki/Wavefront_.obj_file
+      // we are only interested in 'v' for vertex and 'f' for face, everything else is ignored
 
-      // format of input line
+      // format of face line
       // f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3 ...
       // we are only interested in v1,v2,v3...
-
       // Note that the minimal legal format is
       // f v1 v2 v3 ...
 
-      std::vector<std::string> tokens;
-      tokenize(input," ",tokens);
-      pface face;
-
-      // skip first token since that is the 'f' keyword
-      for(size_t itok=1;itok<tokens.size();itok++) {
-         const std::string& token   = tokens[itok];
-         // vertex index is value before first '/' (if any)
-         std::string::size_type pos = token.find_first_of('/');
-         // subtract one since indices are 1-based in OBJ
-         face.push_back(boost::lexical_cast<size_t>(token.substr(0,pos))-1);
+      const char* tb = 0;
+      const char* te = 0;
+      while(in.next_token(tb,te)) {
+         if(ascii_scanner::equal(tb,te,"v")) {
+            // vertex
+            double x(0.0),y(0.0),z(0.0);
+            if(!(in.skip_blanks() && in.read_double(x) &&
+                 in.skip_blanks() && in.read_double(y) &&
+                 in.skip_blanks() && in.read_double(z))) {
+               throw std::logic_error("obj_io::read(...) invalid vertex coordinate '" + in.peek_token() + "'");
+            }
+            chunk.vert.emplace_back(x,y,z);
+         }
+         else if(ascii_scanner::equal(tb,te,"f")) {
+            // face
+            size_t nv = 0;
+            while(in.skip_blanks()) {
+               long long iv = 0;
+               if(!in.read_integer(iv) || iv==0) {
+                  throw std::logic_error("obj_io::read(...) invalid face vertex index '" + in.peek_token() + "'");
+               }
+               // skip texture and normal indices, if any
+               in.skip_token();
+
+               // indices are 1-based in OBJ, negative indices are relative to the last vertex seen
+               if(iv > 0) chunk.index.push_back(iv-1);
+               else       chunk.index.push_back(static_cast<long long>(chunk.vert.size()) + iv - obj_chunk::relative_bias);
+               nv++;
+            }
+            chunk.nvface.push_back(nv);
+         }
+
+         // ignore the rest of the line
+         in.skip_line();
       }
-      return face;
    }
 
+   // return position after the first line break at or after p, or end if not found
+   static const char* next_line_boundary(const char* p, const char* end)
+   {
+      const char* eol = static_cast<const char*>(std::memchr(p,'\n',end-p));
+      return (eol)? eol+1 : end;
+   }
 
    obj_io::obj_io()
    {}
@@ -85,9 +118,16 @@ namespace spaceio {
       return false;
    }
 
-   std::shared_ptr<ph3d_vector> obj_io::read(const std::string& file_path)
+   std::shared_ptr<ph3d_vector> obj_io::read(const std::string& file_path, const read_options& options)
+   {
+      polyhedron_builder builder(options);
+      read(file_path,builder,options);
+      return builder.polyset();
+   }
+
+   void obj_io::read(const std::string& file_path, polyhedron_sink& sink, const read_options& options)
    {
-       if(!is_obj(file_path)) throw std::logic_error("File is not an OBJ file:" + file_path);
+      if(!is_obj(file_path)) throw std::logic_error("File is not an OBJ file:" + file_path);
 
       boost::filesystem::path fullpath(file_path);
       if(!boost::filesystem::exists(fullpath)) {
@@ -95,41 +135,73 @@ namespace spaceio {
          throw std::logic_error(message);
       }
 
-      std::shared_ptr<ph3d_vector> polyset(new ph3d_vector);
-      vtx_vec vert;
-      pface_vec faces;
-
-      std::ifstream obj(file_path);
-      if(obj.is_open()) {
-
-         std::string line;
-         while(std::getline(obj,line)) {
-
-            std::string keyword;
-            std::istringstream in(line);
+      mapped_input_file file(file_path,"obj_io::read(...)");
+
+      // split the file into parts at line boundaries, at least one part per thread.
+      // Small files are not worth splitting
+      const size_t chunk_bytes = size_t(16)<<20;
+      size_t nthreads = parallel_threads(options.threads());
+      size_t nchunk   = (file.size() < (size_t(1)<<20))? 1 : std::max(nthreads,(file.size()+chunk_bytes-1)/chunk_bytes);
+      std::vector<const char*> bounds(nchunk+1,file.end());
+      bounds[0] = file.begin();
+      for(size_t ichunk=1; ichunk<nchunk; ichunk++) {
+         const char* p  = file.begin() + file.size()/nchunk*ichunk;
+         bounds[ichunk] = next_line_boundary(std::max(p,bounds[ichunk-1]),file.end());
+      }
 
-            // ignore everything but 'v' for vertex and 'f' for face
-            in >> keyword;
-            if(keyword == "v") {
-               // vertex
-               double x(0.0),y(0.0),z(0.0);
-               in >> x >> y >> z;
-               vert.push_back(pos3d(x,y,z));
+      sink.begin_polyhedron();
+
+      // parse up to nthreads parts in parallel, then pass them to the sink in file order
+      std::vector<obj_chunk> chunks(std::min(nchunk,nthreads));
+      std::vector<id_vertex> index;
+      size_t    nvert     = 0;    // vertices passed to the sink so far
+      long long max_index = -1;   // highest vertex index referenced by faces
+      for(size_t first=0; first<nchunk; first+=chunks.size()) {
+         size_t n = std::min(chunks.size(),nchunk-first);
+         parallel_tasks(n,nthreads,[&](size_t i) {
+            size_t ichunk = first+i;
+            ascii_scanner in(file.begin(),bounds[ichunk+1]);
+            in.set_pos(bounds[ichunk]);
+            try {
+               read_chunk(in,chunks[i]);
             }
-            else if (keyword == "f") {
-               // face
-               faces.push_back(read_face(line));
+            catch(std::logic_error& ex) {
+               std::string message = std::string(ex.what()) + " at line " + std::to_string(in.line_number()) + ": " + file_path;
+               throw std::logic_error(message);
             }
+         });
+
+         for(size_t i=0; i<n; i++) {
+            obj_chunk& chunk = chunks[i];
+            if(chunk.vert.size() > 0) sink.add_vertices(&chunk.vert[0],chunk.vert.size());
+
+            // resolve relative vertex indices now that the vertex offset of the chunk is known
+            index.resize(chunk.index.size());
+            for(size_t ii=0; ii<chunk.index.size(); ii++) {
+               long long iv = chunk.index[ii];
+               if(iv < 0) iv += obj_chunk::relative_bias + static_cast<long long>(nvert);
+               if(iv < 0) throw std::logic_error("obj_io::read(...) face vertex index out of range: " + file_path);
+               max_index = std::max(max_index,iv);
+               index[ii] = static_cast<id_vertex>(iv);
+            }
+            nvert += chunk.vert.size();
+
+            if(chunk.nvface.size() > 0) sink.add_faces((index.size()>0)? &index[0] : 0,&chunk.nvface[0],chunk.nvface.size());
+            chunk.clear();
          }
       }
 
-      polyset->push_back(std::shared_ptr<polyhedron3d>(new polyhedron3d(vert,faces)));
+      if(max_index >= static_cast<long long>(nvert)) {
+         throw std::logic_error("obj_io::read(...) face vertex index out of range: " + file_path);
+      }
 
-      return polyset;
+      sink.end_polyhedron();
    }
 
 
-   std::string obj_io::write(std::shared_ptr<spacemath::polyhedron3d> poly, const std::string& file_path)
+   // write one mesh, polyhedron3d or mapped_mesh
+   template <class Mesh>
+   static std::string write_mesh(const Mesh& mesh, const std::string& file_path, const write_options& options)
    {
       boost::filesystem::path fullpath(file_path);
       boost::filesystem::path off_path = fullpath.parent_path() / fullpath.stem();
@@ -141,45 +213,58 @@ namespace spaceio {
       std::replace(path.begin(),path.end(), '\\', '/');
 
 
-      std::ofstream out(path);
+      buffered_output_file out(path,"obj_io::write(...)");
+      ascii_printer printer(out,options.precision());
+
       std::string object_id = fullpath.stem().string();
-      out << "# OBJ file "<< std::endl;
-      out  << "o " << object_id << std::endl;
+      printer.text("# OBJ file\n");
+      printer.text("o ").text(object_id.c_str()).character('\n');
 
       // ========= vertices =================
-      for(size_t ivert=0; ivert<poly->vertex_size(); ivert++) {
-         const pos3d& v = poly->vertex(ivert);
-         out << "v " << std::setprecision(16) << v.x() << ' ' << std::setprecision(16) << v.y() << ' ' << std::setprecision(16) <<  v.z() << std::endl;
+      for(size_t ivert=0; ivert<mesh.vertex_size(); ivert++) {
+         const pos3d& v = mesh.vertex(ivert);
+         printer.text("v ").real(v.x()).character(' ').real(v.y()).character(' ').real(v.z()).character('\n');
       }
 
       // ========= faces =================
-      for(size_t iface = 0; iface<poly->face_size(); ++iface) {
-         const pface& f = poly->face(iface);
+      for(size_t iface = 0; iface<mesh.face_size(); ++iface) {
+         const auto& f = mesh.face(iface);
 
          size_t nvert = f.size();
-         out << "f ";
+         printer.character('f');
          for(size_t ivert=0; ivert<nvert; ivert++) {
             // indices are 1-based in OBJ
-            out << f[ivert]+1 << ' ';
+            printer.character(' ').integer(f[ivert]+1);
          }
-         out << std::endl;
+         printer.character('\n');
       }
 
+      out.close();
       return path;
    }
 
-    std::string  obj_io::write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path)
+   std::string obj_io::write(std::shared_ptr<spacemath::polyhedron3d> poly, const std::string& file_path, const write_options& options)
+   {
+      return write_mesh(*poly,file_path,options);
+   }
+
+   std::string obj_io::write(const mapped_mesh& mesh, const std::string& file_path, const write_options& options)
+   {
+      return write_mesh(mesh,file_path,options);
+   }
+
+    std::string  obj_io::write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, const write_options& options)
    {
       std::string res;
       if(polyset->size() == 1) {
-         res = write((*polyset)[0],file_path);
+         res = write((*polyset)[0],file_path,options);
       }
       else {
          for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
             boost::filesystem::path fullpath(file_path);
             boost::filesystem::path off_path = fullpath.parent_path() / fullpath.stem();
             std::string path = off_path.string() + '_' + std::to_string(ipoly) + ".obj";
-            res = write((*polyset)[ipoly],path);
+            res = write((*polyset)[ipoly],path,options);
          }
       }
       return res;
@@ -14,31 +14,100 @@
 // EndLicense:
 
 #include "off_io.h"
+#include "polyhedron_builder.h"
+#include "mapped_input_file.h"
+#include "ascii_scanner.h"
+#include "buffered_output_file.h"
+#include "ascii_printer.h"
 #include <boost/filesystem.hpp>
-#include <fstream>
 #include <sstream>
-#include <iomanip>
+#include <cstring>
+#include <algorithm>
 
 namespace spaceio {
 
-   static void tokenize(const std::string& input,
-                        const std::string& delimiters,
-                        std::vector<std::string>& tokens)
+   // skip whitespace and comment lines, return false at end of file
+   static bool skip_comments(ascii_scanner& in)
    {
-      using namespace std;
-      string::size_type last_pos = 0;
-      string::size_type pos = 0;
-      while(true) {
-         pos = input.find_first_of(delimiters, last_pos);
-         if( pos == string::npos ) {
-            if(input.length()-last_pos > 0)tokens.push_back(input.substr(last_pos));
-            break;
+      while(in.skip_space()) {
+         if(*in.pos() != '#') return true;
+         in.skip_line();
+      }
+      return false;
+   }
+
+   static void read_off(ascii_scanner& in, polyhedron_sink& sink)
+   {
+      // here we might see one of 2 variants
+      //
+      // a) one line
+      //    OFF numVertices numFaces numEdges
+      //
+      // b) two lines
+      //    OFF
+      //    numVertices numFaces numEdges
+
+      const char* tb = 0;
+      const char* te = 0;
+      if(!(skip_comments(in) && in.next_token(tb,te) && te-tb >= 3 && std::strncmp(tb,"OFF",3)==0)) {
+         throw std::logic_error("off_io::read(...) Keyword 'OFF' not found");
+      }
+
+      long long nvert=0,nface=0;
+      if(!(skip_comments(in) && in.read_integer(nvert) && in.read_integer(nface) && nvert>=0 && nface>=0)) {
+         throw std::logic_error("off_io::read(...) invalid number of vertices or faces '" + in.peek_token() + "'");
+      }
+      in.skip_line();  // numEdges is not used
+
+      sink.reserve(static_cast<size_t>(nvert),static_cast<size_t>(nface));
+
+      // vertices and faces are passed to the sink in batches
+      const size_t batch_size = 65536;
+
+      // ========= vertices =================
+      vtx_vec vert;
+      vert.reserve(std::min(static_cast<size_t>(nvert),batch_size));
+      for(long long ivert=0; ivert<nvert; ivert++) {
+         double x(0.0),y(0.0),z(0.0);
+         if(!(skip_comments(in) && in.read_double(x) && in.read_double(y) && in.read_double(z))) {
+            throw std::logic_error("off_io::read(...) invalid vertex coordinate '" + in.peek_token() + "'");
          }
-         else {
-            if(pos-last_pos > 0)tokens.push_back(input.substr(last_pos, pos - last_pos));
-            last_pos = pos + 1;
+         in.skip_line();  // ignore colors, if any
+         vert.push_back(pos3d(x,y,z));
+         if(vert.size() == batch_size) {
+            sink.add_vertices(&vert[0],vert.size());
+            vert.clear();
          }
       }
+      if(vert.size() > 0) sink.add_vertices(&vert[0],vert.size());
+
+      // ========= faces =================
+      std::vector<id_vertex> index;
+      std::vector<size_t>    face_size;
+      for(long long iface=0; iface<nface; iface++) {
+         long long nvf=0;  // number of vertices in face
+         if(!(skip_comments(in) && in.read_integer(nvf) && nvf>=0)) {
+            throw std::logic_error("off_io::read(...) invalid face '" + in.peek_token() + "'");
+         }
+         for(long long ivf=0; ivf<nvf; ivf++) {
+            long long iv=0;
+            if(!in.read_integer(iv)) {
+               throw std::logic_error("off_io::read(...) invalid face vertex index '" + in.peek_token() + "'");
+            }
+            if(iv<0 || iv>=nvert) {
+               throw std::logic_error("off_io::read(...) face vertex index out of range: " + std::to_string(iv));
+            }
+            index.push_back(static_cast<id_vertex>(iv));
+         }
+         in.skip_line();  // ignore colors, if any
+         face_size.push_back(static_cast<size_t>(nvf));
+         if(face_size.size() == batch_size) {
+            sink.add_faces(&index[0],&face_size[0],face_size.size());
+            index.clear();
+            face_size.clear();
+         }
+      }
+      if(face_size.size() > 0) sink.add_faces((index.size()>0)? &index[0] : 0,&face_size[0],face_size.size());
    }
 
 
@@ -61,6 +130,13 @@ namespace spaceio {
 
 
    std::shared_ptr<ph3d_vector> off_io::read(const std::string& file_path)
+   {
+      polyhedron_builder builder;
+      read(file_path,builder);
+      return builder.polyset();
+   }
+
+   void off_io::read(const std::string& file_path, polyhedron_sink& sink)
    {
       if(!is_off(file_path)) throw std::logic_error("File is not an OFF file:" + file_path);
 
@@ -70,109 +146,24 @@ namespace spaceio {
          throw std::logic_error(message);
       }
 
-      std::shared_ptr<ph3d_vector> polyset(new ph3d_vector);
-      vtx_vec vert;
-      pface_vec faces;
-
-      std::ifstream off(file_path);
-      if(off.is_open()) {
-
-         std::string line;
-         std::vector<std::string> tokens;
-         while(tokens.size()==0) {
-            std::getline(off,line);
-            tokenize(line," ",tokens);
-         }
+      mapped_input_file file(file_path,"off_io::read(...)");
+      ascii_scanner in(file.begin(),file.end());
 
-         // here we might see one of 2 variants
-         //
-         // a) one line
-         //    OFF numVertices numFaces numEdges
-         //
-         // b) two lines
-         //    OFF
-         //    numVertices numFaces numEdges
-
-         if(tokens[0].substr(0,3) != "OFF") throw std::logic_error("Keyword 'OFF' not found in :" + file_path);
-
-         size_t nvert=0,nface=0;
-         if(tokens.size() >=3) {
-            // case a
-            std::string offtxt;
-            std::istringstream in(line);
-            in >> offtxt >> nvert >> nface;
-         }
-         else {
-
-            // case b
-            while(std::getline(off,line)) {
-
-               // check for non-blank line
-               std::vector<std::string> tokens;
-               tokenize(line," ",tokens);
-               if(tokens.size() > 0) {
-
-                  // ok, at least one token
-                  if(tokens[0][0] != '#') {
-
-                     // We must first read number of vertices and faces
-                     if(nvert==0) {
-                        std::istringstream in(line);
-                        in >> nvert >> nface;
-                        vert.reserve(nvert);
-                        faces.reserve(nface);
-                        break;
-                     }
-                  }
-               }
-            }
-         }
-
-         // read vertices and faces
-         size_t ivert = 0;
-         size_t iface = 0;
-         while(std::getline(off,line)) {
-
-            // check for non-blank line
-            std::vector<std::string> tokens;
-            tokenize(line," ",tokens);
-            if(tokens.size() > 0) {
-               // ok, at least one token
-               if(tokens[0][0] != '#') {
-                  std::istringstream in(line);
-
-                  if(ivert++ < nvert) {
-
-                     // vertex
-                     double x(0.0),y(0.0),z(0.0);
-                     in >> x >> y >> z;
-                     vert.push_back(pos3d(x,y,z));
-                  }
-                  else if(iface++ < nface) {
-
-                     // face
-                     size_t nvf=0;
-                     in >> nvf;  // number of vertices in face
-                     pface face;
-                     face.reserve(nvf);
-                     for(size_t ivf=0;ivf<nvf;ivf++) {
-                        size_t ivert=0;
-                        in >> ivert;
-                        face.push_back(ivert);
-                     }
-                     faces.push_back(face);
-                  }
-               }
-            }
-         }
+      sink.begin_polyhedron();
+      try {
+         read_off(in,sink);
       }
-      polyset->push_back(std::shared_ptr<polyhedron3d>(new polyhedron3d(vert,faces)));
-
-      return polyset;
+      catch(std::logic_error& ex) {
+         std::string message = std::string(ex.what()) + " at line " + std::to_string(in.line_number()) + ": " + file_path;
+         throw std::logic_error(message);
+      }
+      sink.end_polyhedron();
    }
 
 
-   std::string off_io::write(std::shared_ptr<spacemath::polyhedron3d> poly, const std::string& file_path)
+   // write one mesh, polyhedron3d or mapped_mesh
+   template <class Mesh>
+   static std::string write_mesh(const Mesh& mesh, const std::string& file_path, const write_options& options)
    {
       boost::filesystem::path fullpath(file_path);
       boost::filesystem::path off_path = fullpath.parent_path() / fullpath.stem();
@@ -184,44 +175,56 @@ namespace spaceio {
       std::replace(path.begin(),path.end(), '\\', '/');
 
 
-      std::ofstream out(path);
+      buffered_output_file out(path,"off_io::write(...)");
+      ascii_printer printer(out,options.precision());
 
-      out << "OFF " << std::endl;
-      out << poly->vertex_size() << ' ' << poly->face_size() << " 0 " <<  std::endl;  // numedges always zero
+      printer.text("OFF\n");
+      printer.integer(mesh.vertex_size()).character(' ').integer(mesh.face_size()).text(" 0\n");  // numedges always zero
 
       // ========= vertices =================
-      for(size_t ivert=0; ivert<poly->vertex_size(); ivert++) {
-         const pos3d& v = poly->vertex(ivert);
-         out << std::setprecision(16) << v.x() << ' ' << std::setprecision(16) << v.y() << ' ' << std::setprecision(16) <<  v.z() << std::endl;
+      for(size_t ivert=0; ivert<mesh.vertex_size(); ivert++) {
+         const pos3d& v = mesh.vertex(ivert);
+         printer.real(v.x()).character(' ').real(v.y()).character(' ').real(v.z()).character('\n');
       }
 
       // ========= faces =================
-      for(size_t iface = 0; iface<poly->face_size(); ++iface) {
-         const pface& f = poly->face(iface);
+      for(size_t iface = 0; iface<mesh.face_size(); ++iface) {
+         const auto& f = mesh.face(iface);
 
          size_t nvert = f.size();
-         out << nvert << ' ';
+         printer.integer(nvert);
          for(size_t ivert=0; ivert<nvert; ivert++) {
-            out << f[ivert] << ' ';
+            printer.character(' ').integer(f[ivert]);
          }
-         out << std::endl;
+         printer.character('\n');
       }
 
+      out.close();
       return path;
    }
 
-    std::string  off_io::write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path)
+   std::string off_io::write(std::shared_ptr<spacemath::polyhedron3d> poly, const std::string& file_path, const write_options& options)
+   {
+      return write_mesh(*poly,file_path,options);
+   }
+
+   std::string off_io::write(const mapped_mesh& mesh, const std::string& file_path, const write_options& options)
+   {
+      return write_mesh(mesh,file_path,options);
+   }
+
+    std::string  off_io::write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, const write_options& options)
    {
       std::string res;
       if(polyset->size() == 1) {
-         res = write((*polyset)[0],file_path);
+         res = write((*polyset)[0],file_path,options);
       }
       else {
          for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
             boost::filesystem::path fullpath(file_path);
             boost::filesystem::path off_path = fullpath.parent_path() / fullpath.stem();
             std::string path = off_path.string() + '_' + std::to_string(ipoly) + ".off";
-            res = write((*polyset)[ipoly],path);
+            res = write((*polyset)[ipoly],path,options);
          }
       }
       return res;
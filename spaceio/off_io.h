@@ -17,6 +17,9 @@
 #define OFF_IO_H
 
 #include "spaceio_config.h"
+#include "write_options.h"
+#include "polyhedron_sink.h"
+#include "mapped_mesh.h"
 
 #include "spacemath/polyhedron3d.h"
 #include <memory>
@@ -38,12 +41,18 @@ namespace spaceio {
       // read from OFF, return as vector of polyhedra, one per object. For OFF this will always be max=1
       static std::shared_ptr<ph3d_vector> read(const std::string& file_path);
 
+      // read from OFF, pass the polyhedron to the sink while reading
+      static void read(const std::string& file_path, polyhedron_sink& sink);
+
       // Write to OFF, return the path to the file created
-      static std::string  write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path);
+      static std::string  write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, const write_options& options = write_options());
 
       // write to OFF, return the path to the file created
       // input is full path to file, file extension will be replaced to ".obj"
-      static std::string  write(std::shared_ptr<spacemath::polyhedron3d> poly, const std::string& file_path);
+      static std::string  write(std::shared_ptr<spacemath::polyhedron3d> poly, const std::string& file_path, const write_options& options = write_options());
+
+      // write an out-of-core mesh, return the path to the file created
+      static std::string  write(const mapped_mesh& mesh, const std::string& file_path, const write_options& options = write_options());
 
    };
 
@@ -0,0 +1,62 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "polyhedron_builder.h"
+#include "spacemath/polyhedron_order.h"
+
+namespace spaceio {
+
+   polyhedron_builder::polyhedron_builder(const read_options& options)
+   : m_polyset(new ph3d_vector)
+   , m_options(options)
+   {}
+
+   polyhedron_builder::~polyhedron_builder()
+   {}
+
+   void polyhedron_builder::begin_polyhedron()
+   {
+      m_vert.clear();
+      m_faces.clear();
+   }
+
+   void polyhedron_builder::reserve(size_t nvert, size_t nface)
+   {
+      m_vert.reserve(nvert);
+      m_faces.reserve(nface);
+   }
+
+   void polyhedron_builder::add_vertices(const spacemath::pos3d* vert, size_t nvert)
+   {
+      m_vert.insert(m_vert.end(),vert,vert+nvert);
+   }
+
+   void polyhedron_builder::add_faces(const id_vertex* index, const size_t* face_size, size_t nface)
+   {
+      for(size_t iface=0; iface<nface; iface++) {
+         m_faces.emplace_back(index,index+face_size[iface]);
+         index += face_size[iface];
+      }
+   }
+
+   void polyhedron_builder::end_polyhedron()
+   {
+      m_polyset->push_back(std::make_shared<spacemath::polyhedron3d>(std::move(m_vert),std::move(m_faces)));
+      if(m_options.reorder()) reorder_polyhedron(*m_polyset->back(),m_options.threads());
+      m_vert.clear();
+      m_faces.clear();
+   }
+
+} // namespace spaceio
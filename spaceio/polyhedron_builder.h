@@ -0,0 +1,52 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef POLYHEDRON_BUILDER_H
+#define POLYHEDRON_BUILDER_H
+
+#include "polyhedron_sink.h"
+#include "read_options.h"
+#include <memory>
+
+namespace spaceio {
+
+// polyhedron_builder is a polyhedron_sink collecting the received polyhedra into a ph3d_vector,
+// this is how the non-streaming readers are implemented.
+// Each completed polyhedron is reordered for cache locality when options.reorder() is set
+
+class SPACEIO_PUBLIC polyhedron_builder : public polyhedron_sink {
+public:
+   polyhedron_builder(const read_options& options = read_options());
+   virtual ~polyhedron_builder();
+
+   virtual void begin_polyhedron();
+   virtual void reserve(size_t nvert, size_t nface);
+   virtual void add_vertices(const spacemath::pos3d* vert, size_t nvert);
+   virtual void add_faces(const id_vertex* index, const size_t* face_size, size_t nface);
+   virtual void end_polyhedron();
+
+   // return the polyhedra completed so far
+   std::shared_ptr<ph3d_vector> polyset() const { return m_polyset; }
+
+private:
+   std::shared_ptr<ph3d_vector> m_polyset;  // completed polyhedra
+   vtx_vec                      m_vert;     // vertices of current polyhedron
+   pface_vec                    m_faces;    // faces of current polyhedron
+   read_options                 m_options;  // import options
+};
+
+} // namespace spaceio
+
+#endif // POLYHEDRON_BUILDER_H
@@ -4,15 +4,29 @@
 #include "obj_io.h"
 #include "off_io.h"
 #include "stl_io.h"
+#include "polyhedron_builder.h"
 
 namespace spaceio {
 
-   std::shared_ptr<ph3d_vector> polyhedron_io::read(const std::string& file_path)
+   std::shared_ptr<ph3d_vector> polyhedron_io::read(const std::string& file_path, const read_options& options)
    {
-      if(amf_io::is_amf(file_path)) return amf_io::read(file_path);
-      if(obj_io::is_obj(file_path)) return obj_io::read(file_path);
-      if(off_io::is_off(file_path)) return off_io::read(file_path);
-      if(stl_io::is_stl(file_path)) return stl_io::read(file_path);
-      return nullptr;
+      if(obj_io::is_obj(file_path)) return obj_io::read(file_path,options);
+      if(stl_io::is_stl(file_path)) return stl_io::read(file_path,options);
+
+      // AMF and OFF readers take no options, the builder applies them
+      polyhedron_builder builder(options);
+      if(amf_io::is_amf(file_path))      amf_io::read(file_path,builder);
+      else if(off_io::is_off(file_path)) off_io::read(file_path,builder);
+      else return nullptr;
+      return builder.polyset();
+   }
+
+   bool polyhedron_io::read(const std::string& file_path, polyhedron_sink& sink, const read_options& options)
+   {
+      if(amf_io::is_amf(file_path)) { amf_io::read(file_path,sink);         return true; }
+      if(obj_io::is_obj(file_path)) { obj_io::read(file_path,sink,options); return true; }
+      if(off_io::is_off(file_path)) { off_io::read(file_path,sink);         return true; }
+      if(stl_io::is_stl(file_path)) { stl_io::read(file_path,sink,options); return true; }
+      return false;
    }
 }
@@ -3,6 +3,8 @@
 
 #include "spaceio_config.h"
 #include "spacemath/polyhedron3d.h"
+#include "read_options.h"
+#include "polyhedron_sink.h"
 #include <memory>
 #include <string>
 
@@ -15,7 +17,10 @@ namespace spaceio {
    public:
 
       // read from file, return as vector of polyhedra, return nullptr if not supported
-      static std::shared_ptr<ph3d_vector> read(const std::string& file_path);
+      static std::shared_ptr<ph3d_vector> read(const std::string& file_path, const read_options& options = read_options());
+
+      // read from file, passing the polyhedra to the sink while reading (see polyhedron_sink), return false if not supported
+      static bool read(const std::string& file_path, polyhedron_sink& sink, const read_options& options = read_options());
 
    };
 
@@ -0,0 +1,54 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef POLYHEDRON_SINK_H
+#define POLYHEDRON_SINK_H
+
+#include "spaceio_config.h"
+#include "spacemath/polyhedron3d.h"
+
+namespace spaceio {
+
+// polyhedron_sink receives polyhedra from the streaming readers (see polyhedron_io) while the file is decoded,
+// so that callers can process large files without holding the complete polyhedron in memory.
+//
+// Each polyhedron is delivered as begin_polyhedron(), any number of vertex and face batches, then end_polyhedron().
+// Vertices are numbered from 0 within each polyhedron, in the order they are received. Face vertex indices
+// refer to this numbering and are all valid when end_polyhedron() is called.
+// The batch data is owned by the reader and only valid during the call.
+
+class SPACEIO_PUBLIC polyhedron_sink {
+public:
+   virtual ~polyhedron_sink() {}
+
+   // a new polyhedron starts
+   virtual void begin_polyhedron() {}
+
+   // size hint given by readers that know the sizes in advance, sizes are approximate
+   virtual void reserve(size_t /* nvert */, size_t /* nface */) {}
+
+   // batch of nvert vertices
+   virtual void add_vertices(const spacemath::pos3d* vert, size_t nvert) = 0;
+
+   // batch of nface faces. Face i has face_size[i] vertex indices, the indices of all faces are stored consecutively in index
+   virtual void add_faces(const id_vertex* index, const size_t* face_size, size_t nface) = 0;
+
+   // the current polyhedron is complete
+   virtual void end_polyhedron() {}
+};
+
+} // namespace spaceio
+
+#endif // POLYHEDRON_SINK_H
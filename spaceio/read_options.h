@@ -0,0 +1,54 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef READ_OPTIONS_H
+#define READ_OPTIONS_H
+
+#include <cstddef>
+
+namespace spaceio {
+
+// Options for polyhedron import (see polyhedron_io, stl_io, obj_io)
+class read_options {
+public:
+   read_options() : m_weld_vertices(false), m_threads(1), m_reorder(false) {}
+
+   // when true, vertices with identical coordinates are shared while reading,
+   // so the returned polyhedron is indexed rather than completely disconnected.
+   // Only relevant for formats without vertex indexing (STL).
+   // Welding keeps all unique vertices in memory, for out-of-core reading into a
+   // mapped_mesh leave it off and use mapped_mesh::merge_vertices() afterwards
+   inline bool weld_vertices() const         { return m_weld_vertices; }
+   void set_weld_vertices(bool weld_vertices) { m_weld_vertices = weld_vertices; }
+
+   // number of threads used for parsing ASCII files (STL, OBJ), 0 means all hardware threads
+   inline size_t threads() const             { return m_threads; }
+   void set_threads(size_t threads)           { m_threads = threads; }
+
+   // when true, the vertices and faces of each polyhedron returned are reordered for cache locality
+   // after reading, see spacemath::reorder_polyhedron. Applies to the readers returning a ph3d_vector,
+   // streaming readers pass the polyhedra to the sink in file order
+   inline bool reorder() const               { return m_reorder; }
+   void set_reorder(bool reorder)             { m_reorder = reorder; }
+
+private:
+   bool    m_weld_vertices;  // default:false. Share bitwise identical vertices
+   size_t  m_threads;        // default:1. Parsing threads
+   bool    m_reorder;        // default:false. Reorder vertices and faces after reading
+};
+
+} // namespace spaceio
+
+#endif // READ_OPTIONS_H
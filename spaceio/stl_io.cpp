@@ -14,15 +14,20 @@
 // EndLicense:
 
 #include "stl_io.h"
+#include "polyhedron_builder.h"
+#include "vertex_weld_map.h"
+#include "mapped_input_file.h"
+#include "ascii_scanner.h"
+#include "buffered_output_file.h"
+#include "ascii_printer.h"
 #include "spacemath/vec3d.h"
+#include "spacemath/parallel_for.h"
 #include <boost/filesystem.hpp>
 
 #include <locale>
-#include <iomanip>
-#include <fstream>
-#include <sstream>
-#include <map>
 #include <cstdio>
+#include <cstring>
+#include <limits>
 #include <stdint.h>
 
 
@@ -30,380 +35,600 @@ namespace spaceio {
 
 using namespace std;
 
+// stl_facets collects STL facets from a part of the file into vertices and triangle vertex indices.
+// Without welding, vertices are not shared at all: there are simply 3 times as many vertices as faces.
+// With welding, bitwise identical vertices are shared and faces that collapse as a result are dropped.
+class stl_facets {
+public:
+   stl_facets(bool weld)
+   : m_weld_map(m_vert)
+   , m_weld(weld)
+   {}
+
+   // not copyable, m_weld_map refers to m_vert
+   stl_facets(const stl_facets&) = delete;
+   stl_facets& operator=(const stl_facets&) = delete;
+
+   void reserve(size_t expected_faces)
+   {
+      m_vert.reserve(m_weld? expected_faces/2+2 : expected_faces*3);
+      m_index.reserve(expected_faces*3);
+   }
 
-bool stl_io::is_stl(const std::string& file_path)
-{
-   boost::filesystem::path fullpath(file_path);
-   std::string ext = fullpath.extension().string();
-   std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
-   if(ext == ".stl")return true;
+   inline void add(double x0, double y0, double z0,
+                   double x1, double y1, double z1,
+                   double x2, double y2, double z2)
+   {
+      if(m_weld) {
+         id_vertex iv0 = m_weld_map.insert(x0,y0,z0);
+         id_vertex iv1 = m_weld_map.insert(x1,y1,z1);
+         id_vertex iv2 = m_weld_map.insert(x2,y2,z2);
+         if(iv0!=iv1 && iv1!=iv2 && iv2!=iv0) {
+            m_index.push_back(iv0);
+            m_index.push_back(iv1);
+            m_index.push_back(iv2);
+         }
+      }
+      else {
+         id_vertex iv = m_vert.size();
+         m_vert.emplace_back(x0,y0,z0);
+         m_vert.emplace_back(x1,y1,z1);
+         m_vert.emplace_back(x2,y2,z2);
+         m_index.push_back(iv);
+         m_index.push_back(iv+1);
+         m_index.push_back(iv+2);
+      }
+   }
 
-   return false;
-}
+   void clear()
+   {
+      m_vert.clear();
+      m_index.clear();
+      m_weld_map.clear();
+   }
+
+   inline const vtx_vec& vert() const           { return m_vert; }
+   inline std::vector<id_vertex>& index()       { return m_index; }
+
+private:
+   vtx_vec                m_vert;
+   std::vector<id_vertex> m_index;     // 3 vertex indices per triangle
+   vertex_weld_map        m_weld_map;
+   bool                   m_weld;
+};
+
+// stl_emitter passes facets collected from consecutive parts of the file to the sink, in file order.
+// With welding, vertices are also shared across the parts, so all unique vertices are kept here
+class stl_emitter {
+public:
+   stl_emitter(polyhedron_sink& sink, bool weld)
+   : m_sink(sink)
+   , m_weld_map(m_vert)
+   , m_weld(weld)
+   , m_nvert(0)
+   {}
+
+   stl_emitter(const stl_emitter&) = delete;
+   stl_emitter& operator=(const stl_emitter&) = delete;
+
+   void emit(stl_facets& facets)
+   {
+      const vtx_vec& vert = facets.vert();
+      std::vector<id_vertex>& index = facets.index();
+
+      if(m_weld) {
+         std::vector<id_vertex> new_vert(vert.size());
+         size_t first = m_vert.size();
+         for(size_t iv=0; iv<vert.size(); iv++) {
+            const pos3d& p = vert[iv];
+            new_vert[iv] = m_weld_map.insert(p.x(),p.y(),p.z());
+         }
+         if(m_vert.size() > first) m_sink.add_vertices(&m_vert[first],m_vert.size()-first);
+
+         // vertices distinct within a part remain distinct after welding, so no faces collapse here
+         for(id_vertex& iv : index) iv = new_vert[iv];
+      }
+      else {
+         if(vert.size() > 0) m_sink.add_vertices(&vert[0],vert.size());
+         for(id_vertex& iv : index) iv += m_nvert;
+         m_nvert += vert.size();
+      }
+
+      size_t nface = index.size()/3;
+      if(nface > 0) {
+         if(m_face_size.size() < nface) m_face_size.resize(nface,3);
+         m_sink.add_faces(&index[0],&m_face_size[0],nface);
+      }
+      facets.clear();
+   }
 
-std::string stl_io::write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, bool binary)
+private:
+   polyhedron_sink&    m_sink;
+   vtx_vec             m_vert;        // unique vertices, with welding only
+   vertex_weld_map     m_weld_map;
+   bool                m_weld;
+   size_t              m_nvert;       // vertices passed to the sink, without welding only
+   std::vector<size_t> m_face_size;   // all 3
+};
+
+// parse nchunk parts of a file and pass them to the sink in file order.
+// Up to nthreads parts are parsed in parallel, then emitted before the next parts are parsed,
+// so memory use is limited by the part size rather than the file size.
+// parse(ichunk,facets) is called to parse part ichunk into facets
+template <class Parse>
+static void read_chunks(size_t nchunk, size_t nthreads, size_t expected_faces, bool weld, polyhedron_sink& sink, Parse parse)
 {
-   if(binary)return write_binary(polyset,file_path);
-   return write_ascii(polyset,file_path);
+   stl_emitter emitter(sink,weld);
+   std::vector<std::unique_ptr<stl_facets>> facets(std::max(size_t(1),std::min(nchunk,nthreads)));
+   for(size_t i=0; i<facets.size(); i++) {
+      facets[i].reset(new stl_facets(weld));
+      facets[i]->reserve(expected_faces);
+   }
+
+   for(size_t first=0; first<nchunk; first+=facets.size()) {
+      size_t n = std::min(facets.size(),nchunk-first);
+      parallel_tasks(n,nthreads,[&](size_t i) { parse(first+i,*facets[i]); });
+      for(size_t i=0; i<n; i++) emitter.emit(*facets[i]);
+   }
 }
 
-std::shared_ptr<ph3d_vector> stl_io::read(const std::string& file_path)
+// consume the expected keyword or throw
+static void expect_keyword(ascii_scanner& in, const char* keyword)
 {
-   boost::filesystem::path fullpath(file_path);
-   if(!is_stl(file_path)) {
-      string message = "stl_io::read(...)  The file must be .stl: " + file_path;
-      throw logic_error(message);
+   if(!in.keyword(keyword)) {
+      throw logic_error("stl_io::read_ascii(...) expected '" + string(keyword) + "', but found '" + in.peek_token() + "'");
    }
+}
 
-   if(!boost::filesystem::exists(fullpath)) {
-      string message = "stl_io::read(...) The file does not exist: " + file_path;
-      throw logic_error(message);
+// read a single ASCII facet, the 'facet' keyword has already been consumed
+static void read_facet_ascii(ascii_scanner& in, stl_facets& facets)
+{
+   // the normal is ignored, and some exporters leave it out entirely
+   if(in.keyword("normal")) {
+      double n=0.0;
+      for(size_t i=0; i<3; i++) {
+         if(!in.read_double(n)) throw logic_error("stl_io::read_ascii(...) invalid facet normal '" + in.peek_token() + "'");
+      }
    }
 
+   expect_keyword(in,"outer");
+   expect_keyword(in,"loop");
 
-   // open the file as binary and read the 5 first bytes to see if it says "solid", meaning ascii format
-   if(FILE* stl = std::fopen(file_path.c_str(),"rb")) {
-      // read the header bytes
-      const size_t blen=80;
-      char buffer[blen];
-      size_t nread = std::fread(buffer,sizeof(char),5,stl);
-      std::fclose(stl);
+   double xyz[9];
+   for(size_t i=0; i<9; i+=3) {
+      expect_keyword(in,"vertex");
+      if(!(in.read_double(xyz[i]) && in.read_double(xyz[i+1]) && in.read_double(xyz[i+2]))) {
+         throw logic_error("stl_io::read_ascii(...) invalid vertex coordinate '" + in.peek_token() + "'");
+      }
+   }
 
-      bool is_ascii = false;
+   expect_keyword(in,"endloop");
+   expect_keyword(in,"endfacet");
 
-      buffer[5]=0;
-      string keyword(buffer);
-      if(keyword=="solid") {
-         // this is *probably* an ascii file, but some software break the rules....
-         // skip the header and see if we find the word "facet" in line 2
-         ifstream in(file_path.c_str());
-         string line;
-         std::getline(in,line);
-         if(!in.bad() && !in.fail() && !in.eof()) {
-            std::getline(in,line);
-            size_t n = line.find_first_not_of(" \t");
-            if(n != string::npos) {
-               if(line.substr(n,5)=="facet")is_ascii=true;
-            }
-         }
-      }
+   facets.add(xyz[0],xyz[1],xyz[2],
+              xyz[3],xyz[4],xyz[5],
+              xyz[6],xyz[7],xyz[8]);
+}
 
-      if(is_ascii) return read_ascii(file_path);
-      else         return read_binary(file_path);
+// read all ASCII facets in the scanner range. Any "solid"/"endsolid" lines
+// and other unrecognised lines between facets are skipped
+static void read_facets_ascii(ascii_scanner& in, stl_facets& facets)
+{
+   const char* tb = 0;
+   const char* te = 0;
+   while(in.next_token(tb,te)) {
+      if(ascii_scanner::equal(tb,te,"facet")) read_facet_ascii(in,facets);
+      else                                    in.skip_line();
    }
+}
 
-   string message = "stl_io::read(...)  Failed to open: " + file_path;
-   throw logic_error(message);
+// return position after the first "endfacet" at or after p, or end if not found.
+// This is where a part of the file can be parsed independently of the rest
+static const char* next_facet_boundary(const char* p, const char* end)
+{
+   // p may be in the middle of a token, skip to the next whitespace first
+   while(p<end && !ascii_scanner::is_space(*p)) p++;
+
+   ascii_scanner in(p,end);
+   const char* tb = 0;
+   const char* te = 0;
+   while(in.next_token(tb,te)) {
+      if(ascii_scanner::equal(tb,te,"endfacet")) return te;
+   }
+   return end;
 }
 
-std::shared_ptr<ph3d_vector> stl_io::read_binary(const std::string& file_path)
+bool stl_io::is_stl(const std::string& file_path)
 {
    boost::filesystem::path fullpath(file_path);
+   std::string ext = fullpath.extension().string();
+   std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+   if(ext == ".stl")return true;
 
-   if(!is_stl(file_path)) {
-      string message = "stl_io::read_binary(...)  The file must be .stl: " + file_path;
-      throw logic_error(message);
+   return false;
+}
+
+// count the triangles required to write a mesh to STL. Faces with less than 3 vertices are ignored,
+// N-sided faces become N-2 triangles when triangulated, otherwise an exception is thrown
+template <class Mesh>
+static uintmax_t count_mesh_triangles(const Mesh& mesh, const write_options& options, const string& caller, const string& file_path)
+{
+   uintmax_t ntri=0;
+   for(size_t iface=0; iface<mesh.face_size(); iface++) {
+      size_t nv = mesh.face(iface).size();
+      if(nv > 3 && !options.triangulate_faces()) {
+         string message = caller + "  Face with " + std::to_string(nv) + " vertices cannot be written to STL without triangulation: " + file_path;
+         throw logic_error(message);
+      }
+      if(nv > 2) ntri += nv-2;
    }
+   return ntri;
+}
 
-   if(!boost::filesystem::exists(fullpath)) {
-      string message = "stl_io::read_binary(...) The file does not exist: " + file_path;
+// binary STL stores the triangle count as uint32, ASCII STL has no such limit
+static void check_binary_triangle_count(uintmax_t ntri, const string& caller, const string& file_path)
+{
+   if(ntri > std::numeric_limits<uint32_t>::max()) {
+      string message = caller + "  Too many triangles for binary STL (" + std::to_string(ntri) + "): " + file_path;
       throw logic_error(message);
    }
+}
 
+static uintmax_t count_triangles(std::shared_ptr<ph3d_vector> polyset, const write_options& options, const string& caller, const string& file_path)
+{
+   uintmax_t ntri=0;
+   for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
+      ntri += count_mesh_triangles(*(*polyset)[ipoly],options,caller,file_path);
+   }
+   return ntri;
+}
 
-   std::shared_ptr<ph3d_vector> polyset(new ph3d_vector);
-
-   if(FILE* stl = std::fopen(file_path.c_str(),"rb")) {
-
-      // temporary storage of facets
-      map<size_t,vector<pos3d>> facets;
-
-      // read the header
-      const size_t blen=80;
-      char buffer[blen];
-      size_t nread = std::fread(buffer,sizeof(char),blen,stl);
-
-      // read number of triangles
-      uint32_t ntri=0;
-      nread = std::fread(&ntri,sizeof(uint32_t),1,stl);
+static uintmax_t count_triangles(const mapped_mesh& mesh, const write_options& options, const string& caller, const string& file_path)
+{
+   return count_mesh_triangles(mesh,options,caller,file_path);
+}
 
+// the STL file name is the input path with its extension replaced by ".stl"
+static std::string stl_path(const std::string& file_path)
+{
+   boost::filesystem::path fullpath(file_path);
+   boost::filesystem::path stl_path = fullpath.parent_path() / fullpath.stem();
+   return stl_path.string() + ".stl";
+}
 
-      // process triangle facets
-      for(uint32_t i=0; i<ntri; i++) {
+// write one ASCII STL vertex line
+static inline void write_ascii_vertex(ascii_printer& printer, const pos3d& p)
+{
+   printer.text("      vertex ").real(p.x()).character(' ').real(p.y()).character(' ').real(p.z()).character('\n');
+}
 
-         vector<pos3d> facet;
-         facet.reserve(3);
+// serialize one 50 byte binary STL record: float normal[3], float vertex[3][3], uint16 attribute byte count
+static inline void write_binary_record(char* rec, const vec3d& normal, const pos3d& p0, const pos3d& p1, const pos3d& p2)
+{
+   const float xyz[12] = { static_cast<float>(normal.x()), static_cast<float>(normal.y()), static_cast<float>(normal.z()),
+                           static_cast<float>(p0.x()),     static_cast<float>(p0.y()),     static_cast<float>(p0.z()),
+                           static_cast<float>(p1.x()),     static_cast<float>(p1.y()),     static_cast<float>(p1.z()),
+                           static_cast<float>(p2.x()),     static_cast<float>(p2.y()),     static_cast<float>(p2.z()) };
+   std::memcpy(rec,xyz,sizeof(xyz));
+   rec[48] = 0;
+   rec[49] = 0;
+}
 
-         // read the triangle , skip the normal vector
-         for(size_t i=0; i<4; i++) {
-            float xyz[] = {0.0f, 0.0f, 0.0f };
-            nread = std::fread(xyz,sizeof(float),3,stl);
-            if(i>0) {
-               // convert to double
-               facet.push_back(pos3d(double(xyz[0]),double(xyz[1]),double(xyz[2])));
-            }
+// write the facets of one mesh to ASCII STL
+template <class Mesh>
+static void write_ascii_facets(ascii_printer& printer, const Mesh& mesh)
+{
+   for(size_t iface=0; iface<mesh.face_size(); iface++) {
+
+      const auto& face = mesh.face(iface);
+      size_t nv = face.size();
+      if(nv > 2) {
+
+         // compute face normal, N-sided faces are split into a triangle fan sharing the face normal
+         vec3d normal =  mesh.face_normal(iface);
+         normal.normalise();
+
+         const pos3d& p0 = mesh.vertex(face[0]);
+         for(size_t iv=1; iv<nv-1; iv++) {
+
+            // facet normal does not require high precision, it is usually ignored, so we save some space instead
+            printer.text("facet normal ").real(normal.x(),8).character(' ').real(normal.y(),8).character(' ').real(normal.z(),8).character('\n');
+            printer.text("   outer loop\n");
+            write_ascii_vertex(printer,p0);
+            write_ascii_vertex(printer,mesh.vertex(face[iv]));
+            write_ascii_vertex(printer,mesh.vertex(face[iv+1]));
+            printer.text("   endloop\n");
+            printer.text("endfacet\n");
          }
-
-         // skip the attribute byte count value
-         uint16_t bcount = 0;
-         nread = std::fread(&bcount, sizeof(bcount), 1, stl);
-
-         facets.insert(make_pair(facets.size(),facet));
       }
-      std::fclose(stl);
-
-      // produce vertices and faces, with no sharing of vertices at all
-      // There are simply 3 times as many vertices as faces
-      vtx_vec vert;
-      vert.reserve(facets.size()*3);
-
-      pface_vec faces;
-      faces.reserve(facets.size());
-
-      // traverse facets and create triangle faces
-      for(auto& p : facets) {
+   }
+}
 
-         // face number and coordinates
-         size_t iface         = p.first;
-         vector<pos3d>& coord = p.second;
+// write the 80 byte header and the number of triangles of a binary STL file
+static void write_binary_header(buffered_output_file& out, uintmax_t ntri)
+{
+   const size_t header_size = 80;
+   char* header = out.reserve(header_size);
+   std::memset(header,' ',header_size);
+   out.commit(header_size);
+   uint32_t ntri32 = static_cast<uint32_t>(ntri);
+   out.write(&ntri32,sizeof(uint32_t));
+}
 
-         // push coordinates to vertex vector and set computed face vertex indices
-         pface face(3);
-         for(size_t i=0; i<3; i++) {
-            vert.push_back(coord[i]);
-            face[i] = iface*3 + i;
+// write the facets of one mesh as binary STL records
+template <class Mesh>
+static void write_binary_facets(buffered_output_file& out, const Mesh& mesh)
+{
+   const size_t record_size = 50;
+   for(size_t iface=0; iface<mesh.face_size(); iface++) {
+
+      const auto& face = mesh.face(iface);
+      size_t nv = face.size();
+      if(nv == 3) {
+
+         // triangle: normal computed directly from its vertices
+         const pos3d& p0 = mesh.vertex(face[0]);
+         const pos3d& p1 = mesh.vertex(face[1]);
+         const pos3d& p2 = mesh.vertex(face[2]);
+         double ux = p1.x()-p0.x(), uy = p1.y()-p0.y(), uz = p1.z()-p0.z();
+         double vx = p2.x()-p0.x(), vy = p2.y()-p0.y(), vz = p2.z()-p0.z();
+         vec3d normal(uy*vz-uz*vy, uz*vx-ux*vz, ux*vy-uy*vx);
+         normal.normalise();
+         write_binary_record(out.reserve(record_size),normal,p0,p1,p2);
+         out.commit(record_size);
+      }
+      else if(nv > 3) {
+
+         // N-sided face: split into a triangle fan sharing the normal of the whole face
+         vec3d normal = mesh.face_normal(iface);
+         normal.normalise();
+         const pos3d& p0 = mesh.vertex(face[0]);
+         for(size_t iv=1; iv<nv-1; iv++) {
+            write_binary_record(out.reserve(record_size),normal,p0,mesh.vertex(face[iv]),mesh.vertex(face[iv+1]));
+            out.commit(record_size);
          }
-
-         // push the new face
-         faces.push_back(face);
       }
-      // create the completely disconnected  polyhedron
-      polyset->push_back(std::shared_ptr<polyhedron3d>(new polyhedron3d(vert,faces)));
-
-      return polyset;
    }
+}
 
-   string message = "stl_io::read_binary(...)  Failed to open: " + file_path;
-   throw logic_error(message);
+std::string stl_io::write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, bool binary, const write_options& options)
+{
+   if(binary)return write_binary(polyset,file_path,options);
+   return write_ascii(polyset,file_path,options);
 }
 
-std::shared_ptr<ph3d_vector> stl_io::read_ascii(const std::string& file_path)
+std::string stl_io::write(const mapped_mesh& mesh, const std::string& file_path, bool binary, const write_options& options)
 {
-   boost::filesystem::path fullpath(file_path);
+   if(binary)return write_binary(mesh,file_path,options);
+   return write_ascii(mesh,file_path,options);
+}
+
+std::shared_ptr<ph3d_vector> stl_io::read(const std::string& file_path, const read_options& options)
+{
+   polyhedron_builder builder(options);
+   read(file_path,builder,options);
+   return builder.polyset();
+}
 
+void stl_io::read(const std::string& file_path, polyhedron_sink& sink, const read_options& options)
+{
+   boost::filesystem::path fullpath(file_path);
    if(!is_stl(file_path)) {
-      string message = "stl_io::read_ascii(...)  The file must be .stl: " + file_path;
+      string message = "stl_io::read(...)  The file must be .stl: " + file_path;
       throw logic_error(message);
    }
 
    if(!boost::filesystem::exists(fullpath)) {
-      string message = "stl_io::read_ascii(...) The file does not exist: " + file_path;
+      string message = "stl_io::read(...) The file does not exist: " + file_path;
       throw logic_error(message);
    }
 
-   std::shared_ptr<ph3d_vector> polyset(new ph3d_vector);
-
-   ifstream stl(file_path);
-   if(stl.is_open()) {
 
-      map<size_t,vector<pos3d>> facets;
-
-      string line;
-      while(std::getline(stl,line)) {
-         string keyword;
-         istringstream in(line);
-
-         // here we read facet by facet and insert into facets map
-         in >> keyword;
-         if(keyword == "facet") {
-
-            vector<pos3d> facet = get_facet_ascii(stl);
-            facets.insert(make_pair(facets.size(),facet));
+   // check if the file starts with "solid", meaning ascii format
+   bool is_ascii = false;
+   {
+      mapped_input_file file(file_path,"stl_io::read(...)");
+      ascii_scanner in(file.begin(),file.end());
+      if(in.keyword("solid")) {
+         // this is *probably* an ascii file, but some software break the rules....
+         // A binary file with "solid" header is recognised by its size matching the triangle count.
+         // Otherwise skip the header and see if we find the word "facet" (or "endsolid") in line 2
+         bool binary_size = false;
+         if(file.size() >= 84) {
+            uint32_t ntri=0;
+            std::memcpy(&ntri,file.begin()+80,sizeof(uint32_t));
+            binary_size = (84 + uintmax_t(ntri)*50 == file.size());
+         }
+         if(!binary_size) {
+            in.skip_line();
+            is_ascii = in.keyword("facet") || in.keyword("endsolid");
          }
       }
+   }
 
-      // produce vertices and faces, with no sharing of vertices at all
-      // There are simply 3 times as many vertices as faces
-      vtx_vec vert;
-      vert.reserve(facets.size()*3);
-
-      pface_vec faces;
-      faces.reserve(facets.size());
+   if(is_ascii) read_ascii(file_path,sink,options);
+   else         read_binary(file_path,sink,options);
+}
 
-      // traerse facets and create triangle faces
-      for(auto& p : facets) {
+void stl_io::read_binary(const std::string& file_path, polyhedron_sink& sink, const read_options& options)
+{
+   boost::filesystem::path fullpath(file_path);
 
-         // face number and coordinates
-         size_t iface         = p.first;
-         vector<pos3d>& coord = p.second;
+   if(!is_stl(file_path)) {
+      string message = "stl_io::read_binary(...)  The file must be .stl: " + file_path;
+      throw logic_error(message);
+   }
 
-         // push coordinates to vertex vector and set computed face vertex indices
-         pface face(3);
-         for(size_t i=0; i<3; i++) {
-            vert.push_back(coord[i]);
-            face[i] = iface*3 + i;
-         }
+   if(!boost::filesystem::exists(fullpath)) {
+      string message = "stl_io::read_binary(...) The file does not exist: " + file_path;
+      throw logic_error(message);
+   }
 
-         // push the new face
-         faces.push_back(face);
-      }
+   // binary STL layout: 80 byte header, uint32 triangle count, then 50 byte records
+   // record: float normal[3], float vertex[3][3], uint16 attribute byte count
+   const size_t header_size = 84;
+   const size_t record_size = 50;
 
-      // create the completely disconnected  polyhedron
-      polyset->push_back(std::shared_ptr<polyhedron3d>(new polyhedron3d(vert,faces)));
+   uintmax_t file_size = boost::filesystem::file_size(fullpath);
+   if(file_size < header_size) {
+      string message = "stl_io::read_binary(...)  File too small to be binary STL: " + file_path;
+      throw logic_error(message);
    }
-   else {
-      string message = "stl_io::read_ascii(...)  Failed to open: " + file_path;
+
+   // map the whole file read-only, records are decoded directly from the mapped memory
+   mapped_input_file file(file_path,"stl_io::read_binary(...)");
+   const char* data = file.begin();
+
+   // read number of triangles and check it against the actual file size
+   uint32_t ntri=0;
+   std::memcpy(&ntri,data+80,sizeof(uint32_t));
+   uintmax_t required_size = header_size + uintmax_t(ntri)*record_size;
+   if(file_size < required_size) {
+      string message = "stl_io::read_binary(...)  File is truncated, header says " + std::to_string(ntri)
+                     + " triangles requiring " + std::to_string(required_size) + " bytes, but file size is "
+                     + std::to_string(file_size) + " bytes: " + file_path;
       throw logic_error(message);
    }
 
-   return polyset;
+   sink.begin_polyhedron();
+   sink.reserve(options.weld_vertices()? ntri/2+2 : size_t(ntri)*3, ntri);
+
+   // decode the triangle records in parts, skip the normal vector and attribute byte count
+   const size_t chunk_facets = size_t(1)<<20;
+   size_t nthreads = parallel_threads(options.threads());
+   size_t nchunk   = (ntri + chunk_facets - 1)/chunk_facets;
+   read_chunks(nchunk,nthreads,std::min(size_t(ntri),chunk_facets),options.weld_vertices(),sink,[&](size_t ichunk, stl_facets& facets) {
+      size_t first = ichunk*chunk_facets;
+      size_t last  = std::min(first+chunk_facets,size_t(ntri));
+      const char* rec = data + header_size + first*record_size;
+      for(size_t itri=first; itri<last; itri++, rec+=record_size) {
+
+         float xyz[9];
+         std::memcpy(xyz,rec+12,sizeof(xyz));
+         facets.add(xyz[0],xyz[1],xyz[2],
+                    xyz[3],xyz[4],xyz[5],
+                    xyz[6],xyz[7],xyz[8]);
+      }
+   });
+
+   sink.end_polyhedron();
 }
 
-vector<pos3d> stl_io::get_facet_ascii(std::istream& stl)
+void stl_io::read_ascii(const std::string& file_path, polyhedron_sink& sink, const read_options& options)
 {
-   // read a single stl facet
-   vector<pos3d> vtx;
-   vtx.reserve(3);
-   string line;
-
-   std::getline(stl,line);  // skip "outer loop"
-
-   for(size_t i=0; i<3; i++) {
+   boost::filesystem::path fullpath(file_path);
 
-      std::getline(stl,line);
-      istringstream in(line);
+   if(!is_stl(file_path)) {
+      string message = "stl_io::read_ascii(...)  The file must be .stl: " + file_path;
+      throw logic_error(message);
+   }
 
-      string keyword;
-      in >> keyword;
+   if(!boost::filesystem::exists(fullpath)) {
+      string message = "stl_io::read_ascii(...) The file does not exist: " + file_path;
+      throw logic_error(message);
+   }
 
-      double x(0.0),y(0.0),z(0.0);
-      if(keyword == "vertex") in >> x >> y >> z;
-      else throw logic_error("stl_io::get_facet_ascii(...) expected 'vertex' , but found" + keyword);
-      vtx.push_back(pos3d(x,y,z));
+   // scan the memory mapped file directly. Typical facets occupy about 250 bytes,
+   // which is used only to estimate the required storage
+   mapped_input_file file(file_path,"stl_io::read_ascii(...)");
+   const size_t facet_bytes = 250;
+
+   // split the file into parts at facet boundaries, at least one part per thread.
+   // Small files are not worth splitting
+   const size_t chunk_bytes = size_t(16)<<20;
+   size_t nthreads = parallel_threads(options.threads());
+   size_t nchunk   = (file.size() < (size_t(1)<<20))? 1 : std::max(nthreads,(file.size()+chunk_bytes-1)/chunk_bytes);
+   std::vector<const char*> bounds(nchunk+1,file.end());
+   bounds[0] = file.begin();
+   for(size_t ichunk=1; ichunk<nchunk; ichunk++) {
+      const char* p  = file.begin() + file.size()/nchunk*ichunk;
+      bounds[ichunk] = next_facet_boundary(std::max(p,bounds[ichunk-1]),file.end());
    }
 
-   std::getline(stl,line);  // skip "endloop"
+   sink.begin_polyhedron();
+   sink.reserve(options.weld_vertices()? file.size()/facet_bytes/2+2 : file.size()/facet_bytes*3, file.size()/facet_bytes);
 
-   // read & check endfacet
-   std::getline(stl,line);
-   istringstream in(line);
-   string keyword;
-   in >> keyword;
-   if(keyword != "endfacet") throw logic_error("stl_io::get_facet_ascii(...) expected 'endfacet' , but found " + keyword);
+   read_chunks(nchunk,nthreads,file.size()/nchunk/facet_bytes,options.weld_vertices(),sink,[&](size_t ichunk, stl_facets& facets) {
+      ascii_scanner in(file.begin(),bounds[ichunk+1]);
+      in.set_pos(bounds[ichunk]);
+      try {
+         read_facets_ascii(in,facets);
+      }
+      catch(logic_error& ex) {
+         string message = string(ex.what()) + " at line " + std::to_string(in.line_number()) + ": " + file_path;
+         throw logic_error(message);
+      }
+   });
 
-   return std::move(vtx);
+   sink.end_polyhedron();
 }
 
-
-std::string  stl_io::write_ascii(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path)
+std::string  stl_io::write_ascii(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, const write_options& options)
 {
-   boost::filesystem::path fullpath(file_path);
-   boost::filesystem::path amf_path = fullpath.parent_path() / fullpath.stem();
-   std::string path = amf_path.string() + ".stl";
-
-   ofstream out(path);
-   if(out.is_open()) {
-
-      out << "solid polyfix" << endl;
-
-      for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
-         std::shared_ptr<polyhedron3d> poly = (*polyset)[ipoly];
-         for(size_t iface=0; iface<poly->face_size(); iface++) {
-
-            const pface& face = poly->face(iface);
-            size_t nv = face.size();
-            if(nv > 2) {
-
-               // compute face normal
-               vec3d normal =  poly->face_normal(iface);
-               normal.normalise();
-
-               // facet normal does not require high precision, it is usually ignored, so we save some space instead
-               out << "facet normal "
-                                 << std::setprecision(8) << normal.x() << ' '
-                                 << std::setprecision(8) << normal.y() << ' '
-                                 << std::setprecision(8) << normal.z() << endl;
-
-               out << "   outer loop" << endl;
-               for(size_t iv=0;iv<nv;iv++) {
-                  const pos3d& p = poly->vertex(face[iv]);
-                  out << "      vertex "
-                                 << std::setprecision(16) << p.x() << ' '
-                                 << std::setprecision(16) << p.y() << ' '
-                                 << std::setprecision(16) << p.z() << endl;
-               }
-               out << "   endloop" << endl;
-               out << "endfacet" << endl;
-            }
-         }
-      }
-      out << "endsolid" << endl;
-   }
-   else {
-      string message = "stl_io::write_ascii(...)  Failed to open: " + file_path;
-      throw logic_error(message);
+   std::string path = stl_path(file_path);
+
+   // check faces before the file is created
+   count_triangles(polyset,options,"stl_io::write_ascii(...)",file_path);
+
+   buffered_output_file out(path,"stl_io::write_ascii(...)");
+   ascii_printer printer(out,options.precision());
+
+   printer.text("solid polyfix\n");
+   for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
+      write_ascii_facets(printer,*(*polyset)[ipoly]);
    }
+   printer.text("endsolid\n");
 
+   out.close();
    return path;
 }
 
-
-std::string  stl_io::write_binary(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path)
+std::string  stl_io::write_ascii(const mapped_mesh& mesh, const std::string& file_path, const write_options& options)
 {
-   boost::filesystem::path fullpath(file_path);
-   boost::filesystem::path stl_path = fullpath.parent_path() / fullpath.stem();
-   std::string path = stl_path.string() + ".stl";
-
-   if(FILE* stl = std::fopen(path.c_str(),"wb")) {
+   std::string path = stl_path(file_path);
+   count_triangles(mesh,options,"stl_io::write_ascii(...)",file_path);
 
-      // write the header
-      const size_t blen=80;
-      char buffer[blen];
-      for(size_t i=0; i<blen; i++) buffer[i]=' ';
-      std::fwrite(buffer,sizeof(char),blen,stl);
+   buffered_output_file out(path,"stl_io::write_ascii(...)");
+   ascii_printer printer(out,options.precision());
 
-      // write number of triangles
-      uint32_t ntri=0;
-      for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
-         std::shared_ptr<polyhedron3d> poly = (*polyset)[ipoly];
-         ntri += static_cast<uint32_t>(poly->face_size());
-      }
-      std::fwrite(&ntri,sizeof(uint32_t),1,stl);
+   printer.text("solid polyfix\n");
+   write_ascii_facets(printer,mesh);
+   printer.text("endsolid\n");
 
-      for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
+   out.close();
+   return path;
+}
 
-         std::shared_ptr<polyhedron3d> poly = (*polyset)[ipoly];
-         for(size_t iface=0; iface<poly->face_size(); iface++) {
+std::string  stl_io::write_binary(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, const write_options& options)
+{
+   std::string path = stl_path(file_path);
 
-            const pface& face = poly->face(iface);
-            size_t nv = face.size();
+   // count the triangles to be written, and check faces before the file is created
+   uintmax_t ntri = count_triangles(polyset,options,"stl_io::write_binary(...)",file_path);
+   check_binary_triangle_count(ntri,"stl_io::write_binary(...)",file_path);
 
-            // compute face normal
-            vec3d normal =  poly->face_normal(iface);
-            normal.normalise();
+   // all output goes via a large memory buffer which is flushed in big blocks
+   buffered_output_file out(path,"stl_io::write_binary(...)");
+   write_binary_header(out,ntri);
+   for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
+      write_binary_facets(out,*(*polyset)[ipoly]);
+   }
 
-            // we write regardless of area here, because we didn't check the areas when we computed the number of triangles
-            float xyz[] = {static_cast<float>(normal.x()), static_cast<float>(normal.y()),  static_cast<float>(normal.z()) };
-            std::fwrite(xyz,sizeof(float),3,stl);
+   out.close();
+   return path;
+}
 
-            for(size_t iv=0;iv<nv;iv++) {
-               const pos3d& p = poly->vertex(face[iv]);
-               float xyz[] = {static_cast<float>(p.x()), static_cast<float>(p.y()),  static_cast<float>(p.z()) };
-               std::fwrite(xyz,sizeof(float),3,stl);
-            }
+std::string  stl_io::write_binary(const mapped_mesh& mesh, const std::string& file_path, const write_options& options)
+{
+   std::string path = stl_path(file_path);
+   uintmax_t ntri = count_triangles(mesh,options,"stl_io::write_binary(...)",file_path);
+   check_binary_triangle_count(ntri,"stl_io::write_binary(...)",file_path);
 
-            // write the attribute byte count value
-            uint16_t bcount = 0;
-            std::fwrite(&bcount, sizeof(bcount), 1, stl);
-         }
-      }
+   buffered_output_file out(path,"stl_io::write_binary(...)");
+   write_binary_header(out,ntri);
+   write_binary_facets(out,mesh);
 
-      std::fclose(stl);
-   }
-   else {
-      string message = "stl_io::write_binary(...)  Failed to open: " + file_path;
-      throw logic_error(message);
-   }
+   out.close();
    return path;
 }
 
@@ -17,6 +17,10 @@
 #define STL_IO_H
 
 #include "spaceio_config.h"
+#include "read_options.h"
+#include "polyhedron_sink.h"
+#include "mapped_mesh.h"
+#include "write_options.h"
 
 #include "spacemath/polyhedron3d.h"
 #include <memory>
@@ -34,27 +38,32 @@ public:
    static bool is_stl(const std::string& file_path);
 
    // determine binary/ascii and read as required
-   static std::shared_ptr<ph3d_vector> read(const std::string& file_path);
+   static std::shared_ptr<ph3d_vector> read(const std::string& file_path, const read_options& options = read_options());
+
+   // determine binary/ascii and pass the polyhedron to the sink while reading
+   static void read(const std::string& file_path, polyhedron_sink& sink, const read_options& options = read_options());
 
    // write binary by default
-   static std::string write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, bool binary = true);
+   static std::string write(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, bool binary = true, const write_options& options = write_options());
+   static std::string write(const mapped_mesh& mesh, const std::string& file_path, bool binary = true, const write_options& options = write_options());
 
 protected:
 
-   // read from binary STL, return as vector of polyhedra
-   static std::shared_ptr<ph3d_vector> read_binary(const std::string& file_path);
+   // read from binary STL, pass the polyhedron to the sink
+   static void read_binary(const std::string& file_path, polyhedron_sink& sink, const read_options& options);
 
-   // read from ASCII STL, return as vector of polyhedra
-   static std::shared_ptr<ph3d_vector> read_ascii(const std::string& file_path);
-   static std::vector<pos3d> get_facet_ascii(std::istream& stl);
+   // read from ASCII STL, pass the polyhedron to the sink
+   static void read_ascii(const std::string& file_path, polyhedron_sink& sink, const read_options& options);
 
    // write to ASCII STL, return the path to the file created
    // input is full path to file, file extension will be replaced to ".stl"
-   static std::string  write_ascii(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path);
+   static std::string  write_ascii(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, const write_options& options);
+   static std::string  write_ascii(const mapped_mesh& mesh, const std::string& file_path, const write_options& options);
 
    // write to binary STL, return the path to the file created
    // input is full path to file, file extension will be replaced to ".stl"
-   static std::string  write_binary(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path);
+   static std::string  write_binary(std::shared_ptr<ph3d_vector> polyset, const std::string& file_path, const write_options& options);
+   static std::string  write_binary(const mapped_mesh& mesh, const std::string& file_path, const write_options& options);
 
 };
 
@@ -0,0 +1,124 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef VERTEX_WELD_MAP_H
+#define VERTEX_WELD_MAP_H
+
+#include "spacemath/polyhedron3d.h"
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+namespace spaceio {
+
+// vertex_weld_map is a flat open addressing hash table used for sharing
+// vertices with exactly equal coordinates while a file is being read.
+// The table stores only vertex indices, coordinates are kept in the vertex vector.
+// No tolerance is applied, use polyfix::merge_vertices for tolerance based merging.
+
+class vertex_weld_map {
+public:
+   vertex_weld_map(vtx_vec& vert, size_t expected_size = 0)
+   : m_vert(vert), m_count(0)
+   {
+      size_t capacity = 16;
+      while(capacity < 2*expected_size) capacity *= 2;
+      m_slots.assign(capacity,empty_slot());
+   }
+
+   // return index of existing vertex with coordinates (x,y,z),
+   // or append a new vertex to the vertex vector and return its index
+   inline id_vertex insert(double x, double y, double z)
+   {
+      if(2*(m_count+1) > m_slots.size()) grow();
+
+      size_t mask = m_slots.size()-1;
+      size_t slot = hash(x,y,z) & mask;
+      while(m_slots[slot] != empty_slot()) {
+         const spacemath::pos3d& p = m_vert[m_slots[slot]];
+         if(p.x()==x && p.y()==y && p.z()==z) return m_slots[slot];
+         slot = (slot+1) & mask;
+      }
+
+      id_vertex iv = m_vert.size();
+      m_vert.push_back(spacemath::pos3d(x,y,z));
+      m_slots[slot] = iv;
+      m_count++;
+      return iv;
+   }
+
+   // number of unique vertices inserted
+   inline size_t size() const { return m_count; }
+
+   // forget all vertices, the vertex vector must be cleared separately
+   void clear()
+   {
+      m_slots.assign(m_slots.size(),empty_slot());
+      m_count = 0;
+   }
+
+private:
+   static inline id_vertex empty_slot() { return ~id_vertex(0); }
+
+   static inline uint64_t bits(double v)
+   {
+      // adding 0.0 turns -0.0 into +0.0, so both get the same hash
+      v += 0.0;
+      uint64_t b;
+      std::memcpy(&b,&v,sizeof(b));
+      return b;
+   }
+
+   static inline uint64_t mix(uint64_t h)
+   {
+      // splitmix64 finalizer
+      h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+      h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+      h ^= h >> 31;
+      return h;
+   }
+
+   static inline size_t hash(double x, double y, double z)
+   {
+      uint64_t h = mix(bits(x));
+      h = mix(h ^ bits(y));
+      h = mix(h ^ bits(z));
+      return static_cast<size_t>(h);
+   }
+
+   void grow()
+   {
+      std::vector<id_vertex> slots(m_slots.size()*2,empty_slot());
+      size_t mask = slots.size()-1;
+      for(id_vertex iv : m_slots) {
+         if(iv != empty_slot()) {
+            const spacemath::pos3d& p = m_vert[iv];
+            size_t slot = hash(p.x(),p.y(),p.z()) & mask;
+            while(slots[slot] != empty_slot()) slot = (slot+1) & mask;
+            slots[slot] = iv;
+         }
+      }
+      m_slots.swap(slots);
+   }
+
+private:
+   vtx_vec&               m_vert;   // vertex vector receiving unique vertices
+   std::vector<id_vertex> m_slots;  // hash table slots, empty_slot() or index into m_vert
+   size_t                 m_count;  // number of occupied slots
+};
+
+} // namespace spaceio
+
+#endif // VERTEX_WELD_MAP_H
@@ -0,0 +1,45 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef WRITE_OPTIONS_H
+#define WRITE_OPTIONS_H
+
+#include <cstddef>
+
+namespace spaceio {
+
+// Options for polyhedron export (see stl_io, obj_io, off_io)
+class write_options {
+public:
+   write_options() : m_triangulate_faces(true), m_precision(0) {}
+
+   // when true, faces with more than 3 vertices are split into a triangle fan
+   // for formats requiring triangles (STL). When false, such faces cause an exception.
+   inline bool triangulate_faces() const              { return m_triangulate_faces; }
+   void set_triangulate_faces(bool triangulate_faces)  { m_triangulate_faces = triangulate_faces; }
+
+   // significant digits of vertex coordinates in ASCII formats (max 17). 0 means the shortest
+   // representation that reads back as the identical double
+   inline int precision() const                       { return m_precision; }
+   void set_precision(int precision)                   { m_precision = precision; }
+
+private:
+   bool  m_triangulate_faces;  // default:true. Split N-sided faces into triangle fans
+   int   m_precision;          // default:0. Shortest round trip ASCII coordinates
+};
+
+} // namespace spaceio
+
+#endif // WRITE_OPTIONS_H
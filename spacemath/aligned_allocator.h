@@ -0,0 +1,75 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+// aligned_allocator is a standard allocator returning memory aligned to a given boundary,
+// so that arrays can be processed with aligned SIMD loads. Alignment must be a power of 2.
+
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace spacemath {
+
+   template <class T, size_t Alignment = 64>
+   class aligned_allocator {
+   public:
+      typedef T         value_type;
+      typedef T*        pointer;
+      typedef const T*  const_pointer;
+      typedef T&        reference;
+      typedef const T&  const_reference;
+      typedef size_t    size_type;
+      typedef ptrdiff_t difference_type;
+
+      template <class U> struct rebind { typedef aligned_allocator<U,Alignment> other; };
+
+      aligned_allocator() {}
+      template <class U> aligned_allocator(const aligned_allocator<U,Alignment>&) {}
+
+      // largest n that can be allocated including the alignment overhead
+      size_t max_size() const
+      {
+         return (std::numeric_limits<size_t>::max() - Alignment - sizeof(void*)) / sizeof(T);
+      }
+
+      T* allocate(size_t n)
+      {
+         if(n > max_size()) throw std::bad_array_new_length();
+
+         // over-allocate and keep the original pointer just before the aligned block
+         void* raw = std::malloc(n*sizeof(T) + Alignment + sizeof(void*));
+         if(!raw) throw std::bad_alloc();
+         uintptr_t first   = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+         uintptr_t aligned = (first + Alignment - 1) & ~uintptr_t(Alignment - 1);
+         reinterpret_cast<void**>(aligned)[-1] = raw;
+         return reinterpret_cast<T*>(aligned);
+      }
+
+      void deallocate(T* p, size_t)
+      {
+         if(p) std::free(reinterpret_cast<void**>(p)[-1]);
+      }
+
+      template <class U> bool operator==(const aligned_allocator<U,Alignment>&) const { return true; }
+      template <class U> bool operator!=(const aligned_allocator<U,Alignment>&) const { return false; }
+   };
+
+}
+
+#endif // ALIGNED_ALLOCATOR_H
@@ -31,6 +31,10 @@ namespace spacemath {
       setBox(pos1,pos2);
    }
 
+   bbox3d::bbox3d(const bbox3d& box)
+   : m_p1(box.m_p1),m_p2(box.m_p2),m_initialised(box.m_initialised)
+   {}
+
    bbox3d::~bbox3d()
    {
    }
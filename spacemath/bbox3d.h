@@ -27,6 +27,7 @@ namespace spacemath {
    public:
       bbox3d(bool initialised = false);
       bbox3d(const pos3d& pos1, const pos3d& pos2);
+      bbox3d(const bbox3d& box);
       virtual ~bbox3d();
 
       bool initialised() const;
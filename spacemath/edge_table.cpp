@@ -0,0 +1,130 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "edge_table.h"
+#include "parallel_for.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace spacemath {
+
+   // a face coedge while building the table
+   struct coedge_entry {
+      id_edge edge;
+      id_face face;
+      size_t  slot;   // position in m_coedge_edge
+   };
+
+   inline bool operator<(const coedge_entry& a, const coedge_entry& b)
+   {
+      // slot order equals face order, so faces end up sorted within each edge
+      return (a.edge < b.edge) || ((a.edge == b.edge) && (a.slot < b.slot));
+   }
+
+   const size_t edge_table::npos;
+
+   edge_table::edge_table()
+   {
+      clear();
+   }
+
+   edge_table::edge_table(const polyhedron3d& poly, size_t nthreads)
+   {
+      build(poly,nthreads);
+   }
+
+   edge_table::~edge_table()
+   {}
+
+   void edge_table::clear()
+   {
+      m_edge.clear();
+      m_edge_offset.assign(1,0);
+      m_edge_face.clear();
+      m_face_offset.assign(1,0);
+      m_coedge_edge.clear();
+   }
+
+   void edge_table::build(const polyhedron3d& poly, size_t nthreads)
+   {
+      clear();
+
+      if(poly.vertex_size() > polyhedron3d::max_edge_vertex+1) {
+         throw std::logic_error("edge_table::build, too many vertices for edge identifiers: " + std::to_string(poly.vertex_size()));
+      }
+
+      // coedge range of each face
+      size_t nface = poly.face_size();
+      m_face_offset.resize(nface+1);
+      for(size_t iface=0; iface<nface; iface++) {
+         m_face_offset[iface+1] = m_face_offset[iface] + poly.face(iface).size();
+      }
+      size_t ncoedge = m_face_offset[nface];
+
+      // collect all coedges in parallel, each face writes its own range
+      std::vector<coedge_entry> coedges(ncoedge);
+      parallel_for(nface,nthreads,1<<14,[this,&poly,&coedges](size_t first, size_t last) {
+         for(size_t iface=first; iface<last; iface++) {
+            const pface& face = poly.face(iface);
+            size_t nedge     = face.size();
+            size_t last_edge = nedge-1;
+            size_t slot      = m_face_offset[iface];
+            for(size_t iedge=0; iedge<nedge; iedge++) {
+               id_vertex iv0 = face[iedge];
+               id_vertex iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
+               coedge_entry& entry = coedges[slot];
+               entry.edge = polyhedron3d::EDGE(iv0,iv1);
+               entry.face = iface;
+               entry.slot = slot++;
+            }
+         }
+      });
+
+      // group coedges by edge
+      parallel_sort(coedges.begin(),coedges.end(),std::less<coedge_entry>(),nthreads);
+
+      // assign edge indices in one sweep over the sorted coedges
+      m_edge_face.resize(ncoedge);
+      m_coedge_edge.resize(ncoedge);
+      for(size_t i=0; i<ncoedge; i++) {
+         const coedge_entry& entry = coedges[i];
+         if(m_edge.empty() || m_edge.back() != entry.edge) {
+            if(!m_edge.empty()) m_edge_offset.push_back(i);
+            m_edge.push_back(entry.edge);
+         }
+         m_edge_face[i]            = entry.face;
+         m_coedge_edge[entry.slot] = m_edge.size()-1;
+      }
+      if(!m_edge.empty()) m_edge_offset.push_back(ncoedge);
+   }
+
+   size_t edge_table::find(id_edge iedge) const
+   {
+      auto it = std::lower_bound(m_edge.begin(),m_edge.end(),iedge);
+      return (it != m_edge.end() && *it == iedge)? size_t(it - m_edge.begin()) : npos;
+   }
+
+   edge_count_map edge_table::use_count_map() const
+   {
+      edge_count_map edge_count;
+      edge_count.reserve(m_edge.size());
+      for(size_t ie=0; ie<m_edge.size(); ie++) {
+         edge_count[m_edge[ie]] = use_count(ie);
+      }
+      return edge_count;
+   }
+
+}
@@ -0,0 +1,85 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef EDGE_TABLE_H
+#define EDGE_TABLE_H
+
+#include "spacemath_config.h"
+#include "polyhedron3d.h"
+#include <vector>
+
+namespace spacemath {
+
+   // edge_table is a flat, sort based table of the edges in a polyhedron3d and the faces using them.
+   // All face coedges are collected in one parallel pass and sorted by id_edge, so each unique edge
+   // gets a contiguous edge index [0,size()) and the faces using it are stored in one flat array (CSR layout).
+   // Every face coedge is also mapped to its edge index, so edge use counts and neighbour faces
+   // can be looked up without any hashing.
+   // The table is a snapshot and must be rebuilt when the polyhedron faces change.
+   class SPACEMATH_PUBLIC edge_table {
+   public:
+      static const size_t npos = static_cast<size_t>(-1);
+
+      edge_table();
+      explicit edge_table(const polyhedron3d& poly, size_t nthreads = 0);
+      virtual ~edge_table();
+
+      // build the table for the given polyhedron, using up to nthreads threads (0=all hardware threads)
+      void build(const polyhedron3d& poly, size_t nthreads = 0);
+
+      // remove all table data
+      void clear();
+
+      // === EDGES
+
+      // number of unique edges
+      inline size_t         size() const                  { return m_edge.size(); }
+
+      // edge identifier and vertices of edge ie. Edges are sorted by increasing id_edge
+      inline id_edge        edge(size_t ie) const         { return m_edge[ie]; }
+      inline vertex_pair    edge_vertices(size_t ie) const { return polyhedron3d::EDGE_VERTICES(m_edge[ie]); }
+
+      // number of face coedges using edge ie, 2 for a manifold edge
+      inline size_t         use_count(size_t ie) const    { return m_edge_offset[ie+1] - m_edge_offset[ie]; }
+
+      // faces using edge ie, in increasing face order. A face using the edge twice is listed twice
+      inline const id_face* face_begin(size_t ie) const   { return m_edge_face.data() + m_edge_offset[ie]; }
+      inline const id_face* face_end(size_t ie) const     { return m_edge_face.data() + m_edge_offset[ie+1]; }
+
+      // return edge index of given edge identifier, or npos if the edge does not exist
+      size_t                find(id_edge iedge) const;
+
+      // === FACES
+
+      // number of faces in the polyhedron the table was built from
+      inline size_t         face_size() const             { return m_face_offset.size() - 1; }
+
+      // edge index of coedge k in face iface, i.e. the coedge from face[k] to face[k+1]
+      inline size_t         face_edge(id_face iface, size_t k) const { return m_coedge_edge[m_face_offset[iface] + k]; }
+
+      // return the edge use counts in the traditional map form
+      edge_count_map        use_count_map() const;
+
+   private:
+      std::vector<id_edge>  m_edge;         // unique edges, sorted
+      std::vector<size_t>   m_edge_offset;  // m_edge_face range of each edge, size()+1 entries
+      std::vector<id_face>  m_edge_face;    // faces using each edge
+      std::vector<size_t>   m_face_offset;  // m_coedge_edge range of each face, face_size()+1 entries
+      std::vector<size_t>   m_coedge_edge;  // edge index of each face coedge
+   };
+
+}
+
+#endif // EDGE_TABLE_H
@@ -0,0 +1,184 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "flat_polyhedron3d.h"
+#include <limits>
+#include <stdexcept>
+#include "polygon_normal.h"
+
+namespace spacemath {
+
+   flat_polyhedron3d::flat_polyhedron3d()
+   : m_nface(0)
+   , m_all_triangles(true)
+   , m_wide(false)
+   {}
+
+   flat_polyhedron3d::flat_polyhedron3d(const vtx_vec& vert, const pface_vec& faces)
+   : m_vert(vert)
+   , m_nface(0)
+   , m_all_triangles(true)
+   , m_wide(false)
+   {
+      size_t nindex = 0;
+      for(auto& face : faces) nindex += face.size();
+      reserve(faces.size(),nindex);
+      for(auto& face : faces) add_face(face);
+   }
+
+   flat_polyhedron3d::flat_polyhedron3d(vtx_vec&& vert, const pface_vec& faces)
+   : m_vert(std::move(vert))
+   , m_nface(0)
+   , m_all_triangles(true)
+   , m_wide(false)
+   {
+      size_t nindex = 0;
+      for(auto& face : faces) nindex += face.size();
+      reserve(faces.size(),nindex);
+      for(auto& face : faces) add_face(face);
+   }
+
+   flat_polyhedron3d::flat_polyhedron3d(const polyhedron3d& poly)
+   : m_nface(0)
+   , m_all_triangles(true)
+   , m_wide(false)
+   {
+      m_vert.reserve(poly.vertex_size());
+      for(size_t iv=0; iv<poly.vertex_size(); iv++) m_vert.push_back(poly.vertex(iv));
+
+      size_t nindex = 0;
+      for(size_t iface=0; iface<poly.face_size(); iface++) nindex += poly.face(iface).size();
+      reserve(poly.face_size(),nindex);
+      for(size_t iface=0; iface<poly.face_size(); iface++) add_face(poly.face(iface));
+   }
+
+   flat_polyhedron3d::~flat_polyhedron3d()
+   {}
+
+   void flat_polyhedron3d::clear()
+   {
+      m_vert.clear();
+      m_nface = 0;
+      m_all_triangles = true;
+      m_wide = false;
+      m_index32.clear();
+      m_offset32.clear();
+      m_index64.clear();
+      m_offset64.clear();
+   }
+
+   void flat_polyhedron3d::reserve(size_t nface, size_t nindex)
+   {
+      // choose the index width up front when the final size is known, to avoid converting later
+      if(!m_wide && (m_vert.size() > std::numeric_limits<uint32_t>::max() || nindex > std::numeric_limits<uint32_t>::max())) make_wide();
+
+      bool triangles = m_all_triangles && (nindex == 3*nface);
+      if(m_wide) {
+         m_index64.reserve(nindex);
+         if(!triangles) m_offset64.reserve(nface+1);
+      }
+      else {
+         m_index32.reserve(nindex);
+         if(!triangles) m_offset32.reserve(nface+1);
+      }
+   }
+
+   id_vertex flat_polyhedron3d::add_vertex(const pos3d& pos)
+   {
+      m_vert.push_back(pos);
+      return m_vert.size()-1;
+   }
+
+   id_face flat_polyhedron3d::add_face(const id_vertex* index, size_t nvert)
+   {
+      if(m_all_triangles && nvert != 3) make_offsets();
+
+      if(!m_wide) {
+         const size_t max32 = std::numeric_limits<uint32_t>::max();
+         bool fits = (m_index32.size() + nvert <= max32);
+         for(size_t i=0; fits && i<nvert; i++) fits = (index[i] <= max32);
+         if(!fits) make_wide();
+      }
+
+      if(m_wide) {
+         m_index64.insert(m_index64.end(),index,index+nvert);
+         if(!m_all_triangles) m_offset64.push_back(m_index64.size());
+      }
+      else {
+         for(size_t i=0; i<nvert; i++) m_index32.push_back(static_cast<uint32_t>(index[i]));
+         if(!m_all_triangles) m_offset32.push_back(static_cast<uint32_t>(m_index32.size()));
+      }
+      return m_nface++;
+   }
+
+   void flat_polyhedron3d::make_offsets()
+   {
+      m_all_triangles = false;
+      if(m_wide) {
+         m_offset64.reserve(m_nface+1);
+         for(size_t i=0; i<=m_nface; i++) m_offset64.push_back(3*i);
+      }
+      else {
+         m_offset32.reserve(m_nface+1);
+         for(size_t i=0; i<=m_nface; i++) m_offset32.push_back(static_cast<uint32_t>(3*i));
+      }
+   }
+
+   void flat_polyhedron3d::make_wide()
+   {
+      m_wide = true;
+      m_index64.assign(m_index32.begin(),m_index32.end());
+      m_offset64.assign(m_offset32.begin(),m_offset32.end());
+      std::vector<uint32_t>().swap(m_index32);
+      std::vector<uint32_t>().swap(m_offset32);
+   }
+
+   size_t flat_polyhedron3d::face_memory() const
+   {
+      return m_index32.capacity()*sizeof(uint32_t) + m_offset32.capacity()*sizeof(uint32_t)
+           + m_index64.capacity()*sizeof(uint64_t) + m_offset64.capacity()*sizeof(uint64_t);
+   }
+
+   vec3d flat_polyhedron3d::face_normal(id_face iface) const
+   {
+      if(iface >= m_nface)throw std::logic_error("flat_polyhedron3d::face_normal() face index out of range");
+      return polygon_normal(*this,face(iface));
+   }
+
+   double flat_polyhedron3d::volume() const
+   {
+      if(m_nface==0)throw std::logic_error("flat_polyhedron3d::volume() not implemented for polyhedron with no faces");
+
+      if(!m_all_triangles) {
+         for(size_t iface=0; iface<m_nface; iface++) {
+            size_t nvert = face_offset(iface+1) - face_offset(iface);
+            if(nvert != 3 && nvert != 4) {
+               throw std::logic_error("flat_polyhedron3d::volume() requires triangular or quadrilateral faces only.");
+            }
+         }
+      }
+
+      return compute_mass_properties(*this).volume;
+   }
+
+   std::shared_ptr<polyhedron3d> flat_polyhedron3d::create_polyhedron() const
+   {
+      pface_vec faces;
+      faces.reserve(m_nface);
+      for(size_t iface=0; iface<m_nface; iface++) faces.push_back(face(iface).to_pface());
+      return std::make_shared<polyhedron3d>(vtx_vec(m_vert),std::move(faces));
+   }
+
+}
@@ -0,0 +1,174 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef FLAT_POLYHEDRON3D_H
+#define FLAT_POLYHEDRON3D_H
+
+#include "spacemath_config.h"
+#include "polyhedron3d.h"
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace spacemath {
+
+   // face_span is a lightweight read-only view of the vertex indices of one face in a flat_polyhedron3d.
+   // It refers directly into the index array, which may use 32 or 64 bit indices.
+   // Spans and their iterators remain valid as long as the polyhedron is not modified.
+   class face_span {
+   public:
+      class const_iterator {
+      public:
+         typedef std::random_access_iterator_tag iterator_category;
+         typedef id_vertex                       value_type;
+         typedef std::ptrdiff_t                  difference_type;
+         typedef const id_vertex*                pointer;
+         typedef id_vertex                       reference;
+
+         const_iterator() : m_index32(0), m_index64(0), m_i(0) {}
+         const_iterator(const uint32_t* index32, const uint64_t* index64, size_t i) : m_index32(index32), m_index64(index64), m_i(i) {}
+         inline id_vertex       operator*() const                              { return at(m_i); }
+         inline id_vertex       operator[](difference_type n) const            { return at(m_i+n); }
+         inline const_iterator& operator++()                                   { ++m_i; return *this; }
+         inline const_iterator  operator++(int)                                { const_iterator it(*this); ++m_i; return it; }
+         inline const_iterator& operator--()                                   { --m_i; return *this; }
+         inline const_iterator  operator--(int)                                { const_iterator it(*this); --m_i; return it; }
+         inline const_iterator& operator+=(difference_type n)                  { m_i += n; return *this; }
+         inline const_iterator& operator-=(difference_type n)                  { m_i -= n; return *this; }
+         inline const_iterator  operator+(difference_type n) const             { return const_iterator(m_index32,m_index64,m_i+n); }
+         inline const_iterator  operator-(difference_type n) const             { return const_iterator(m_index32,m_index64,m_i-n); }
+         inline difference_type operator-(const const_iterator& other) const   { return difference_type(m_i) - difference_type(other.m_i); }
+         inline bool            operator==(const const_iterator& other) const  { return same_face(other) && m_i == other.m_i; }
+         inline bool            operator!=(const const_iterator& other) const  { return !(*this == other); }
+         inline bool            operator<(const const_iterator& other) const   { return m_i <  other.m_i; }
+         inline bool            operator>(const const_iterator& other) const   { return m_i >  other.m_i; }
+         inline bool            operator<=(const const_iterator& other) const  { return m_i <= other.m_i; }
+         inline bool            operator>=(const const_iterator& other) const  { return m_i >= other.m_i; }
+         friend const_iterator  operator+(difference_type n, const const_iterator& it) { return it + n; }
+      private:
+         inline id_vertex at(size_t i) const                                   { return (m_index32)? m_index32[i] : static_cast<id_vertex>(m_index64[i]); }
+         inline bool      same_face(const const_iterator& other) const         { return m_index32 == other.m_index32 && m_index64 == other.m_index64; }
+      private:
+         const uint32_t* m_index32;  // first index of the face, used when not null
+         const uint64_t* m_index64;
+         size_t          m_i;        // position within the face
+      };
+
+      face_span(const uint32_t* first, size_t size) : m_index32(first), m_index64(0), m_size(size) {}
+      face_span(const uint64_t* first, size_t size) : m_index32(0), m_index64(first), m_size(size) {}
+
+      inline size_t         size() const                 { return m_size; }
+      inline id_vertex      operator[](size_t i) const   { return (m_index32)? m_index32[i] : static_cast<id_vertex>(m_index64[i]); }
+      inline const_iterator begin() const                { return const_iterator(m_index32,m_index64,0); }
+      inline const_iterator end() const                  { return const_iterator(m_index32,m_index64,m_size); }
+
+      // copy to a regular polyhedron face
+      pface to_pface() const                             { return pface(begin(),end()); }
+
+   private:
+      const uint32_t* m_index32;  // used when not null
+      const uint64_t* m_index64;
+      size_t          m_size;
+   };
+
+   // flat_polyhedron3d is a memory compact sibling of polyhedron3d. Faces are stored in one flat index
+   // array with an offset array marking where each face starts (CSR layout) instead of one vector per face.
+   // Indices are 32 bit as long as the vertex and index counts allow, and the offsets are omitted
+   // entirely while all faces are triangles. This typically cuts face memory by a factor 3-5 and
+   // makes face traversal cache friendly.
+   // The face(i)/face_size() interface mirrors polyhedron3d, with face(i) returning a face_span.
+   class SPACEMATH_PUBLIC flat_polyhedron3d {
+   public:
+      flat_polyhedron3d();
+      flat_polyhedron3d(const vtx_vec& vert, const pface_vec& faces);
+      flat_polyhedron3d(vtx_vec&& vert, const pface_vec& faces);
+      explicit flat_polyhedron3d(const polyhedron3d& poly);
+      virtual ~flat_polyhedron3d();
+
+      // clear all
+      void clear();
+
+      // reserve space for faces, nindex is the total number of face vertex indices
+      void reserve(size_t nface, size_t nindex);
+
+      // add a vertex, return its index
+      id_vertex add_vertex(const pos3d& pos);
+
+      // add a face, return its index. The storage is converted as required when
+      // the first non-triangle or the first index not fitting in 32 bit is added
+      id_face add_face(const id_vertex* index, size_t nvert);
+      inline id_face add_face(const pface& face) { return add_face(face.data(),face.size()); }
+
+      // vertex traversal
+      inline size_t vertex_size() const          { return m_vert.size(); }
+      inline const pos3d& vertex(size_t i) const { return m_vert[i]; }
+
+      // non-const vertex overload allows modifying coordinate of existing vertex, see polyhedron3d::vertex
+      inline pos3d& vertex(size_t i)             { return m_vert[i]; }
+
+      // modify coordinate of existing vertex, same as polyhedron3d::set_vertex
+      inline void set_vertex(size_t i, const pos3d& pos) { m_vert[i] = pos; }
+
+      // face traversal
+      inline size_t face_size() const            { return m_nface; }
+      inline face_span face(size_t i) const
+      {
+         size_t first = (m_all_triangles)? 3*i     : face_offset(i);
+         size_t size  = (m_all_triangles)? 3       : face_offset(i+1) - first;
+         return (m_wide)? face_span(m_index64.data()+first,size) : face_span(m_index32.data()+first,size);
+      }
+
+      // true when all faces are triangles, the faces are then stored without offsets
+      inline bool all_triangles() const          { return m_all_triangles; }
+
+      // true when 64 bit indices are used
+      inline bool wide_index() const             { return m_wide; }
+
+      // number of bytes used for face storage
+      size_t face_memory() const;
+
+      // return face normal vector, not normalised, see polyhedron3d::face_normal
+      vec3d  face_normal(id_face iface) const;
+
+      // compute volume of polyhedron, see polyhedron3d::volume
+      double volume() const;
+
+      // create a regular polyhedron3d copy
+      std::shared_ptr<polyhedron3d> create_polyhedron() const;
+
+   private:
+      inline size_t face_offset(size_t i) const  { return (m_wide)? size_t(m_offset64[i]) : size_t(m_offset32[i]); }
+
+      // change to CSR layout by creating the offset array
+      void make_offsets();
+
+      // change to 64 bit indices and offsets
+      void make_wide();
+
+   private:
+      vtx_vec               m_vert;          // vertex vector
+      size_t                m_nface;         // number of faces
+      bool                  m_all_triangles; // true: no offsets, face i starts at 3*i
+      bool                  m_wide;          // true: 64 bit arrays are in use
+      std::vector<uint32_t> m_index32;       // face vertex indices, all faces concatenated
+      std::vector<uint32_t> m_offset32;      // face start in m_index32, face_size()+1 entries
+      std::vector<uint64_t> m_index64;       // wide variants of the above
+      std::vector<uint64_t> m_offset64;
+   };
+
+}
+
+#endif // FLAT_POLYHEDRON3D_H
@@ -0,0 +1,251 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "mass_properties.h"
+#include "polyhedron3d.h"
+#include "flat_polyhedron3d.h"
+#include "polygon_normal.h"
+#include "aligned_allocator.h"
+#include <cmath>
+#include <vector>
+
+#if defined(__AVX__)
+   #include <immintrin.h>
+   #define SPACEMATH_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+   #include <emmintrin.h>
+   #define SPACEMATH_SIMD_SSE2
+#endif
+
+namespace spacemath {
+
+   // minimal SIMD abstraction: the same kernel source is compiled for AVX (4 lanes), SSE2 (2 lanes) or scalar code
+#if defined(SPACEMATH_SIMD_AVX)
+   typedef __m256d simd_double;
+   static const size_t simd_width = 4;
+   static inline simd_double simd_load(const double* p)               { return _mm256_load_pd(p); }
+   static inline void        simd_store(double* p, simd_double a)     { _mm256_store_pd(p,a); }
+   static inline simd_double simd_add(simd_double a, simd_double b)   { return _mm256_add_pd(a,b); }
+   static inline simd_double simd_sub(simd_double a, simd_double b)   { return _mm256_sub_pd(a,b); }
+   static inline simd_double simd_mul(simd_double a, simd_double b)   { return _mm256_mul_pd(a,b); }
+   static inline simd_double simd_sqrt(simd_double a)                 { return _mm256_sqrt_pd(a); }
+#elif defined(SPACEMATH_SIMD_SSE2)
+   typedef __m128d simd_double;
+   static const size_t simd_width = 2;
+   static inline simd_double simd_load(const double* p)               { return _mm_load_pd(p); }
+   static inline void        simd_store(double* p, simd_double a)     { _mm_store_pd(p,a); }
+   static inline simd_double simd_add(simd_double a, simd_double b)   { return _mm_add_pd(a,b); }
+   static inline simd_double simd_sub(simd_double a, simd_double b)   { return _mm_sub_pd(a,b); }
+   static inline simd_double simd_mul(simd_double a, simd_double b)   { return _mm_mul_pd(a,b); }
+   static inline simd_double simd_sqrt(simd_double a)                 { return _mm_sqrt_pd(a); }
+#else
+   typedef double simd_double;
+   static const size_t simd_width = 1;
+   static inline simd_double simd_load(const double* p)               { return *p; }
+   static inline void        simd_store(double* p, simd_double a)     { *p = a; }
+   static inline simd_double simd_add(simd_double a, simd_double b)   { return a+b; }
+   static inline simd_double simd_sub(simd_double a, simd_double b)   { return a-b; }
+   static inline simd_double simd_mul(simd_double a, simd_double b)   { return a*b; }
+   static inline simd_double simd_sqrt(simd_double a)                 { return std::sqrt(a); }
+#endif
+
+   // per-triangle input and output arrays, structure of arrays layout
+   enum batch_input  { AX, AY, AZ, BX, BY, BZ, CX, CY, CZ, WEIGHT, NINPUT };
+   enum batch_output { VOL, AREA, MX, MY, MZ, CXX, CYY, CZZ, CXY, CXZ, CYZ, NOUTPUT };
+
+   // Neumaier's variant of Kahan summation
+   class compensated_sum {
+   public:
+      compensated_sum() : m_sum(0.0), m_comp(0.0) {}
+      inline void add(double value)
+      {
+         double t = m_sum + value;
+         if(std::fabs(m_sum) >= std::fabs(value)) m_comp += (m_sum - t) + value;
+         else                                     m_comp += (value - t) + m_sum;
+         m_sum = t;
+      }
+      inline double value() const { return m_sum + m_comp; }
+   private:
+      double m_sum;
+      double m_comp;
+   };
+
+   // pairwise summation, error grows with log(n) instead of n
+   static double pairwise_sum(const double* p, size_t n)
+   {
+      if(n <= 16) {
+         double sum = 0.0;
+         for(size_t i=0; i<n; i++) sum += p[i];
+         return sum;
+      }
+      size_t half = n/2;
+      return pairwise_sum(p,half) + pairwise_sum(p+half,n-half);
+   }
+
+   class mass_batch {
+   public:
+      static const size_t capacity = 512;
+
+      mass_batch() : m_in(NINPUT*capacity), m_out(NOUTPUT*capacity), m_size(0) {}
+
+      inline bool full() const { return m_size == capacity; }
+
+      inline void add(const pos3d& a, const pos3d& b, const pos3d& c, double weight)
+      {
+         double* in = m_in.data() + m_size;
+         in[AX*capacity] = a.x(); in[AY*capacity] = a.y(); in[AZ*capacity] = a.z();
+         in[BX*capacity] = b.x(); in[BY*capacity] = b.y(); in[BZ*capacity] = b.z();
+         in[CX*capacity] = c.x(); in[CY*capacity] = c.y(); in[CZ*capacity] = c.z();
+         in[WEIGHT*capacity] = weight;
+         m_size++;
+      }
+
+      // compute the batch and add its sums to the accumulators
+      void flush(compensated_sum* sums)
+      {
+         if(m_size == 0) return;
+
+         // pad to a whole number of SIMD lanes with degenerate triangles contributing zero
+         size_t n = ((m_size + simd_width - 1)/simd_width)*simd_width;
+         for(size_t i=m_size; i<n; i++) {
+            for(size_t k=0; k<NINPUT; k++) m_in[k*capacity+i] = 0.0;
+         }
+
+         const double* in  = m_in.data();
+         double*       out = m_out.data();
+         for(size_t i=0; i<n; i+=simd_width) {
+            simd_double ax = simd_load(in+AX*capacity+i), ay = simd_load(in+AY*capacity+i), az = simd_load(in+AZ*capacity+i);
+            simd_double bx = simd_load(in+BX*capacity+i), by = simd_load(in+BY*capacity+i), bz = simd_load(in+BZ*capacity+i);
+            simd_double cx = simd_load(in+CX*capacity+i), cy = simd_load(in+CY*capacity+i), cz = simd_load(in+CZ*capacity+i);
+
+            // 6 times signed volume of the tetrahedron (origin,a,b,c) = a.(b x c)
+            simd_double d = simd_add(simd_add(simd_mul(ax,simd_sub(simd_mul(by,cz),simd_mul(bz,cy))),
+                                              simd_mul(ay,simd_sub(simd_mul(bz,cx),simd_mul(bx,cz)))),
+                                              simd_mul(az,simd_sub(simd_mul(bx,cy),simd_mul(by,cx))));
+
+            // twice the triangle area = |(b-a) x (c-a)|
+            simd_double ux = simd_sub(bx,ax), uy = simd_sub(by,ay), uz = simd_sub(bz,az);
+            simd_double vx = simd_sub(cx,ax), vy = simd_sub(cy,ay), vz = simd_sub(cz,az);
+            simd_double nx = simd_sub(simd_mul(uy,vz),simd_mul(uz,vy));
+            simd_double ny = simd_sub(simd_mul(uz,vx),simd_mul(ux,vz));
+            simd_double nz = simd_sub(simd_mul(ux,vy),simd_mul(uy,vx));
+            simd_double area2 = simd_sqrt(simd_add(simd_add(simd_mul(nx,nx),simd_mul(ny,ny)),simd_mul(nz,nz)));
+
+            // first moments d*(a+b+c) and second moments d*(a_i*a_j + b_i*b_j + c_i*c_j + s_i*s_j)
+            simd_double sx = simd_add(simd_add(ax,bx),cx), sy = simd_add(simd_add(ay,by),cy), sz = simd_add(simd_add(az,bz),cz);
+            simd_double pxx = simd_add(simd_add(simd_mul(ax,ax),simd_mul(bx,bx)),simd_add(simd_mul(cx,cx),simd_mul(sx,sx)));
+            simd_double pyy = simd_add(simd_add(simd_mul(ay,ay),simd_mul(by,by)),simd_add(simd_mul(cy,cy),simd_mul(sy,sy)));
+            simd_double pzz = simd_add(simd_add(simd_mul(az,az),simd_mul(bz,bz)),simd_add(simd_mul(cz,cz),simd_mul(sz,sz)));
+            simd_double pxy = simd_add(simd_add(simd_mul(ax,ay),simd_mul(bx,by)),simd_add(simd_mul(cx,cy),simd_mul(sx,sy)));
+            simd_double pxz = simd_add(simd_add(simd_mul(ax,az),simd_mul(bx,bz)),simd_add(simd_mul(cx,cz),simd_mul(sx,sz)));
+            simd_double pyz = simd_add(simd_add(simd_mul(ay,az),simd_mul(by,bz)),simd_add(simd_mul(cy,cz),simd_mul(sy,sz)));
+
+            simd_store(out+VOL*capacity+i,d);
+            simd_store(out+AREA*capacity+i,simd_mul(area2,simd_load(in+WEIGHT*capacity+i)));
+            simd_store(out+MX*capacity+i,simd_mul(d,sx));
+            simd_store(out+MY*capacity+i,simd_mul(d,sy));
+            simd_store(out+MZ*capacity+i,simd_mul(d,sz));
+            simd_store(out+CXX*capacity+i,simd_mul(d,pxx));
+            simd_store(out+CYY*capacity+i,simd_mul(d,pyy));
+            simd_store(out+CZZ*capacity+i,simd_mul(d,pzz));
+            simd_store(out+CXY*capacity+i,simd_mul(d,pxy));
+            simd_store(out+CXZ*capacity+i,simd_mul(d,pxz));
+            simd_store(out+CYZ*capacity+i,simd_mul(d,pyz));
+         }
+
+         for(size_t k=0; k<NOUTPUT; k++) sums[k].add(pairwise_sum(out+k*capacity,n));
+         m_size = 0;
+      }
+
+   private:
+      std::vector<double,aligned_allocator<double,64>> m_in;
+      std::vector<double,aligned_allocator<double,64>> m_out;
+      size_t m_size;
+   };
+
+   // shared by polyhedron3d and flat_polyhedron3d, Mesh must provide face_size(), face(i) and vertex(i)
+   template <class Mesh>
+   static mass_properties mesh_mass_properties(const Mesh& poly)
+   {
+      mass_batch batch;
+      compensated_sum sums[NOUTPUT];
+      compensated_sum polygon_area;
+
+      for(size_t iface=0; iface<poly.face_size(); iface++) {
+         const auto& face = poly.face(iface);
+         size_t n = face.size();
+         if(n == 3) {
+            batch.add(poly.vertex(face[0]),poly.vertex(face[1]),poly.vertex(face[2]),1.0);
+            if(batch.full()) batch.flush(sums);
+         }
+         else if(n > 3) {
+            // the area of a planar polygon is exact from its normal, the triangles contribute volume and moments only.
+            // Quadrilaterals are split along the same diagonal as polyhedron3d::volume(), other polygons as a fan
+            polygon_area.add(polygon_normal(poly,face).length());
+            if(n == 4) {
+               batch.add(poly.vertex(face[0]),poly.vertex(face[1]),poly.vertex(face[3]),0.0);
+               if(batch.full()) batch.flush(sums);
+               batch.add(poly.vertex(face[3]),poly.vertex(face[1]),poly.vertex(face[2]),0.0);
+               if(batch.full()) batch.flush(sums);
+            }
+            else {
+               for(size_t i=1; i<n-1; i++) {
+                  batch.add(poly.vertex(face[0]),poly.vertex(face[i]),poly.vertex(face[i+1]),0.0);
+                  if(batch.full()) batch.flush(sums);
+               }
+            }
+         }
+      }
+      batch.flush(sums);
+
+      mass_properties props;
+      double d = sums[VOL].value();
+      props.volume = d/6.0;
+      props.area   = 0.5*(sums[AREA].value() + polygon_area.value());
+      if(d != 0.0) {
+         double cx = sums[MX].value()/(4.0*d);
+         double cy = sums[MY].value()/(4.0*d);
+         double cz = sums[MZ].value()/(4.0*d);
+         props.centroid = pos3d(cx,cy,cz);
+
+         // second moments about the origin, then moved to the centroid
+         double V   = props.volume;
+         double sxx = sums[CXX].value()/120.0 - V*cx*cx;
+         double syy = sums[CYY].value()/120.0 - V*cy*cy;
+         double szz = sums[CZZ].value()/120.0 - V*cz*cz;
+         double sxy = sums[CXY].value()/120.0 - V*cx*cy;
+         double sxz = sums[CXZ].value()/120.0 - V*cx*cz;
+         double syz = sums[CYZ].value()/120.0 - V*cy*cz;
+         props.Ixx = syy + szz;
+         props.Iyy = sxx + szz;
+         props.Izz = sxx + syy;
+         props.Ixy = -sxy;
+         props.Ixz = -sxz;
+         props.Iyz = -syz;
+      }
+      return props;
+   }
+
+   mass_properties compute_mass_properties(const polyhedron3d& poly)
+   {
+      return mesh_mass_properties(poly);
+   }
+
+   mass_properties compute_mass_properties(const flat_polyhedron3d& poly)
+   {
+      return mesh_mass_properties(poly);
+   }
+
+}
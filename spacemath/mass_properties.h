@@ -0,0 +1,49 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef MASS_PROPERTIES_H
+#define MASS_PROPERTIES_H
+
+#include "spacemath_config.h"
+#include "pos3d.h"
+
+namespace spacemath {
+
+   class polyhedron3d;
+   class flat_polyhedron3d;
+
+   // geometric properties of a closed polyhedron, assuming unit density
+   struct SPACEMATH_PUBLIC mass_properties {
+      mass_properties() : volume(0.0), area(0.0), Ixx(0.0), Iyy(0.0), Izz(0.0), Ixy(0.0), Ixz(0.0), Iyz(0.0) {}
+
+      double volume;      // enclosed volume, negative when the faces are oriented inwards
+      double area;        // total surface area
+      pos3d  centroid;    // centre of volume
+
+      // inertia tensor about the centroid, the products of inertia are defined as Ixy = -integral(x*y*dV)
+      double Ixx, Iyy, Izz;
+      double Ixy, Ixz, Iyz;
+   };
+
+   // compute all properties in one pass over the faces. Faces are processed in batches of triangles
+   // by a SIMD kernel (AVX or SSE2 when enabled at compile time, otherwise scalar), and the per-triangle
+   // contributions are summed pairwise within each batch and with compensated summation across batches,
+   // so the results stay accurate for very large meshes. N-sided faces are split into triangles.
+   SPACEMATH_PUBLIC mass_properties compute_mass_properties(const polyhedron3d& poly);
+   SPACEMATH_PUBLIC mass_properties compute_mass_properties(const flat_polyhedron3d& poly);
+
+}
+
+#endif // MASS_PROPERTIES_H
@@ -0,0 +1,110 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+// simple fork-join helpers based on std::thread, used by the mesh algorithms
+// that split their work into independent ranges. Exceptions thrown by a task are
+// rethrown in the calling thread after all threads have finished.
+
+#include <thread>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+namespace spacemath {
+
+   // return number of threads to use for the given request, 0 means all hardware threads
+   inline size_t parallel_threads(size_t nthreads)
+   {
+      if(nthreads == 0) nthreads = std::thread::hardware_concurrency();
+      return std::max(nthreads,size_t(1));
+   }
+
+   // call task(itask) for itask=[0,ntasks), using up to nthreads threads (0=all hardware threads).
+   // Each thread processes a contiguous block of task indices. With one thread, the tasks run in the calling thread.
+   template <class Task>
+   void parallel_tasks(size_t ntasks, size_t nthreads, Task task)
+   {
+      nthreads = std::min(parallel_threads(nthreads),ntasks);
+      if(nthreads <= 1) {
+         for(size_t itask=0; itask<ntasks; itask++) task(itask);
+         return;
+      }
+
+      std::vector<std::exception_ptr> errors(nthreads);
+      std::vector<std::thread> threads;
+      threads.reserve(nthreads);
+      for(size_t ithread=0; ithread<nthreads; ithread++) {
+         size_t first = ntasks*ithread/nthreads;
+         size_t last  = ntasks*(ithread+1)/nthreads;
+         threads.push_back(std::thread([&task,&errors,ithread,first,last]() {
+            try {
+               for(size_t itask=first; itask<last; itask++) task(itask);
+            }
+            catch(...) {
+               errors[ithread] = std::current_exception();
+            }
+         }));
+      }
+      for(auto& t : threads) t.join();
+      for(auto& e : errors) if(e) std::rethrow_exception(e);
+   }
+
+   // split the index range [0,n) into contiguous blocks of at least min_block indices
+   // and call body(first,last) for each block, using up to nthreads threads (0=all hardware threads)
+   template <class Body>
+   void parallel_for(size_t n, size_t nthreads, size_t min_block, Body body)
+   {
+      size_t nblock = std::min(parallel_threads(nthreads), std::max(n/std::max(min_block,size_t(1)),size_t(1)));
+      parallel_tasks(nblock,nblock,[n,nblock,&body](size_t iblock) {
+         size_t first = n*iblock/nblock;
+         size_t last  = n*(iblock+1)/nblock;
+         if(first < last) body(first,last);
+      });
+   }
+
+   // sort the range [first,last) using up to nthreads threads (0=all hardware threads).
+   // Blocks of at least min_block elements are sorted concurrently and then merged pairwise.
+   template <class RandomIt, class Compare>
+   void parallel_sort(RandomIt first, RandomIt last, Compare comp, size_t nthreads = 0, size_t min_block = 1<<16)
+   {
+      size_t n      = last - first;
+      size_t nblock = std::min(parallel_threads(nthreads), std::max(n/std::max(min_block,size_t(1)),size_t(1)));
+
+      // block boundaries
+      std::vector<size_t> bound(nblock+1);
+      for(size_t iblock=0; iblock<=nblock; iblock++) bound[iblock] = n*iblock/nblock;
+
+      parallel_tasks(nblock,nblock,[first,comp,&bound](size_t iblock) {
+         std::sort(first+bound[iblock],first+bound[iblock+1],comp);
+      });
+
+      // merge neighbouring sorted blocks until one block remains
+      for(size_t width=1; width<nblock; width*=2) {
+         size_t nmerge = (nblock + 2*width - 1)/(2*width);
+         parallel_tasks(nmerge,nmerge,[first,comp,width,nblock,&bound](size_t imerge) {
+            size_t lo  = 2*width*imerge;
+            size_t mid = std::min(lo+width,nblock);
+            size_t hi  = std::min(lo+2*width,nblock);
+            if(mid < hi) std::inplace_merge(first+bound[lo],first+bound[mid],first+bound[hi],comp);
+         });
+      }
+   }
+
+}
+
+#endif // PARALLEL_FOR_H
@@ -0,0 +1,65 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef POLYGON_NORMAL_H
+#define POLYGON_NORMAL_H
+
+#include "vec3d.h"
+#include "pos3d.h"
+
+namespace spacemath {
+
+   // return the normal vector of a polygon face, not normalised. The length equals twice the face area.
+   // Mesh must provide vertex(i) returning a pos3d, Face must provide size() and operator[] returning
+   // vertex indices, so the same code serves polyhedron3d/pface and flat_polyhedron3d/face_span
+   template <class Mesh, class Face>
+   vec3d polygon_normal(const Mesh& mesh, const Face& face)
+   {
+      // zero the normal vector
+      vec3d normal;
+      size_t n = face.size();
+
+      if(n == 3) {
+
+         // for triangles we simply compute a cross product
+         const pos3d& p0 = mesh.vertex(face[0]);
+         const pos3d& p1 = mesh.vertex(face[1]);
+         const pos3d& p2 = mesh.vertex(face[2]);
+         vec3d v1(p0,p1);
+         vec3d v2(p0,p2);
+         normal = v1.cross(v2);
+      }
+      else if(n > 3) {
+
+         // N-sided polygon face, see http://thebuildingcoder.typepad.com/blog/2008/12/3d-polygon-areas.html
+         pos3d b = mesh.vertex(face[n-2]);
+         pos3d c = mesh.vertex(face[n-1]);
+         for(size_t i=0; i<n; i++ ) {
+            pos3d a = b;
+            b       = c;
+            c       = mesh.vertex(face[i]);
+            double dx = b.y() * (c.z() - a.z());
+            double dy = b.z() * (c.x() - a.x());
+            double dz = b.x() * (c.y() - a.y());
+            normal += vec3d(dx,dy,dz);
+         }
+      }
+
+      return normal;
+   }
+
+}
+
+#endif // POLYGON_NORMAL_H
@@ -17,7 +17,10 @@
 #include <algorithm>    // std::reverse
 #include <string> // std::to_string
 #include <stdexcept>
-#include "vmath/vector_math.h"
+#include "HTmatrix.h"
+#include "parallel_for.h"
+#include "edge_table.h"
+#include "polygon_normal.h"
 
 namespace spacemath {
 
@@ -33,31 +36,146 @@ namespace spacemath {
    , m_face(faces)
    {}
 
+   polyhedron3d::polyhedron3d(vtx_vec&& vert, pface_vec&& faces)
+   : m_vert(std::move(vert))
+   , m_face(std::move(faces))
+   {}
+
+   // bounding box of a vertex vector, not initialised when empty
+   static bbox3d vertex_bbox(const vtx_vec& vert)
+   {
+      if(vert.empty()) return bbox3d();
+
+      double xmin = vert[0].x(), ymin = vert[0].y(), zmin = vert[0].z();
+      double xmax = xmin,        ymax = ymin,        zmax = zmin;
+      for(auto& v : vert) {
+         xmin = std::min(xmin,v.x()); xmax = std::max(xmax,v.x());
+         ymin = std::min(ymin,v.y()); ymax = std::max(ymax,v.y());
+         zmin = std::min(zmin,v.z()); zmax = std::max(zmax,v.z());
+      }
+      return bbox3d(pos3d(xmin,ymin,zmin),pos3d(xmax,ymax,zmax));
+   }
+
+   polyhedron3d::polyhedron3d(const polyhedron3d& other)
+   : m_vert(other.m_vert)
+   , m_face(other.m_face)
+   {
+      // the copy gets its own cache, computed when first used
+      enable_cache(other.cache_enabled());
+   }
+
+   polyhedron3d::polyhedron3d(polyhedron3d&& other) noexcept
+   : m_vert(std::move(other.m_vert))
+   , m_face(std::move(other.m_face))
+   , m_cache(std::move(other.m_cache))
+   {}
+
    polyhedron3d::~polyhedron3d()
    {}
 
+   polyhedron3d& polyhedron3d::operator=(const polyhedron3d& other)
+   {
+      if(this != &other) {
+         m_vert = other.m_vert;
+         m_face = other.m_face;
+         m_cache.reset();
+         enable_cache(other.cache_enabled());
+      }
+      return *this;
+   }
+
+   polyhedron3d& polyhedron3d::operator=(polyhedron3d&& other) noexcept
+   {
+      m_vert  = std::move(other.m_vert);
+      m_face  = std::move(other.m_face);
+      m_cache = std::move(other.m_cache);
+      return *this;
+   }
+
    void polyhedron3d::clear()
    {
       m_vert.clear();
       m_face.clear();
+      invalidate_cache();
    }
 
    void polyhedron3d::assign(const vtx_vec& vert, const pface_vec& faces)
    {
       m_vert = vert;
       m_face = faces;
+      invalidate_cache();
+   }
+
+   void polyhedron3d::assign(vtx_vec&& vert, pface_vec&& faces)
+   {
+      m_vert = std::move(vert);
+      m_face = std::move(faces);
+      invalidate_cache();
    }
 
    void polyhedron3d::assign(const pface_vec& faces)
    {
       m_face = faces;
+      invalidate_cache();
+   }
+
+   void polyhedron3d::enable_cache(bool enable)
+   {
+      if(!enable)          m_cache.reset();
+      else if(!m_cache)    m_cache.reset(new derived_cache);
+   }
+
+   const polyhedron3d::derived_cache* polyhedron3d::cache() const
+   {
+      derived_cache* cache = m_cache.get();
+      if(!cache) return nullptr;
+
+      if(!cache->valid.load(std::memory_order_acquire)) {
+         std::lock_guard<std::mutex> guard(cache->lock);
+         if(!cache->valid.load(std::memory_order_relaxed)) {
+
+            // all derived data in one pass over the faces, split across threads for large polyhedra
+            size_t nface = m_face.size();
+            cache->normal.resize(nface);
+            cache->area.resize(nface);
+            parallel_for(nface,0,size_t(1)<<16,[this,cache](size_t first, size_t last) {
+               for(size_t iface=first; iface<last; iface++) {
+                  vec3d normal = compute_face_normal(iface);
+                  cache->normal[iface] = normal;
+                  cache->area[iface]   = 0.5*normal.length();
+               }
+            });
+
+            cache->box = vertex_bbox(m_vert);
+
+            cache->valid.store(true,std::memory_order_release);
+         }
+      }
+      return cache;
+   }
+
+   std::shared_ptr<const edge_table> polyhedron3d::edges(size_t nthreads) const
+   {
+      derived_cache* cache = m_cache.get();
+      if(!cache) return std::make_shared<const edge_table>(*this,nthreads);
+
+      std::lock_guard<std::mutex> guard(cache->lock);
+      if(!cache->edges_valid.load(std::memory_order_relaxed)) {
+         cache->edges = std::make_shared<const edge_table>(*this,nthreads);
+         cache->edges_valid.store(true,std::memory_order_relaxed);
+      }
+      return cache->edges;
+   }
+
+   void polyhedron3d::edge_vertex_range_error(id_vertex iv0, id_vertex iv1)
+   {
+      throw std::logic_error("polyhedron3d::EDGE(), vertex number too large for edge identifier: " + std::to_string(std::max(iv0,iv1)));
    }
 
    id_coedge polyhedron3d::COEDGE(id_vertex iv0, id_vertex iv1)
    {
       id_edge   iedge        = EDGE(iv0,iv1);
-      id_coedge icoedge_test = iv0*vertex_shift + iv1;
-      id_coedge icoedge      = (icoedge_test == iedge)? iedge : -iedge;
+      id_coedge icoedge      = (iv0 <= iv1)? iedge : -iedge;
       return icoedge;
    }
 
@@ -65,25 +183,7 @@ namespace spacemath {
    edge_count_map polyhedron3d::construct_edge_use_count() const
    {
       // perform edge use count
-      edge_count_map edge_count;
-      size_t nface = this->face_size();
-      for(size_t iface=0; iface<nface; iface++) {
-
-         const pface& face = this->face(iface);
-
-         // count edges
-         // number of edges == number of vertices
-         size_t nedge     = face.size();
-         size_t last_edge = nedge-1;
-         for(size_t iedge=0; iedge<nedge; iedge++) {
-            id_vertex   iv0 = face[iedge];
-            id_vertex   iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-            id_edge edge_id = EDGE(iv0,iv1);
-            edge_count[edge_id]++;
-         }
-      }
-
-      return std::move(edge_count);
+      return edges()->use_count_map();
    }
 
    vec3d  polyhedron3d::face_normal(id_face iface) const
@@ -91,94 +191,52 @@ namespace spacemath {
       size_t nface = this->face_size();
       if(iface >= nface)throw std::logic_error("polyhedron3d::face_normal() face index out of range");
 
-      // zero the normal vector
-      vec3d normal;
+      if(const derived_cache* cache = this->cache()) return cache->normal[iface];
+      return compute_face_normal(iface);
+   }
 
-      const pface& face = m_face[iface];
-      size_t n = face.size();
+   double polyhedron3d::face_area(id_face iface) const
+   {
+      size_t nface = this->face_size();
+      if(iface >= nface)throw std::logic_error("polyhedron3d::face_area() face index out of range");
 
-      if(n == 3) {
+      if(const derived_cache* cache = this->cache()) return cache->area[iface];
+      return 0.5*compute_face_normal(iface).length();
+   }
 
-         // for triangles we simply compute a cross product
-         const pos3d& p0 = vertex(face[0]);
-         const pos3d& p1 = vertex(face[1]);
-         const pos3d& p2 = vertex(face[2]);
-         vec3d v1(p0,p1);
-         vec3d v2(p0,p2);
-         normal = v1.cross(v2);
-      }
-      else if(n > 3) {
-
-         // N-sided polygon face, see http://thebuildingcoder.typepad.com/blog/2008/12/3d-polygon-areas.html
-         pos3d b = vertex(face[n-2]);
-         pos3d c = vertex(face[n-1]);
-         for(size_t i=0; i<n; i++ ) {
-            pos3d a = b;
-            b       = c;
-            c       = vertex(face[i]);
-            double dx = b.y() * (c.z() - a.z());
-            double dy = b.z() * (c.x() - a.x());
-            double dz = b.x() * (c.y() - a.y());
-            normal += vec3d(dx,dy,dz);
-         }
-      }
+   bbox3d polyhedron3d::bbox() const
+   {
+      if(const derived_cache* cache = this->cache()) return cache->box;
+      return vertex_bbox(m_vert);
+   }
 
-      return normal;
+   vec3d  polyhedron3d::compute_face_normal(id_face iface) const
+   {
+      return polygon_normal(*this,m_face[iface]);
    }
 
    double  polyhedron3d::volume() const
    {
       // http://stackoverflow.com/questions/1838401/general-formula-to-calculate-polyhedron-volume
+      // The signed volume of each tetrahedron (face triangle + origin) is summed by the batched kernel,
+      // quadrilaterals are split into the triangles (p1,p2,p4) and (p4,p2,p3) assuming they are convex
 
       size_t nface = this->face_size();
       if(nface==0)throw std::logic_error("polyhedron3d::volume() not implemented for polyhedron with no faces");
 
-      using namespace vmath;
-      double vol = 0.0;
-      vec4<double> v0(0.0,0.0,0.0,1.0);
-
       for(size_t iface=0; iface<nface; iface++) {
-         const pface& face = this->face(iface);
-         if(face.size() == 3) {
-
-            // 4x4 matrix of tetrahedron from triangle + origin(v4)
-            const pos3d& p1 = vertex(face[0]);
-            const pos3d& p2 = vertex(face[1]);
-            const pos3d& p3 = vertex(face[2]);
-            vec4<double> v1(p1.x(),p1.y(),p1.z(),1.0);
-            vec4<double> v2(p2.x(),p2.y(),p2.z(),1.0);
-            vec4<double> v3(p3.x(),p3.y(),p3.z(),1.0);
-            mat4<double> mat(v1,v2,v3,v0);
-
-            // determinant of matrix
-            vol += det(mat);
-         }
-         else if(face.size() == 4) {
-
-            // Note: convex quadrilateral assumed here
-            const pos3d& p1 = vertex(face[0]);
-            const pos3d& p2 = vertex(face[1]);
-            const pos3d& p3 = vertex(face[2]);
-            const pos3d& p4 = vertex(face[3]);
-            vec4<double> v1(p1.x(),p1.y(),p1.z(),1.0);
-            vec4<double> v2(p2.x(),p2.y(),p2.z(),1.0);
-            vec4<double> v3(p3.x(),p3.y(),p3.z(),1.0);
-            vec4<double> v4(p4.x(),p4.y(),p4.z(),1.0);
-
-            // determinant of 2 matrices
-            mat4<double> mat1(v1,v2,v4,v0);
-            mat4<double> mat2(v4,v2,v3,v0);
-            vol += det(mat1);
-            vol += det(mat2);
-
-         }
-         else {
+         size_t nvert = m_face[iface].size();
+         if(nvert != 3 && nvert != 4) {
             throw std::logic_error("polyhedron3d::volume() requires triangular or quadrilateral faces only.");
          }
       }
 
-      // The signed volume of each tetrahedron is equal to 1/6 the determinant
-      return vol/6.0;
+      return compute_mass_properties(*this).volume;
+   }
+
+   mass_properties polyhedron3d::properties() const
+   {
+      return compute_mass_properties(*this);
    }
 
    void polyhedron3d::flip_face(id_face iface)
@@ -188,6 +246,13 @@ namespace spacemath {
 
       pface& face = m_face[iface];
       std::reverse(face.begin(),face.end());
+
+      // the face normal changes sign, areas and bounding box are unchanged.
+      // The edge table maps face coedges in face order, so it must be rebuilt
+      if(m_cache) {
+         if(m_cache->valid.load(std::memory_order_acquire)) m_cache->normal[iface] = -m_cache->normal[iface];
+         m_cache->edges_valid.store(false,std::memory_order_relaxed);
+      }
    }
 
 
@@ -221,21 +286,100 @@ namespace spacemath {
       }
    }
 
-   void polyhedron3d::transform_inplace(const HTmatrix& T)
+   // transform the vertices [first,last) of vert, same arithmetic as T*pos3d.
+   // The coordinates are contiguous and the matrix elements are kept in locals, so the loop compiles to
+   // straight streaming code. It is limited by memory bandwidth, which is why the large cases use threads.
+   static void transform_vertices(const HTmatrix& T, const pos3d* in, pos3d* out, size_t first, size_t last)
    {
-      for(auto& v : m_vert) {
-         v = T*v;
+      const double (&e)[4][4] = T.detail().elem;
+      const double e00=e[0][0], e01=e[0][1], e02=e[0][2], e03=e[0][3];
+      const double e10=e[1][0], e11=e[1][1], e12=e[1][2], e13=e[1][3];
+      const double e20=e[2][0], e21=e[2][1], e22=e[2][2], e23=e[2][3];
+      for(size_t i=first; i<last; i++) {
+         const double x = in[i].x();
+         const double y = in[i].y();
+         const double z = in[i].z();
+         out[i] = pos3d(e00*x + e01*y + e02*z + e03,
+                        e10*x + e11*y + e12*z + e13,
+                        e20*x + e21*y + e22*z + e23);
       }
    }
 
-   std::shared_ptr<polyhedron3d> polyhedron3d::transform_copy(const HTmatrix& T) const
+   // vertex count per parallel block, smaller polyhedra are transformed by the calling thread
+   static const size_t transform_block = size_t(1)<<16;
+
+   void polyhedron3d::transform_inplace(const HTmatrix& T, size_t nthreads)
+   {
+      invalidate_geometry();
+      pos3d* vert = m_vert.data();
+      parallel_for(m_vert.size(),nthreads,transform_block,[&T,vert](size_t first, size_t last) {
+         transform_vertices(T,vert,vert,first,last);
+      });
+   }
+
+   std::shared_ptr<polyhedron3d> polyhedron3d::transform_copy(const HTmatrix& T, size_t nthreads) const
+   {
+      vtx_vec vert(m_vert.size());
+      const pos3d* in  = m_vert.data();
+      pos3d*       out = vert.data();
+      parallel_for(m_vert.size(),nthreads,transform_block,[&T,in,out](size_t first, size_t last) {
+         transform_vertices(T,in,out,first,last);
+      });
+      return std::make_shared<polyhedron3d>(std::move(vert),pface_vec(m_face));
+   }
+
+   void polyhedron3d::transform_inplace(const ph3d_vector& polyset, const std::vector<HTmatrix>& T, size_t nthreads)
    {
-      vtx_vec vert;
-      vert.reserve(m_vert.size());
-      for(auto& v : m_vert) {
-         vert.push_back(T*v);
+      if(T.size() != polyset.size()) throw std::logic_error("polyhedron3d::transform_inplace(), polyset and matrix counts differ");
+
+      // the same polyhedron may appear more than once. It is transformed once by the product of its matrices,
+      // the same result as transforming in sequence, and no two threads ever write to the same vertices
+      std::vector<polyhedron3d*> parts;
+      std::vector<HTmatrix>      part_T;
+      std::unordered_map<polyhedron3d*,size_t> part_index;
+      for(size_t ipoly=0; ipoly<polyset.size(); ipoly++) {
+         polyhedron3d* poly = polyset[ipoly].get();
+         auto it = part_index.find(poly);
+         if(it == part_index.end()) {
+            part_index[poly] = parts.size();
+            parts.push_back(poly);
+            part_T.push_back(T[ipoly]);
+         }
+         else {
+            part_T[it->second] = T[ipoly]*part_T[it->second];
+         }
+      }
+
+      // split all parts into blocks of vertices, so that large and small parts are balanced across the threads
+      struct block { size_t ipart, first, last; };
+      std::vector<block> blocks;
+      for(size_t ipart=0; ipart<parts.size(); ipart++) {
+         parts[ipart]->invalidate_geometry();
+         size_t nvert = parts[ipart]->vertex_size();
+         for(size_t first=0; first<nvert; first+=transform_block) {
+            block b = { ipart, first, std::min(first+transform_block,nvert) };
+            blocks.push_back(b);
+         }
       }
-      return std::make_shared<polyhedron3d>(vert,m_face);
+
+      parallel_tasks(blocks.size(),nthreads,[&](size_t iblock) {
+         const block& b = blocks[iblock];
+         pos3d* vert = parts[b.ipart]->m_vert.data();
+         transform_vertices(part_T[b.ipart],vert,vert,b.first,b.last);
+      });
+   }
+
+   std::shared_ptr<ph3d_vector> polyhedron3d::transform_copy(const ph3d_vector& polyset, const std::vector<HTmatrix>& T, size_t nthreads)
+   {
+      if(T.size() != polyset.size()) throw std::logic_error("polyhedron3d::transform_copy(), polyset and matrix counts differ");
+
+      // the copies are made in parallel as well, copying the faces is usually the dominant cost
+      std::shared_ptr<ph3d_vector> copies = std::make_shared<ph3d_vector>(polyset.size());
+      parallel_tasks(polyset.size(),nthreads,[&](size_t ipoly) {
+         (*copies)[ipoly] = std::make_shared<polyhedron3d>(*polyset[ipoly]);
+      });
+      transform_inplace(*copies,T,nthreads);
+      return copies;
    }
 
 }
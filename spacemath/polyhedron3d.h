@@ -25,8 +25,12 @@
 #include <algorithm>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include "vec3d.h"
 #include "pos3d.h"
+#include "mass_properties.h"
+#include "bbox3d.h"
 
 // some typedefs declared outside the spacemath namespace for simplicity
 
@@ -45,6 +49,7 @@ typedef std::unordered_map<id_edge, size_t>  edge_count_map;  // use count for e
 
 namespace spacemath {
    class polyhedron3d;
+   class edge_table;
 }
 
 typedef std::vector<std::shared_ptr<spacemath::polyhedron3d>> ph3d_vector;  // vector of pointers to polyhedron3d
@@ -58,11 +63,20 @@ namespace spacemath {
       polyhedron3d();
       polyhedron3d(const vtx_vec& vert);
       polyhedron3d(const vtx_vec& vert, const pface_vec& faces);
+      polyhedron3d(vtx_vec&& vert, pface_vec&& faces);
+      polyhedron3d(const polyhedron3d& other);
+      polyhedron3d(polyhedron3d&& other) noexcept;
       virtual ~polyhedron3d();
 
+      polyhedron3d& operator=(const polyhedron3d& other);
+      polyhedron3d& operator=(polyhedron3d&& other) noexcept;
+
       // assign new data to polyhedron
       void assign(const vtx_vec& vert, const pface_vec& faces);
 
+      // assign new data to polyhedron, taking ownership of the given containers
+      void assign(vtx_vec&& vert, pface_vec&& faces);
+
       // assign faces only, keep vertices
       void assign(const pface_vec& faces);
 
@@ -73,20 +87,48 @@ namespace spacemath {
       inline size_t vertex_size() const          { return m_vert.size(); }
       inline const pos3d& vertex(size_t i) const { return m_vert[i]; }
 
-      // non-const vertex overload allows modifying coordinate of existing vertex
-      inline pos3d& vertex(size_t i)             { return m_vert[i]; }
+      // non-const vertex overload allows modifying coordinate of existing vertex.
+      // It invalidates the derived data cache, also when only used for reading, so prefer
+      // the const overload for reading and set_vertex for writing when the cache is enabled
+      inline pos3d& vertex(size_t i)             { invalidate_geometry(); return m_vert[i]; }
+
+      // modify coordinate of existing vertex, this invalidates the derived data cache
+      inline void set_vertex(size_t i, const pos3d& pos) { invalidate_geometry(); m_vert[i] = pos; }
 
       // face traversal
       inline size_t face_size() const            { return m_face.size(); }
       inline const pface& face(size_t i) const   { return m_face[i]; }
 
+      // replace existing face, this invalidates the derived data cache
+      inline void set_face(size_t i, const pface& face)  { invalidate_cache(); m_face[i] = face; }
+
       // return face normal vector, observe the returned vector is not normalised.
       // The face area can be assessed by evaluating 0.5*normal.length()
       vec3d  face_normal(id_face iface) const;
 
+      // return face area
+      double face_area(id_face iface) const;
+
+      // return bounding box of all vertices
+      bbox3d bbox() const;
+
+      // Opt-in cache of derived data: when enabled, face normals, face areas and the bounding box
+      // are computed together in one pass on first use, and kept until the polyhedron is modified
+      // (assign, clear, non-const vertex, set_vertex, set_face, flip_face or transform_inplace).
+      // The edge table returned by edges() is kept in the same cache, and survives modifications of vertex coordinates only.
+      void enable_cache(bool enable = true);
+      inline bool cache_enabled() const          { return m_cache != nullptr; }
+
+      // return edge table of the polyhedron, built using up to nthreads threads (0=all hardware threads).
+      // With the cache enabled, the same table is returned until the polyhedron is modified
+      std::shared_ptr<const edge_table> edges(size_t nthreads = 1) const;
+
       // compute volume of polyhedron, throws exception for other than triangular+quadrilateral faces
       double volume() const;
 
+      // compute volume, surface area, centroid and inertia tensor in one batched pass, see compute_mass_properties
+      mass_properties properties() const;
+
       // flip face index order
       void flip_face(id_face iface);
 
@@ -96,21 +138,33 @@ namespace spacemath {
       // verify polyhedron for common mistakes, throw exception on error
       void verify_polyhedron() const;
 
-      // transform polyhedron in-place
-      void transform_inplace(const HTmatrix& T);
+      // transform polyhedron in-place. Large polyhedra are transformed using up to nthreads threads (0=all hardware threads).
+      // The default is to run in the calling thread only, parallel work must be requested by the caller
+      void transform_inplace(const HTmatrix& T, size_t nthreads = 1);
 
       // create a transformed copy of this polyhedron
-      std::shared_ptr<polyhedron3d> transform_copy(const HTmatrix& T) const;
+      std::shared_ptr<polyhedron3d> transform_copy(const HTmatrix& T, size_t nthreads = 1) const;
+
+      // transform each polyhedron in polyset in-place by its own matrix, T[i] applies to polyset[i].
+      // All parts are processed together in parallel, using up to nthreads threads (0=all hardware threads).
+      // A polyhedron appearing more than once is transformed by each of its matrices in order
+      static void transform_inplace(const ph3d_vector& polyset, const std::vector<HTmatrix>& T, size_t nthreads = 1);
+
+      // create transformed copies of each polyhedron in polyset, T[i] applies to polyset[i]
+      static std::shared_ptr<ph3d_vector> transform_copy(const ph3d_vector& polyset, const std::vector<HTmatrix>& T, size_t nthreads = 1);
 
    public:
       // compute edge use count
       edge_count_map construct_edge_use_count() const;
 
-      static const size_t vertex_shift = 100000000000; // constant used for encoding 2 id_vertex into one id_edge or id_coedge
+      static const size_t vertex_bits = 32;             // number of bits used for the highest vertex number in an id_edge or id_coedge
+      static const size_t max_edge_vertex = 0x7fffffff; // highest vertex number that can be encoded in an id_edge or id_coedge
 
       // compute edge identifier, vertex order not significant, result always positive.
-      // Lowest vertex number always encoded first ("shifted left")
-      static inline id_edge      EDGE(id_vertex iv0, id_vertex iv1)        { return std::min(iv0,iv1)*vertex_shift + std::max(iv0,iv1); }
+      // Lowest vertex number always encoded first ("shifted left"), so edges sort by lowest, then highest vertex.
+      // Throws logic_error if a vertex number is above max_edge_vertex, as the encoding would not be unique
+      static inline id_edge      EDGE(id_vertex iv0, id_vertex iv1)        { if((iv0|iv1) > max_edge_vertex) edge_vertex_range_error(iv0,iv1);
+                                                                              return id_edge((std::min(iv0,iv1) << vertex_bits) | std::max(iv0,iv1)); }
 
       // compute coedge identifier for coedge from iv0->iv1, absolute value is the same as for EDGE,
       // but COEDGE may be negative to indicate opposite direction relative to EDGE
@@ -119,9 +173,43 @@ namespace spacemath {
       // compute vertex pair according to EDGE rules
       static inline vertex_pair  VERTEX_PAIR(id_vertex iv0, id_vertex iv1) { return std::make_pair(std::min(iv0,iv1), std::max(iv0,iv1)); }
 
+      // recover the vertex pair encoded in an edge or coedge identifier, according to VERTEX_PAIR rules
+      static inline vertex_pair  EDGE_VERTICES(id_coedge icoedge)          { id_edge iedge = (icoedge<0)? -icoedge : icoedge;
+                                                                              return std::make_pair(id_vertex(iedge) >> vertex_bits, id_vertex(iedge) & 0xffffffff); }
+
+   private:
+      // derived data, valid until the polyhedron is modified
+      struct derived_cache {
+         derived_cache() : valid(false), edges_valid(false) {}
+         std::mutex          lock;     // serialises the lazy computation
+         std::atomic<bool>   valid;
+         std::vector<vec3d>  normal;   // face normals, not normalised
+         std::vector<double> area;     // face areas
+         bbox3d              box;      // vertex bounding box
+         std::atomic<bool>   edges_valid;
+         std::shared_ptr<const edge_table> edges;  // computed separately on first use of edges()
+      };
+
+      // compute face normal without using the cache
+      vec3d compute_face_normal(id_face iface) const;
+
+      // throw logic_error for a vertex number that cannot be encoded by EDGE
+      static void edge_vertex_range_error(id_vertex iv0, id_vertex iv1);
+
+      // return the cache, computing it first if required. Returns null when caching is disabled
+      const derived_cache* cache() const;
+
+      // discard cached normals, areas and bounding box after vertices are moved, the edge table only depends on the faces
+      inline void invalidate_geometry()          { if(m_cache) m_cache->valid.store(false,std::memory_order_relaxed); }
+
+      // discard cached data after modification
+      inline void invalidate_cache()             { if(m_cache) { m_cache->valid.store(false,std::memory_order_relaxed);
+                                                                     m_cache->edges_valid.store(false,std::memory_order_relaxed); } }
+
    private:
       vtx_vec    m_vert;    // polyhedron vertex vector
       pface_vec  m_face;    // polyhedron face vector, faces refer to m_vert
+      std::unique_ptr<derived_cache> m_cache;  // null unless caching is enabled
    };
 
 }
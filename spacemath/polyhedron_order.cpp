@@ -0,0 +1,133 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "polyhedron_order.h"
+#include "parallel_for.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace spacemath {
+
+   // spread the lowest 21 bits of x so there are 2 zero bits between each of them
+   static inline uint64_t morton_spread(uint64_t x)
+   {
+      x &= 0x1fffff;
+      x = (x | (x << 32)) & 0x1f00000000ffffULL;
+      x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+      x = (x | (x <<  8)) & 0x100f00f00f00f00fULL;
+      x = (x | (x <<  4)) & 0x10c30c30c30c30c3ULL;
+      x = (x | (x <<  2)) & 0x1249249249249249ULL;
+      return x;
+   }
+
+   // quantize a coordinate to 21 bits, relative to the bounding box
+   static inline uint64_t morton_cell(double value, double vmin, double scale)
+   {
+      double f = std::floor((value-vmin)*scale);
+      if(!(f >= 0.0)) f = 0.0;
+      if(f > 0x1fffff) f = 0x1fffff;
+      return uint64_t(f);
+   }
+
+   struct morton_entry {
+      uint64_t  key;
+      id_vertex iv;
+   };
+
+   inline bool operator<(const morton_entry& a, const morton_entry& b)
+   {
+      return (a.key < b.key) || ((a.key == b.key) && (a.iv < b.iv));
+   }
+
+   polyhedron_order compute_polyhedron_order(const polyhedron3d& poly, size_t nthreads)
+   {
+      polyhedron_order order;
+
+      // vertex order along the Morton curve
+      size_t nv = poly.vertex_size();
+      if(nv > 0) {
+         bbox3d box = poly.bbox();
+         const pos3d& p0 = box.p1();
+         double extent = std::max(box.dx(),std::max(box.dy(),box.dz()));
+         double scale  = (extent > 0.0)? double(0x1fffff)/extent : 0.0;
+
+         std::vector<morton_entry> entries(nv);
+         parallel_for(nv,nthreads,1<<16,[&poly,&entries,&p0,scale](size_t first, size_t last) {
+            for(size_t iv=first; iv<last; iv++) {
+               const pos3d& p = poly.vertex(iv);
+               entries[iv].key = (morton_spread(morton_cell(p.x(),p0.x(),scale)) << 2)
+                               | (morton_spread(morton_cell(p.y(),p0.y(),scale)) << 1)
+                               |  morton_spread(morton_cell(p.z(),p0.z(),scale));
+               entries[iv].iv  = iv;
+            }
+         });
+         parallel_sort(entries.begin(),entries.end(),std::less<morton_entry>(),nthreads);
+
+         order.vertex_order.resize(nv);
+         order.vertex_remap.resize(nv);
+         parallel_for(nv,nthreads,1<<16,[&order,&entries](size_t first, size_t last) {
+            for(size_t iv_new=first; iv_new<last; iv_new++) {
+               id_vertex iv_old = entries[iv_new].iv;
+               order.vertex_order[iv_new] = iv_old;
+               order.vertex_remap[iv_old] = iv_new;
+            }
+         });
+      }
+
+      // face order by lowest new vertex, ties resolved by original face index
+      size_t nface = poly.face_size();
+      std::vector<std::pair<id_vertex,id_face>> face_keys(nface);
+      parallel_for(nface,nthreads,1<<16,[&poly,&order,&face_keys](size_t first, size_t last) {
+         for(size_t iface=first; iface<last; iface++) {
+            const pface& face = poly.face(iface);
+            id_vertex vmin = ~id_vertex(0);
+            for(id_vertex iv : face) vmin = std::min(vmin,order.vertex_remap[iv]);
+            face_keys[iface] = std::make_pair(vmin,iface);
+         }
+      });
+      parallel_sort(face_keys.begin(),face_keys.end(),std::less<std::pair<id_vertex,id_face>>(),nthreads);
+
+      order.face_order.resize(nface);
+      for(size_t iface=0; iface<nface; iface++) order.face_order[iface] = face_keys[iface].second;
+
+      return order;
+   }
+
+   polyhedron_order reorder_polyhedron(polyhedron3d& poly, size_t nthreads)
+   {
+      polyhedron_order order = compute_polyhedron_order(poly,nthreads);
+
+      size_t nv = poly.vertex_size();
+      vtx_vec vert(nv);
+      parallel_for(nv,nthreads,1<<16,[&poly,&order,&vert](size_t first, size_t last) {
+         for(size_t iv=first; iv<last; iv++) vert[iv] = poly.vertex(order.vertex_order[iv]);
+      });
+
+      size_t nface = poly.face_size();
+      pface_vec faces(nface);
+      parallel_for(nface,nthreads,1<<12,[&poly,&order,&faces](size_t first, size_t last) {
+         for(size_t iface=first; iface<last; iface++) {
+            pface& face = faces[iface];
+            face = poly.face(order.face_order[iface]);
+            for(id_vertex& iv : face) iv = order.vertex_remap[iv];
+         }
+      });
+
+      poly.assign(std::move(vert),std::move(faces));
+      return order;
+   }
+
+}
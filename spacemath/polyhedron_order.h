@@ -0,0 +1,44 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef POLYHEDRON_ORDER_H
+#define POLYHEDRON_ORDER_H
+
+#include "spacemath_config.h"
+#include "polyhedron3d.h"
+#include <vector>
+
+namespace spacemath {
+
+   // vertex and face permutations of a polyhedron, see compute_polyhedron_order
+   struct SPACEMATH_PUBLIC polyhedron_order {
+      std::vector<id_vertex> vertex_order;  // vertex_order[iv_new] = iv_old
+      std::vector<id_vertex> vertex_remap;  // vertex_remap[iv_old] = iv_new, the inverse of vertex_order
+      std::vector<id_face>   face_order;    // face_order[iface_new] = iface_old
+   };
+
+   // compute a cache friendly order of the polyhedron: vertices are sorted along a Morton (Z-order) curve
+   // through the bounding box, so vertices close in space get nearby indices, and faces are sorted by their
+   // lowest new vertex index, keeping the original order among faces sharing it.
+   // Uses up to nthreads threads (0=all hardware threads)
+   SPACEMATH_PUBLIC polyhedron_order compute_polyhedron_order(const polyhedron3d& poly, size_t nthreads = 0);
+
+   // reorder the polyhedron in-place according to compute_polyhedron_order, and return the permutations applied.
+   // The geometry and face orientations are unchanged
+   SPACEMATH_PUBLIC polyhedron_order reorder_polyhedron(polyhedron3d& poly, size_t nthreads = 0);
+
+}
+
+#endif // POLYHEDRON_ORDER_H
@@ -18,43 +18,31 @@
 
 #include "spacemath_config.h"
 #include "vec2d.h"
+#include <cmath>
 
 namespace spacemath {
 
-   // position in 2d space
+   // position in 2d space.
+   // pos2d is a trivially copyable value type, all arithmetic is inline so it can be optimised in inner loops
    class SPACEMATH_PUBLIC pos2d {
    public:
-      pos2d();
-      pos2d(double x,double y);
-      pos2d(const pos2d& pos);
-     ~pos2d();
+      constexpr pos2d() noexcept : m_x(0.0),m_y(0.0) {}
+      constexpr pos2d(double x,double y) noexcept : m_x(x),m_y(y) {}
 
-      double x() const;
-      double y() const;
+      constexpr double x() const noexcept { return m_x; }
+      constexpr double y() const noexcept { return m_y; }
 
-      void x( double x );
-      void y( double y );
+      inline void x( double x ) noexcept  { m_x = x; }
+      inline void y( double y ) noexcept  { m_y = y; }
 
-      pos2d& operator =(const pos2d& pos);
-      pos2d& operator+=(const vec2d& vec);
-      pos2d& operator-=(const vec2d& vec);
+      inline pos2d& operator+=(const vec2d& vec) noexcept { m_x+=vec.x(); m_y+=vec.y(); return *this; }
+      inline pos2d& operator-=(const vec2d& vec) noexcept { m_x-=vec.x(); m_y-=vec.y(); return *this; }
 
-      pos2d& operator+=(const pos2d& pos);
-      pos2d& operator-=(const pos2d& pos);
+      inline pos2d& operator+=(const pos2d& pos) noexcept { m_x+=pos.m_x; m_y+=pos.m_y; return *this; }
+      inline pos2d& operator-=(const pos2d& pos) noexcept { m_x-=pos.m_x; m_y-=pos.m_y; return *this; }
 
-      double dist(const pos2d& pos) const;
-      double dist_squared(const pos2d& pos) const;
-
-      friend pos2d operator+(const pos2d& pos, const vec2d& vec);
-      friend pos2d operator+(const vec2d& vec, const pos2d& pos);
-
-      friend pos2d operator-(const pos2d& pos, const vec2d& vec);
-      friend pos2d operator-(const vec2d& vec, const pos2d& pos);
-
-      friend pos2d operator*(const pos2d& pos, double value);
-      friend pos2d operator*(double value, const pos2d& pos);
-
-      friend vec2d operator-(const pos2d& pos1, const pos2d& pos2);
+      constexpr double dist_squared(const pos2d& pos) const noexcept { return (pos.m_x-m_x)*(pos.m_x-m_x) + (pos.m_y-m_y)*(pos.m_y-m_y); }
+      inline    double dist(const pos2d& pos) const noexcept         { return std::sqrt(dist_squared(pos)); }
 
    private:
       double m_x;
@@ -63,15 +51,20 @@ namespace spacemath {
 
 
    //Operators
-   inline pos2d operator+(const pos2d& pos, const vec2d& vec)   { return pos2d(pos.m_x + vec.x(), pos.m_y + vec.y());   }
-   inline pos2d operator+(const vec2d& vec, const pos2d& pos)   { return pos2d(pos.m_x + vec.x(), pos.m_y + vec.y());   }
-   inline pos2d operator-(const pos2d& pos, const vec2d& vec)   { return pos2d(pos.m_x - vec.x(), pos.m_y - vec.y());   }
-   inline pos2d operator-(const vec2d& vec, const pos2d& pos)   { return pos2d(-pos.m_x + vec.x(), -pos.m_y + vec.y()); }
-   inline pos2d operator*(const pos2d& pos, double value)       { return pos2d(pos.x()*value,pos.y()*value); }
-   inline pos2d operator*(double value, const pos2d& pos)       { return pos2d(value*pos.x(),value*pos.y()); }
-   inline vec2d operator-(const pos2d& pos1, const pos2d& pos2) { return vec2d(pos2,pos1); }
-
-   inline pos2d operator+(const pos2d& pos1, const pos2d& pos2) {return pos2d(pos1)+=pos2;}
+   constexpr pos2d operator+(const pos2d& pos, const vec2d& vec) noexcept   { return pos2d(pos.x() + vec.x(), pos.y() + vec.y());   }
+   constexpr pos2d operator+(const vec2d& vec, const pos2d& pos) noexcept   { return pos2d(pos.x() + vec.x(), pos.y() + vec.y());   }
+   constexpr pos2d operator-(const pos2d& pos, const vec2d& vec) noexcept   { return pos2d(pos.x() - vec.x(), pos.y() - vec.y());   }
+   constexpr pos2d operator-(const vec2d& vec, const pos2d& pos) noexcept   { return pos2d(-pos.x() + vec.x(), -pos.y() + vec.y()); }
+   constexpr pos2d operator*(const pos2d& pos, double value) noexcept       { return pos2d(pos.x()*value,pos.y()*value); }
+   constexpr pos2d operator*(double value, const pos2d& pos) noexcept       { return pos2d(value*pos.x(),value*pos.y()); }
+   constexpr vec2d operator-(const pos2d& pos1, const pos2d& pos2) noexcept { return vec2d(pos2,pos1); }
+
+   constexpr pos2d operator+(const pos2d& pos1, const pos2d& pos2) noexcept { return pos2d(pos1.x()+pos2.x(),pos1.y()+pos2.y()); }
+
+   // vec2d construction from two positions requires pos2d to be complete
+   constexpr vec2d::vec2d(const pos2d& start,const pos2d& end) noexcept
+   : m_x(end.x()-start.x()),m_y(end.y()-start.y())
+   {}
 
 }
 
@@ -17,56 +17,46 @@
 #define POS3D_H
 
 #include "spacemath_config.h"
+#include <cmath>
 
 namespace spacemath {
 
    class vec3d;
    class HTmatrix;
 
-   // position in 3d space
+   // position in 3d space.
+   // pos3d is a trivially copyable value type, all arithmetic is inline so it can be optimised in inner loops
    class SPACEMATH_PUBLIC pos3d {
    public:
-      pos3d();
-      pos3d(double x,double y,double z);
-      pos3d(const pos3d& pos);
-      ~pos3d();
+      constexpr pos3d() noexcept : m_x(0.0),m_y(0.0),m_z(0.0) {}
+      constexpr pos3d(double x,double y,double z) noexcept : m_x(x),m_y(y),m_z(z) {}
 
-      const double& x() const;
-      const double& y() const;
-      const double& z() const;
+      constexpr const double& x() const noexcept { return m_x; }
+      constexpr const double& y() const noexcept { return m_y; }
+      constexpr const double& z() const noexcept { return m_z; }
 
-      void x( double x );
-      void y( double y );
-      void z( double z );
+      inline void x( double x ) noexcept { m_x=x; }
+      inline void y( double y ) noexcept { m_y=y; }
+      inline void z( double z ) noexcept { m_z=z; }
 
-      pos3d& move(const vec3d& vec);
+      inline pos3d& move(const vec3d& vec) noexcept;
 
    //Operators
-      pos3d& operator =(const pos3d& pos);
-      pos3d& operator+=(const vec3d& vec);
-      pos3d& operator-=(const vec3d& vec);
-      pos3d& operator*=(double value);
-      pos3d& operator/=(double value);
-      pos3d& operator+=(const pos3d& pos);
-      pos3d& operator-=(const pos3d& pos);
-      pos3d  operator-() const;
+      inline pos3d& operator+=(const vec3d& vec) noexcept;
+      inline pos3d& operator-=(const vec3d& vec) noexcept;
+      inline pos3d& operator*=(double value) noexcept       { m_x*=value; m_y*=value; m_z*=value; return *this; }
+      inline pos3d& operator/=(double value) noexcept       { m_x/=value; m_y/=value; m_z/=value; return *this; }
+      inline pos3d& operator+=(const pos3d& pos) noexcept   { m_x+=pos.m_x; m_y+=pos.m_y; m_z+=pos.m_z; return *this; }
+      inline pos3d& operator-=(const pos3d& pos) noexcept   { m_x-=pos.m_x; m_y-=pos.m_y; m_z-=pos.m_z; return *this; }
+      constexpr pos3d operator-() const noexcept            { return pos3d(-m_x,-m_y,-m_z); }
 
       bool   operator <(const pos3d& pos) const;
-      double dist(const pos3d& pos) const;
-      double dist_squared(const pos3d& pos) const;
 
-      friend pos3d operator+(const pos3d& pos1, const pos3d& pos2);
-      friend pos3d operator-(const pos3d& pos1, const pos3d& pos2);
-
-      friend pos3d operator*(const pos3d& pos, double value);
-      friend pos3d operator/(const pos3d& pos, double value);
-      friend pos3d operator*(double value, const pos3d& pos);
-
-      friend pos3d operator+(const pos3d& pos, const vec3d& vec);
-      friend pos3d operator+(const vec3d& vec, const pos3d& pos);
-
-      friend pos3d operator-(const pos3d& pos, const vec3d& vec);
-      friend pos3d operator-(const vec3d& vec, const pos3d& pos);
+      constexpr double dist_squared(const pos3d& pos) const noexcept
+      {
+         return (pos.m_x-m_x)*(pos.m_x-m_x) + (pos.m_y-m_y)*(pos.m_y-m_y) + (pos.m_z-m_z)*(pos.m_z-m_z);
+      }
+      inline double dist(const pos3d& pos) const noexcept   { return std::sqrt(dist_squared(pos)); }
 
       SPACEMATH_PUBLIC friend pos3d operator*(const HTmatrix& T, const pos3d& pos);
 
@@ -76,59 +66,29 @@ namespace spacemath {
       double m_z;
    };
 
+   // Operators
 
-   //
-   //inline definition of functions
-   //
-
-   //Constructions
-
-   inline pos3d::pos3d(double x,double y,double z)
-   : m_x(x),m_y(y),m_z(z)
-   {}
-
-   inline pos3d::pos3d()
-   : m_x(0.0),m_y(0.0),m_z(0.0)
-   {}
-
-   inline pos3d::pos3d(const pos3d& pos)
-   : m_x(pos.m_x),m_y(pos.m_y),m_z(pos.m_z)
-   {}
-
-   inline pos3d::~pos3d()
-   {}
-
-   //Operators
-
-   inline pos3d& pos3d::operator*=(double value) {m_x*=value;m_y*=value;m_z*=value;return *this;}
-   inline pos3d& pos3d::operator/=(double value) {m_x/=value;m_y/=value;m_z/=value;return *this;}
-   inline pos3d& pos3d::operator+=(const pos3d& pos) {m_x+=pos.m_x;m_y+=pos.m_y;m_z+=pos.m_z;return *this;}
-   inline pos3d& pos3d::operator-=(const pos3d& pos) {m_x-=pos.m_x;m_y-=pos.m_y;m_z-=pos.m_z;return *this;}
-
-   inline pos3d pos3d::operator-() const {return pos3d(-m_x,-m_y,-m_z);}
-
-   // Access
+   constexpr pos3d operator+(const pos3d& pos1, const pos3d& pos2) noexcept { return pos3d(pos1.x()+pos2.x(),pos1.y()+pos2.y(),pos1.z()+pos2.z()); }
+   constexpr pos3d operator-(const pos3d& pos1, const pos3d& pos2) noexcept { return pos3d(pos1.x()-pos2.x(),pos1.y()-pos2.y(),pos1.z()-pos2.z()); }
+   constexpr pos3d operator*(const pos3d& pos, double value) noexcept       { return pos3d(pos.x()*value,pos.y()*value,pos.z()*value); }
+   constexpr pos3d operator*(double value, const pos3d& pos) noexcept       { return pos3d(pos.x()*value,pos.y()*value,pos.z()*value); }
+   constexpr pos3d operator/(const pos3d& pos, double value) noexcept       { return pos3d(pos.x()/value,pos.y()/value,pos.z()/value); }
 
-   inline const double& pos3d::x() const {return m_x;}
-   inline const double& pos3d::y() const {return m_y;}
-   inline const double& pos3d::z() const {return m_z;}
+}
 
-   inline void pos3d::x( double x ) {m_x=x;}
-   inline void pos3d::y( double y ) {m_y=y;}
-   inline void pos3d::z( double z ) {m_z=z;}
+// the pos3d/vec3d mixed operations require both classes to be complete
+#include "vec3d.h"
 
-   // Operators
+namespace spacemath {
 
-   inline pos3d operator+(const pos3d& pos1, const pos3d& pos2) {return pos3d(pos1)+=pos2;}
-   inline pos3d operator-(const pos3d& pos1, const pos3d& pos2) {return pos3d(pos1)-=pos2;}
-   inline pos3d operator*(const pos3d& pos, double value) {return pos3d(pos)*=value;}
-   inline pos3d operator*(double value, const pos3d& pos) {return pos3d(pos)*=value;}
-   inline pos3d operator/(const pos3d& pos, double value) {return pos3d(pos)/=value;}
+   inline pos3d& pos3d::operator+=(const vec3d& vec) noexcept { m_x+=vec.x(); m_y+=vec.y(); m_z+=vec.z(); return *this; }
+   inline pos3d& pos3d::operator-=(const vec3d& vec) noexcept { m_x-=vec.x(); m_y-=vec.y(); m_z-=vec.z(); return *this; }
+   inline pos3d& pos3d::move(const vec3d& vec) noexcept       { return operator+=(vec); }
 
-   inline pos3d operator+(const pos3d& pos, const vec3d& vec) { return pos3d(pos)+=vec; }
-   inline pos3d operator+(const vec3d& vec, const pos3d& pos) { return pos3d(pos)+=vec; }
-   inline pos3d operator-(const pos3d& pos, const vec3d& vec) { return pos3d(pos)-=vec; }
-   inline pos3d operator-(const vec3d& vec, const pos3d& pos) { return pos3d(-pos)+=vec; }
+   constexpr pos3d operator+(const pos3d& pos, const vec3d& vec) noexcept { return pos3d(pos.x()+vec.x(),pos.y()+vec.y(),pos.z()+vec.z()); }
+   constexpr pos3d operator+(const vec3d& vec, const pos3d& pos) noexcept { return pos3d(pos.x()+vec.x(),pos.y()+vec.y(),pos.z()+vec.z()); }
+   constexpr pos3d operator-(const pos3d& pos, const vec3d& vec) noexcept { return pos3d(pos.x()-vec.x(),pos.y()-vec.y(),pos.z()-vec.z()); }
+   constexpr pos3d operator-(const vec3d& vec, const pos3d& pos) noexcept { return pos3d(-pos.x()+vec.x(),-pos.y()+vec.y(),-pos.z()+vec.z()); }
 
 }
 
@@ -0,0 +1,537 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#include "triangle_bvh.h"
+#include "parallel_for.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace spacemath {
+
+   const size_t triangle_bvh::npos;
+
+   static const size_t   bvh_bins      = 16;   // number of SAH bins per axis
+   static const size_t   bvh_min_leaf  = 4;    // nodes with this many triangles or less are always leaves
+   static const size_t   bvh_max_leaf  = 8;    // leaves with more triangles are split if possible
+   static const size_t   bvh_max_depth = 48;   // below this depth nodes are split at the median, bounding the tree depth
+   static const size_t   bvh_stack     = 128;  // traversal stack size, larger than the maximum tree depth
+   static const double   bvh_bary_tol  = 1.0E-9; // barycentric tolerance, so hits on edges and corners are included
+   static const double   bvh_four_pi   = 12.566370614359172; // full solid angle
+
+   // round to float, downwards or upwards, so float boxes always contain the double coordinates
+   static inline float round_down(double x)
+   {
+      float f = float(x);
+      return (double(f) > x)? std::nextafter(f,-std::numeric_limits<float>::max()) : f;
+   }
+
+   static inline float round_up(double x)
+   {
+      float f = float(x);
+      return (double(f) < x)? std::nextafter(f,std::numeric_limits<float>::max()) : f;
+   }
+
+   // half surface area of a box
+   static inline double box_area(const float* bmin, const float* bmax)
+   {
+      double dx = bmax[0]-bmin[0];
+      double dy = bmax[1]-bmin[1];
+      double dz = bmax[2]-bmin[2];
+      return dx*dy + dy*dz + dz*dx;
+   }
+
+   static inline void box_init(float* bmin, float* bmax)
+   {
+      for(size_t k=0; k<3; k++) {
+         bmin[k] =  std::numeric_limits<float>::max();
+         bmax[k] = -std::numeric_limits<float>::max();
+      }
+   }
+
+   static inline void box_enclose(float* bmin, float* bmax, const float* omin, const float* omax)
+   {
+      for(size_t k=0; k<3; k++) {
+         bmin[k] = std::min(bmin[k],omin[k]);
+         bmax[k] = std::max(bmax[k],omax[k]);
+      }
+   }
+
+   // extend centroid bounds by the centroid of a box, represented as bmin+bmax
+   static inline void centroid_enclose(float* cmin, float* cmax, const float* bmin, const float* bmax)
+   {
+      for(size_t k=0; k<3; k++) {
+         float c = bmin[k] + bmax[k];
+         cmin[k] = std::min(cmin[k],c);
+         cmax[k] = std::max(cmax[k],c);
+      }
+   }
+
+   triangle_bvh::triangle_bvh()
+   {}
+
+   triangle_bvh::~triangle_bvh()
+   {}
+
+   void triangle_bvh::clear()
+   {
+      m_nodes.clear();
+      m_tri.clear();
+      m_dipoles.clear();
+   }
+
+   void triangle_bvh::build(const polyhedron3d& poly)
+   {
+      size_t nface = poly.face_size();
+      vtx_vec corners(3*nface);
+      for(size_t iface=0; iface<nface; iface++) {
+         const pface& face = poly.face(iface);
+         if(face.size() != 3) throw std::logic_error("triangle_bvh::build(...) non-triangular face: " + std::to_string(iface));
+         for(size_t k=0; k<3; k++) corners[3*iface+k] = poly.vertex(face[k]);
+      }
+      build(corners);
+   }
+
+   void triangle_bvh::build(const vtx_vec& corners, const std::vector<size_t>& tri_id)
+   {
+      clear();
+
+      size_t ntri = corners.size()/3;
+      if(corners.size() != 3*ntri)     throw std::logic_error("triangle_bvh::build(...) number of corners is not a multiple of 3: " + std::to_string(corners.size()));
+      if(tri_id.size()>0 && tri_id.size()!=ntri) throw std::logic_error("triangle_bvh::build(...) number of triangle ids does not match triangles: " + std::to_string(tri_id.size()));
+      if(ntri >= std::numeric_limits<uint32_t>::max()) throw std::logic_error("triangle_bvh::build(...) too many triangles: " + std::to_string(ntri));
+      if(ntri == 0) return;
+
+      // triangle bounding boxes and centroids
+      std::vector<build_item> items(ntri);
+      parallel_for(ntri,0,1<<14,[&corners,&items](size_t first, size_t last) {
+         for(size_t i=first; i<last; i++) {
+            const pos3d& p0 = corners[3*i];
+            const pos3d& p1 = corners[3*i+1];
+            const pos3d& p2 = corners[3*i+2];
+
+            build_item& item = items[i];
+            double x[3] = { p0.x(), p1.x(), p2.x() };
+            double y[3] = { p0.y(), p1.y(), p2.y() };
+            double z[3] = { p0.z(), p1.z(), p2.z() };
+            item.bmin[0] = round_down(std::min(x[0],std::min(x[1],x[2])));  item.bmax[0] = round_up(std::max(x[0],std::max(x[1],x[2])));
+            item.bmin[1] = round_down(std::min(y[0],std::min(y[1],y[2])));  item.bmax[1] = round_up(std::max(y[0],std::max(y[1],y[2])));
+            item.bmin[2] = round_down(std::min(z[0],std::min(z[1],z[2])));  item.bmax[2] = round_up(std::max(z[0],std::max(z[1],z[2])));
+            item.tri = uint32_t(i);
+         }
+      });
+
+      build_bounds bounds;
+      compute_bounds(items,0,ntri,bounds);
+
+      // the top of the tree is built serially, and nodes below a size limit are left as tasks.
+      // The task subtrees are built concurrently into their own node vectors, and appended afterwards
+      size_t nthreads  = parallel_threads(0);
+      size_t task_size = std::max(ntri/(8*nthreads),size_t(1<<14));
+      std::vector<build_task> tasks;
+      m_nodes.reserve(2*ntri/bvh_max_leaf + 1);
+      m_nodes.push_back(node());
+      build_node(m_nodes,0,items,0,ntri,0,bounds,(ntri > task_size)? task_size : 0,&tasks);
+
+      std::vector<std::vector<node>> task_nodes(tasks.size());
+      parallel_tasks(tasks.size(),nthreads,[&items,&tasks,&task_nodes](size_t itask) {
+         const build_task& task = tasks[itask];
+         std::vector<node>& nodes = task_nodes[itask];
+         nodes.reserve(2*(task.last-task.first)/bvh_max_leaf + 1);
+         nodes.push_back(node());
+         build_node(nodes,0,items,task.first,task.last,task.depth,task.bounds,0,nullptr);
+      });
+
+      // the task root replaces its placeholder node, the other task nodes are appended with child indices adjusted
+      for(size_t itask=0; itask<tasks.size(); itask++) {
+         const std::vector<node>& nodes = task_nodes[itask];
+         uint32_t offset = uint32_t(m_nodes.size()) - 1;
+         node root = nodes[0];
+         if(root.count == 0) root.first += offset;
+         m_nodes[tasks[itask].inode] = root;
+         for(size_t i=1; i<nodes.size(); i++) {
+            m_nodes.push_back(nodes[i]);
+            if(m_nodes.back().count == 0) m_nodes.back().first += offset;
+         }
+         std::vector<node>().swap(task_nodes[itask]);
+      }
+
+      // inflate the node boxes slightly, so rounding in the traversal cannot miss hits on the box boundaries
+      const node& root = m_nodes[0];
+      double extent = std::max(root.bmax[0]-root.bmin[0],std::max(root.bmax[1]-root.bmin[1],root.bmax[2]-root.bmin[2]));
+      double margin = 1.0E-7*std::max(extent,1.0);
+      for(node& nd : m_nodes) {
+         for(size_t k=0; k<3; k++) {
+            nd.bmin[k] = round_down(nd.bmin[k] - margin);
+            nd.bmax[k] = round_up(nd.bmax[k] + margin);
+         }
+      }
+
+      // store the triangles in leaf order
+      m_tri.resize(ntri);
+      parallel_for(ntri,0,1<<14,[this,&corners,&tri_id,&items](size_t first, size_t last) {
+         for(size_t i=first; i<last; i++) {
+            size_t itri = items[i].tri;
+            const pos3d& p0 = corners[3*itri];
+            triangle& tri = m_tri[i];
+            tri.p0 = p0;
+            tri.e1 = vec3d(p0,corners[3*itri+1]);
+            tri.e2 = vec3d(p0,corners[3*itri+2]);
+            tri.id = (tri_id.size()>0)? tri_id[itri] : itri;
+         }
+      });
+
+      build_dipoles();
+   }
+
+   void triangle_bvh::build_dipoles()
+   {
+      size_t nnode = m_nodes.size();
+      m_dipoles.resize(nnode);
+
+      // leaves from their triangles
+      parallel_for(nnode,0,1<<14,[this](size_t first, size_t last) {
+         for(size_t inode=first; inode<last; inode++) {
+            const node& nd = m_nodes[inode];
+            if(nd.count == 0) continue;
+
+            vec3d  area;
+            pos3d  centre;
+            double weight = 0.0;
+            for(size_t i=nd.first; i<nd.first+nd.count; i++) {
+               const triangle& tri = m_tri[i];
+               vec3d  a = 0.5*tri.e1.cross(tri.e2);
+               double w = a.length();
+               area   += a;
+               centre += w*(tri.p0 + (tri.e1+tri.e2)*(1.0/3.0));
+               weight += w;
+            }
+
+            // degenerate triangles have no weight, then the first corner is used
+            centre = (weight > 0.0)? centre/weight : m_tri[nd.first].p0;
+            double radius2 = 0.0;
+            for(size_t i=nd.first; i<nd.first+nd.count; i++) {
+               const triangle& tri = m_tri[i];
+               radius2 = std::max(radius2,centre.dist_squared(tri.p0));
+               radius2 = std::max(radius2,centre.dist_squared(tri.p0+tri.e1));
+               radius2 = std::max(radius2,centre.dist_squared(tri.p0+tri.e2));
+            }
+            m_dipoles[inode] = dipole{area,centre,radius2};
+         }
+      });
+
+      // interior nodes from their children. Children always have higher indices than their parent
+      for(size_t inode=nnode; inode-- > 0; ) {
+         const node& nd = m_nodes[inode];
+         if(nd.count > 0) continue;
+
+         const dipole& d0 = m_dipoles[nd.first];
+         const dipole& d1 = m_dipoles[nd.first+1];
+         double w0 = d0.area.length();
+         double w1 = d1.area.length();
+         pos3d  centre = (w0+w1 > 0.0)? (w0*d0.centre + w1*d1.centre)/(w0+w1) : d0.centre;
+
+         // the sphere must enclose both child spheres, and need not be larger than the sphere enclosing the node box
+         double r0 = centre.dist(d0.centre) + std::sqrt(d0.radius2);
+         double r1 = centre.dist(d1.centre) + std::sqrt(d1.radius2);
+         double radius2 = std::max(r0,r1);
+         radius2 *= radius2;
+         double box2 = 0.0;
+         for(size_t k=0; k<3; k++) {
+            double c = (k==0)? centre.x() : ((k==1)? centre.y() : centre.z());
+            double d = std::max(c-nd.bmin[k],nd.bmax[k]-c);
+            box2 += d*d;
+         }
+         m_dipoles[inode] = dipole{d0.area+d1.area,centre,std::min(radius2,box2)};
+      }
+   }
+
+   void triangle_bvh::compute_bounds(const std::vector<build_item>& items, size_t first, size_t last, build_bounds& bounds)
+   {
+      box_init(bounds.bmin,bounds.bmax);
+      box_init(bounds.cmin,bounds.cmax);
+      for(size_t i=first; i<last; i++) {
+         box_enclose(bounds.bmin,bounds.bmax,items[i].bmin,items[i].bmax);
+         centroid_enclose(bounds.cmin,bounds.cmax,items[i].bmin,items[i].bmax);
+      }
+   }
+
+   void triangle_bvh::build_node(std::vector<node>& nodes, uint32_t inode, std::vector<build_item>& items, size_t first, size_t last,
+                                 size_t depth, const build_bounds& bounds, size_t task_size, std::vector<build_task>* tasks)
+   {
+      node nd;
+      const float* cmin = bounds.cmin;
+      const float* cmax = bounds.cmax;
+      for(size_t k=0; k<3; k++) {
+         nd.bmin[k] = bounds.bmin[k];
+         nd.bmax[k] = bounds.bmax[k];
+      }
+
+      size_t n = last - first;
+      nd.first = uint32_t(first);
+      nd.count = uint32_t(n);
+      if(n <= bvh_min_leaf) {
+         nodes[inode] = nd;
+         return;
+      }
+
+      // leave the subtree to a task when it is small enough
+      if(tasks && n <= task_size) {
+         nodes[inode] = nd;
+         tasks->push_back(build_task{inode,first,last,depth,bounds});
+         return;
+      }
+
+      // find the best SAH split along the axis of largest centroid extent.
+      // The cost of a split is the sum of child areas times triangle counts
+      double best_cost = std::numeric_limits<double>::max();
+      size_t best_axis = 3;
+      size_t best_bin  = 0;
+      size_t axis = 0;
+      for(size_t k=1; k<3; k++) if(cmax[k]-cmin[k] > cmax[axis]-cmin[axis]) axis = k;
+      float  extent = cmax[axis] - cmin[axis];
+
+      // bin bounds, so the child bounds of the chosen split are known without another pass
+      size_t       count[bvh_bins] = { 0 };
+      build_bounds bin[bvh_bins];
+      if(extent > 0.0) {
+         for(size_t b=0; b<bvh_bins; b++) {
+            box_init(bin[b].bmin,bin[b].bmax);
+            box_init(bin[b].cmin,bin[b].cmax);
+         }
+
+         float scale = bvh_bins/extent;
+         for(size_t i=first; i<last; i++) {
+            const build_item& item = items[i];
+            size_t b = std::min(bvh_bins-1,size_t((item.bmin[axis]+item.bmax[axis]-cmin[axis])*scale));
+            count[b]++;
+            box_enclose(bin[b].bmin,bin[b].bmax,item.bmin,item.bmax);
+            centroid_enclose(bin[b].cmin,bin[b].cmax,item.bmin,item.bmax);
+         }
+
+         // sweep from the right, then from the left, splitting after bin b
+         double right_cost[bvh_bins];
+         float rmin[3],rmax[3];
+         box_init(rmin,rmax);
+         size_t rcount = 0;
+         for(size_t b=bvh_bins-1; b>0; b--) {
+            rcount += count[b];
+            box_enclose(rmin,rmax,bin[b].bmin,bin[b].bmax);
+            right_cost[b-1] = (rcount>0)? rcount*box_area(rmin,rmax) : 0.0;
+         }
+         float lmin[3],lmax[3];
+         box_init(lmin,lmax);
+         size_t lcount = 0;
+         for(size_t b=0; b<bvh_bins-1; b++) {
+            lcount += count[b];
+            box_enclose(lmin,lmax,bin[b].bmin,bin[b].bmax);
+            if(lcount==0 || lcount==n) continue;
+            double cost = lcount*box_area(lmin,lmax) + right_cost[b];
+            if(cost < best_cost) {
+               best_cost = cost;
+               best_axis = axis;
+               best_bin  = b;
+            }
+         }
+      }
+
+      // all centroids coincide, the triangles cannot be separated
+      if(best_axis == 3) {
+         nodes[inode] = nd;
+         return;
+      }
+
+      // small nodes become leaves when splitting does not pay off
+      double area = box_area(nd.bmin,nd.bmax);
+      if(n <= bvh_max_leaf && (area + best_cost) >= n*area) {
+         nodes[inode] = nd;
+         return;
+      }
+
+      size_t mid = first;
+      build_bounds left,right;
+      if(depth < bvh_max_depth) {
+         float cmin_axis = cmin[best_axis];
+         float scale     = bvh_bins/(cmax[best_axis] - cmin_axis);
+         auto it = std::partition(items.begin()+first,items.begin()+last,[best_axis,best_bin,cmin_axis,scale](const build_item& item) {
+            return std::min(bvh_bins-1,size_t((item.bmin[best_axis]+item.bmax[best_axis]-cmin_axis)*scale)) <= best_bin;
+         });
+         mid = it - items.begin();
+
+         box_init(left.bmin,left.bmax);   box_init(left.cmin,left.cmax);
+         box_init(right.bmin,right.bmax); box_init(right.cmin,right.cmax);
+         for(size_t b=0; b<bvh_bins; b++) {
+            build_bounds& child = (b<=best_bin)? left : right;
+            box_enclose(child.bmin,child.bmax,bin[b].bmin,bin[b].bmax);
+            box_enclose(child.cmin,child.cmax,bin[b].cmin,bin[b].cmax);
+         }
+      }
+      if(mid == first || mid == last) {
+         // median split along the same axis
+         mid = first + n/2;
+         std::nth_element(items.begin()+first,items.begin()+mid,items.begin()+last,[axis](const build_item& a, const build_item& b) {
+            return (a.bmin[axis]+a.bmax[axis]) < (b.bmin[axis]+b.bmax[axis]);
+         });
+         compute_bounds(items,first,mid,left);
+         compute_bounds(items,mid,last,right);
+      }
+
+      // the children are stored as a pair of adjacent nodes
+      uint32_t ichild = uint32_t(nodes.size());
+      nodes.push_back(node());
+      nodes.push_back(node());
+      nd.first = ichild;
+      nd.count = 0;
+      nodes[inode] = nd;
+      build_node(nodes,ichild,items,first,mid,depth+1,left,task_size,tasks);
+      build_node(nodes,ichild+1,items,mid,last,depth+1,right,task_size,tasks);
+   }
+
+   double triangle_bvh::solid_angle(const triangle& tri, const pos3d& pos)
+   {
+      // Van Oosterom and Strackee formula, with corners relative to pos
+      vec3d  a(pos,tri.p0);
+      vec3d  b = a + tri.e1;
+      vec3d  c = a + tri.e2;
+      double la = a.length();
+      double lb = b.length();
+      double lc = c.length();
+      double numerator   = a.dot(b.cross(c));
+      double denominator = la*lb*lc + a.dot(b)*lc + b.dot(c)*la + c.dot(a)*lb;
+      return 2.0*std::atan2(numerator,denominator);
+   }
+
+   bool triangle_bvh::intersect_triangle(const triangle& tri, const pos3d& origin, const vec3d& dir, double& t)
+   {
+      vec3d  pvec = dir.cross(tri.e2);
+      double det  = tri.e1.dot(pvec);
+      if(det == 0.0) return false;  // ray parallel to the triangle plane
+      double inv_det = 1.0/det;
+
+      vec3d  tvec(tri.p0,origin);
+      double u = tvec.dot(pvec)*inv_det;
+      if(u < -bvh_bary_tol || u > 1.0+bvh_bary_tol) return false;
+
+      vec3d  qvec = tvec.cross(tri.e1);
+      double v = dir.dot(qvec)*inv_det;
+      if(v < -bvh_bary_tol || u+v > 1.0+bvh_bary_tol) return false;
+
+      t = tri.e2.dot(qvec)*inv_det;
+      return (std::isfinite(t) && t > 0.0);
+   }
+
+   template <class Visit>
+   void triangle_bvh::traverse(const pos3d& origin, const vec3d& dir, const double& tmax, Visit visit) const
+   {
+      if(m_nodes.size() == 0) return;
+
+      const double o[3] = { origin.x(), origin.y(), origin.z() };
+      const double d[3] = { dir.x(), dir.y(), dir.z() };
+      double inv[3];
+      for(size_t k=0; k<3; k++) inv[k] = (d[k] != 0.0)? 1.0/d[k] : 0.0;
+
+      uint32_t stack[bvh_stack];
+      size_t   sp = 0;
+      stack[sp++] = 0;
+      while(sp > 0) {
+         uint32_t inode = stack[--sp];
+         const node& nd = m_nodes[inode];
+
+         // slab test of the node box against the ray segment t=[0,tmax]
+         double tnear = 0.0;
+         double tfar  = tmax;
+         bool   hit   = true;
+         for(size_t k=0; k<3 && hit; k++) {
+            if(d[k] == 0.0) {
+               hit = (o[k] >= nd.bmin[k]) && (o[k] <= nd.bmax[k]);
+            }
+            else {
+               double t0 = (nd.bmin[k]-o[k])*inv[k];
+               double t1 = (nd.bmax[k]-o[k])*inv[k];
+               if(t0 > t1) std::swap(t0,t1);
+               tnear = std::max(tnear,t0);
+               tfar  = std::min(tfar,t1);
+               hit   = (tnear <= tfar);
+            }
+         }
+         if(!hit) continue;
+
+         if(nd.count > 0) {
+            for(size_t i=nd.first; i<nd.first+nd.count; i++) visit(m_tri[i]);
+         }
+         else {
+            stack[sp++] = nd.first+1;
+            stack[sp++] = nd.first;
+         }
+      }
+   }
+
+   void triangle_bvh::intersect(const pos3d& origin, const vec3d& dir, std::vector<ray_hit>& hits, size_t skip) const
+   {
+      const double tmax = std::numeric_limits<double>::max();
+      traverse(origin,dir,tmax,[&origin,&dir,&hits,skip](const triangle& tri) {
+         double t = 0.0;
+         if(tri.id != skip && intersect_triangle(tri,origin,dir,t)) hits.push_back(ray_hit{t,tri.id});
+      });
+   }
+
+   triangle_bvh::ray_hit triangle_bvh::intersect_first(const pos3d& origin, const vec3d& dir, size_t skip) const
+   {
+      ray_hit first_hit = { std::numeric_limits<double>::max(), npos };
+      traverse(origin,dir,first_hit.t,[&origin,&dir,&first_hit,skip](const triangle& tri) {
+         double t = 0.0;
+         if(tri.id != skip && intersect_triangle(tri,origin,dir,t) && t < first_hit.t) {
+            first_hit.t   = t;
+            first_hit.tri = tri.id;
+         }
+      });
+      return first_hit;
+   }
+
+   double triangle_bvh::winding_number(const pos3d& pos, double beta) const
+   {
+      if(m_nodes.size() == 0) return 0.0;
+
+      const double beta2 = beta*beta;
+      double omega = 0.0;
+
+      uint32_t stack[bvh_stack];
+      size_t   sp = 0;
+      stack[sp++] = 0;
+      while(sp > 0) {
+         uint32_t inode = stack[--sp];
+         const node&   nd = m_nodes[inode];
+         const dipole& dp = m_dipoles[inode];
+
+         // far away nodes contribute the solid angle of their dipole
+         vec3d  r(pos,dp.centre);
+         double dist2 = r.squareLength();
+         if(dist2 > beta2*dp.radius2) {
+            omega += r.dot(dp.area)/(dist2*std::sqrt(dist2));
+         }
+         else if(nd.count > 0) {
+            for(size_t i=nd.first; i<nd.first+nd.count; i++) omega += solid_angle(m_tri[i],pos);
+         }
+         else {
+            stack[sp++] = nd.first+1;
+            stack[sp++] = nd.first;
+         }
+      }
+      return omega/bvh_four_pi;
+   }
+
+}
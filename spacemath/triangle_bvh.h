@@ -0,0 +1,154 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef TRIANGLE_BVH_H
+#define TRIANGLE_BVH_H
+
+#include "spacemath_config.h"
+#include "polyhedron3d.h"
+#include "pos3d.h"
+#include "vec3d.h"
+#include <vector>
+#include <cstdint>
+
+namespace spacemath {
+
+   // triangle_bvh is a bounding volume hierarchy over a set of triangles, used for ray casting and winding numbers.
+   // The tree is built top-down with a binned surface area heuristic (SAH), the lower subtrees in parallel,
+   // and stored as a flat node array. Rays are traversed with an explicit stack, and tested against
+   // the triangles in the leaves using the Moller-Trumbore algorithm.
+   // Each node also stores a dipole approximation of its triangles, used for fast generalized winding numbers.
+   // The hierarchy is a snapshot of the triangle geometry and must be rebuilt when it changes.
+   class SPACEMATH_PUBLIC triangle_bvh {
+   public:
+      static const size_t npos = static_cast<size_t>(-1);
+
+      // intersection of a ray with triangle tri, at distance t along the ray direction
+      struct ray_hit {
+         double t;
+         size_t tri;
+      };
+
+      triangle_bvh();
+      virtual ~triangle_bvh();
+
+      // build the hierarchy over triangles [0,ntri), where triangle i has corners corners[3*i], corners[3*i+1], corners[3*i+2].
+      // Triangle ids given in tri_id are reported in hits instead of the triangle index, when not empty
+      void build(const vtx_vec& corners, const std::vector<size_t>& tri_id = std::vector<size_t>());
+
+      // build the hierarchy over the faces of poly, triangle ids are face indices. Throws logic_error for non-triangular faces
+      void build(const polyhedron3d& poly);
+
+      // remove all data
+      void clear();
+
+      // number of triangles
+      inline size_t size() const { return m_tri.size(); }
+
+      // compute all intersections between the ray origin + t*dir and the triangles, for t>0.
+      // Hits on triangle edges and corners are included, so a ray passing through an edge may hit both neighbour triangles.
+      // The triangle with id skip is ignored. Hits are appended to hits in no particular order
+      void intersect(const pos3d& origin, const vec3d& dir, std::vector<ray_hit>& hits, size_t skip = npos) const;
+
+      // return the closest intersection for t>0, or a hit with tri=npos when there is none
+      ray_hit intersect_first(const pos3d& origin, const vec3d& dir, size_t skip = npos) const;
+
+      // return the generalized winding number of the triangles at pos, i.e. their total signed solid angle divided by 4*pi.
+      // For a closed surface with outward normals (counterclockwise corners seen from outside) it is 1 inside and 0 outside,
+      // for open or defective surfaces it varies smoothly in between. Nodes further away than beta times their radius
+      // are approximated by their dipole term, nearer triangles are evaluated exactly.
+      double winding_number(const pos3d& pos, double beta = 2.0) const;
+
+   private:
+      // node bounding box, and either a leaf with count triangles from index first,
+      // or an interior node (count=0) with children at node indices first and first+1
+      // The boxes are stored as floats rounded outwards, so a node fits in 32 bytes.
+      struct node {
+         float    bmin[3];
+         float    bmax[3];
+         uint32_t first;
+         uint32_t count;
+      };
+
+      // triangle in the form used by Moller-Trumbore: corner p0 and edges e1=p1-p0, e2=p2-p0
+      struct triangle {
+         pos3d  p0;
+         vec3d  e1;
+         vec3d  e2;
+         size_t id;
+      };
+
+      // far field approximation of the triangles below a node: the sum of triangle area vectors,
+      // the area weighted centre and the squared radius of a sphere around the centre enclosing the triangles
+      struct dipole {
+         vec3d  area;
+         pos3d  centre;
+         double radius2;
+      };
+
+      // triangle bounding box rounded outwards to floats, used during build.
+      // The centroids are represented as bmin+bmax, i.e. twice the box centre
+      struct build_item {
+         float    bmin[3];
+         float    bmax[3];
+         uint32_t tri;
+      };
+
+      // bounds of a range of build items and of their centroids
+      struct build_bounds {
+         float bmin[3];
+         float bmax[3];
+         float cmin[3];
+         float cmax[3];
+      };
+
+      static void compute_bounds(const std::vector<build_item>& items, size_t first, size_t last, build_bounds& bounds);
+
+      // subtree left for concurrent building, inode is the placeholder node of the subtree root
+      struct build_task {
+         uint32_t     inode;
+         size_t       first;
+         size_t       last;
+         size_t       depth;
+         build_bounds bounds;
+      };
+
+      // build the subtree over items [first,last) with the given bounds into nodes[inode], appending child nodes to nodes.
+      // When tasks is given, subtrees with task_size items or less are recorded as tasks instead of being built
+      static void build_node(std::vector<node>& nodes, uint32_t inode, std::vector<build_item>& items, size_t first, size_t last,
+                             size_t depth, const build_bounds& bounds, size_t task_size, std::vector<build_task>* tasks);
+
+      // compute m_dipoles from m_nodes and m_tri, leaves in parallel and interior nodes bottom-up
+      void build_dipoles();
+
+      // exact solid angle of a triangle seen from pos, positive when pos is on the back side
+      static double solid_angle(const triangle& tri, const pos3d& pos);
+
+      // Moller-Trumbore ray/triangle intersection, returns true and sets t for an intersection
+      static bool intersect_triangle(const triangle& tri, const pos3d& origin, const vec3d& dir, double& t);
+
+      // visit the leaf triangles whose node boxes are hit by the ray, for t in (0,tmax]
+      template <class Visit>
+      void traverse(const pos3d& origin, const vec3d& dir, const double& tmax, Visit visit) const;
+
+   private:
+      std::vector<node>     m_nodes;    // node 0 is the root
+      std::vector<triangle> m_tri;      // triangles in leaf order
+      std::vector<dipole>   m_dipoles;  // dipole for each node
+   };
+
+}
+
+#endif // TRIANGLE_BVH_H
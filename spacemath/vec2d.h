@@ -17,65 +17,78 @@
 #define VEC2D_H
 
 #include "spacemath_config.h"
+#include <cmath>
 
 namespace spacemath {
    class pos2d;
 
-   // vector in 2d space
+   // vector in 2d space.
+   // vec2d is a trivially copyable value type, all arithmetic is inline so it can be optimised in inner loops
    class SPACEMATH_PUBLIC vec2d {
    public:
-      vec2d();
-      vec2d(double x,double y);
-      vec2d(const pos2d& start,const pos2d& end);
-      vec2d(const vec2d& vec);
-     ~vec2d();
-
-      double x() const;
-      double y() const;
-
-      vec2d& operator =(const vec2d& vec);
-      int    operator <(const vec2d& vec) const;
-      vec2d  operator -() const;
-
-      vec2d& normalise();
-      vec2d& scale(double factor);
-      vec2d& add(const vec2d& vec2);
-      vec2d& subtract(const vec2d& vec2);
-      vec2d& reverse();
-
-      double dot(const vec2d& vec2) const;
-      double cross(const vec2d& vec2) const;
-      double angle(const vec2d& vec2) const;
-      double length() const;
-
-      vec2d  normal(int sign) const;
+      constexpr vec2d() noexcept : m_x(0.0),m_y(0.0) {}
+      constexpr vec2d(double x,double y) noexcept : m_x(x),m_y(y) {}
+      constexpr vec2d(const pos2d& start,const pos2d& end) noexcept;
+
+      constexpr double x() const noexcept { return m_x; }
+      constexpr double y() const noexcept { return m_y; }
+
+      constexpr int    operator <(const vec2d& vec) const noexcept { return (m_x*m_x + m_y*m_y) < (vec.m_x*vec.m_x + vec.m_y*vec.m_y); }
+      constexpr vec2d  operator -() const noexcept                 { return vec2d(-m_x,-m_y); }
+
+      inline vec2d& normalise() noexcept
+      {
+         double len = length();
+         if(len > 0.0) {
+            m_x = m_x/len;
+            m_y = m_y/len;
+         }
+         return *this;
+      }
+      inline vec2d& scale(double factor) noexcept        { m_x*=factor; m_y*=factor; return *this; }
+      inline vec2d& add(const vec2d& vec2) noexcept      { m_x+=vec2.m_x; m_y+=vec2.m_y; return *this; }
+      inline vec2d& subtract(const vec2d& vec2) noexcept { m_x-=vec2.m_x; m_y-=vec2.m_y; return *this; }
+      inline vec2d& reverse() noexcept                   { m_x=-m_x; m_y=-m_y; return *this; }
+
+      constexpr double dot(const vec2d& vec2) const noexcept   { return m_x*vec2.m_x + m_y*vec2.m_y; }
+      constexpr double cross(const vec2d& vec2) const noexcept { return m_x*vec2.m_y - vec2.m_x*m_y; }
+      inline double angle(const vec2d& vec2) const noexcept
+      {
+         vec2d vector1(*this);
+         vec2d vector2(vec2);
+         vector1.normalise();
+         vector2.normalise();
+         double dotVal = vector1.dot( vector2 );
+         if (dotVal>1.0) dotVal = 1.0;
+         if (dotVal<-1.0) dotVal = -1.0;
+         return std::acos( dotVal );
+      }
+      inline double length() const noexcept                    { return std::sqrt(m_x*m_x + m_y*m_y); }
+
+      constexpr vec2d  normal(int sign) const noexcept         { return (sign<0)? vec2d(-m_y,m_x) : vec2d(m_y,-m_x); }
 
    //Vector arithmetic
-      vec2d& operator+=(const vec2d& vec);
-      vec2d& operator-=(const vec2d& vec);
-
-      double operator%=(const vec2d& vec);    //Scalar product
+      inline vec2d& operator+=(const vec2d& vec) noexcept      { m_x+=vec.m_x; m_y+=vec.m_y; return *this; }
+      inline vec2d& operator-=(const vec2d& vec) noexcept      { m_x-=vec.m_x; m_y-=vec.m_y; return *this; }
 
-      vec2d& operator*=(double factor);       //Scaling
-      vec2d operator+(const vec2d& vec);
-      vec2d operator-(const vec2d& vec);
+      constexpr double operator%=(const vec2d& vec) const noexcept { return m_x*vec.m_x + m_y*vec.m_y; }   //Scalar product
 
-      friend vec2d operator*(const vec2d& vec,double factor);
-      friend vec2d operator*(double factor,const vec2d& vec);
-      friend vec2d normalise(const vec2d& vec);
+      inline vec2d& operator*=(double factor) noexcept         { m_x*=factor; m_y*=factor; return *this; }   //Scaling
+      constexpr vec2d operator+(const vec2d& vec) const noexcept { return vec2d(m_x+vec.m_x,m_y+vec.m_y); }
+      constexpr vec2d operator-(const vec2d& vec) const noexcept { return vec2d(m_x-vec.m_x,m_y-vec.m_y); }
 
    private:
       double m_x;
       double m_y;
    };
 
-   inline vec2d normalise(const vec2d& vec)                      { return vec2d(vec).normalise();                     }
-   inline vec2d operator*(const vec2d& vec, double value)        { return vec2d(vec.x()*value,vec.y()*value);         }
-   inline vec2d operator*(double value, const vec2d& vec)        { return vec2d(value*vec.x(),value*vec.y());         }
-   inline vec2d operator+(const vec2d& vec1, const vec2d& vec2)  { return vec2d(vec1.x()+vec2.x(),vec1.y()+vec2.y()); }
-   inline vec2d operator-(const vec2d& vec1, const vec2d& vec2)  { return vec2d(vec1.x()-vec2.x(),vec1.y()-vec2.y()); }
+   inline    vec2d normalise(const vec2d& vec) noexcept                  { return vec2d(vec).normalise();                     }
+   constexpr vec2d operator*(const vec2d& vec, double value) noexcept    { return vec2d(vec.x()*value,vec.y()*value);         }
+   constexpr vec2d operator*(double value, const vec2d& vec) noexcept    { return vec2d(value*vec.x(),value*vec.y());         }
 
 }
 
-#endif
+// construction from two positions is defined in pos2d.h
+#include "pos2d.h"
 
+#endif
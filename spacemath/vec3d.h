@@ -17,76 +17,85 @@
 #define VEC3D_H
 
 #include "spacemath_config.h"
+#include <cmath>
 
 namespace spacemath {
 
    class pos3d;
    class HTmatrix;
 
-   // vector in 3d space
+   // vector in 3d space.
+   // vec3d is a trivially copyable value type, all arithmetic is inline so it can be optimised in inner loops
    class SPACEMATH_PUBLIC vec3d {
    public:
-      vec3d();
-      vec3d(double x,double y,double z);
-      vec3d(const pos3d& start,const pos3d& end);
-      vec3d(const vec3d& vec);
-     ~vec3d();
+      constexpr vec3d() noexcept : m_x(0.0),m_y(0.0),m_z(0.0) {}
+      constexpr vec3d(double x,double y,double z) noexcept : m_x(x),m_y(y),m_z(z) {}
+      constexpr vec3d(const pos3d& start,const pos3d& end) noexcept;
 
-      double x() const;
-      double y() const;
-      double z() const;
+      constexpr double x() const noexcept { return m_x; }
+      constexpr double y() const noexcept { return m_y; }
+      constexpr double z() const noexcept { return m_z; }
 
       //operators
-      vec3d& operator =(const vec3d& vec);
-      vec3d  operator -() const;
+      constexpr vec3d operator -() const noexcept { return vec3d(-m_x,-m_y,-m_z); }
 
       // Check if vectors are parallell within given angle tolerance
-      bool isParallel(const vec3d& vec, double angle_tol) const;
+      inline bool isParallel(const vec3d& vec, double angle_tol) const noexcept
+      {
+         if(std::fabs(angle(vec)) <= angle_tol)return true;
+         if(std::fabs(angle(-vec)) <= angle_tol)return true;
+         return false;
+      }
 
       // vector arithmetic
-      vec3d& operator+=(const vec3d& vec);
-      vec3d& operator-=(const vec3d& vec);
+      inline vec3d& operator+=(const vec3d& vec) noexcept { return add(vec); }
+      inline vec3d& operator-=(const vec3d& vec) noexcept { return subtract(vec); }
 
-      vec3d& operator*=(double factor);       //Scaling
+      inline vec3d& operator*=(double factor) noexcept    { return scale(factor); }   //Scaling
 
       // in-place manipulation of vector
-      vec3d& normalise();
-      vec3d& scale(double factor);
-      vec3d& add(const vec3d& vec2);
-      vec3d& subtract(const vec3d& vec2);
-      vec3d& reverse();
+      inline vec3d& normalise() noexcept
+      {
+         double len = length();
+         if(len > 0.0) {
+            m_x = m_x/len;
+            m_y = m_y/len;
+            m_z = m_z/len;
+         }
+         return *this;
+      }
+      inline vec3d& scale(double factor) noexcept         { m_x*=factor; m_y*=factor; m_z*=factor; return *this; }
+      inline vec3d& add(const vec3d& vec2) noexcept       { m_x+=vec2.m_x; m_y+=vec2.m_y; m_z+=vec2.m_z; return *this; }
+      inline vec3d& subtract(const vec3d& vec2) noexcept  { m_x-=vec2.m_x; m_y-=vec2.m_y; m_z-=vec2.m_z; return *this; }
+      inline vec3d& reverse() noexcept                    { m_x=-m_x; m_y=-m_y; m_z=-m_z; return *this; }
 
       // cross product
-      vec3d  cross(const vec3d& vec2) const;
+      constexpr vec3d  cross(const vec3d& vec2) const noexcept
+      {
+         return vec3d(m_y*vec2.m_z - m_z*vec2.m_y, m_z*vec2.m_x - m_x*vec2.m_z, m_x*vec2.m_y - m_y*vec2.m_x);
+      }
 
       // dot product
-      double dot(const vec3d& vec2) const;
+      constexpr double dot(const vec3d& vec2) const noexcept { return m_x*vec2.m_x + m_y*vec2.m_y + m_z*vec2.m_z; }
 
       // angle between vectors
-      double angle(const vec3d& vec2) const;
+      inline double angle(const vec3d& vec2) const noexcept
+      {
+         vec3d vector1(*this);
+         vec3d vector2(vec2);
+         vector1.normalise();
+         vector2.normalise();
+         double dotVal = vector1.dot( vector2 );
+         if (dotVal>1.0) dotVal = 1.0;
+         if (dotVal<-1.0) dotVal = -1.0;
+         return std::acos( dotVal );
+      }
 
       // length of vector
-      double length() const;
+      inline double length() const noexcept               { return std::sqrt(squareLength()); }
 
       // square length of vector
-      double squareLength() const;
-
-      //Cross product
-      friend vec3d operator*(const vec3d& vec1,const vec3d& vec2);
-
-      //Vector sum
-      friend vec3d operator+(const vec3d& vec1,const vec3d& vec2);
-      friend vec3d operator-(const vec3d& vec1,const vec3d& vec2);
-
-      //Scalar product
-      friend double operator%(const vec3d& vec1,const vec3d& vec2);
-
-      //Scaling
-      friend vec3d operator*(const vec3d& vec,double factor);
-      friend vec3d operator*(double factor,const vec3d& vec);
-
-      // normalisation of vector
-      friend vec3d normalise(const vec3d& vec);
+      constexpr double squareLength() const noexcept      { return m_x*m_x + m_y*m_y + m_z*m_z; }
 
       // vector transformation
       SPACEMATH_PUBLIC friend vec3d operator*(const HTmatrix& T, const vec3d& vec);
@@ -97,42 +106,36 @@ namespace spacemath {
       double m_z;
    };
 
-   //Construction from 3 components
-   inline vec3d::vec3d(double x,double y,double z)
-   : m_x(x),m_y(y),m_z(z)
-   {}
+   // vector arithmetic using free operators
 
-   inline vec3d::vec3d()
-   : m_x(0.0),m_y(0.0),m_z(0.0)
-   {}
+   //Cross product
+   constexpr vec3d operator*(const vec3d& vec1,const vec3d& vec2) noexcept { return vec1.cross(vec2); }
 
-   inline vec3d::vec3d(const vec3d& vec)
-   : m_x(vec.m_x),m_y(vec.m_y),m_z(vec.m_z)
-   {}
+   //Vector sum
+   constexpr vec3d operator+(const vec3d& vec1,const vec3d& vec2) noexcept { return vec3d(vec1.x()+vec2.x(),vec1.y()+vec2.y(),vec1.z()+vec2.z()); }
+   constexpr vec3d operator-(const vec3d& vec1,const vec3d& vec2) noexcept { return vec3d(vec1.x()-vec2.x(),vec1.y()-vec2.y(),vec1.z()-vec2.z()); }
 
-   inline vec3d::~vec3d()
-   {}
+   //Scalar product
+   constexpr double operator%(const vec3d& vec1,const vec3d& vec2) noexcept { return vec1.dot(vec2); }
 
-   // read access to components
-   inline double vec3d::x() const {return m_x;}
-   inline double vec3d::y() const {return m_y;}
-   inline double vec3d::z() const {return m_z;}
-
-   // vector arithmetic
-   inline vec3d& vec3d::operator+=(const vec3d& vec) {return add(vec);}
-   inline vec3d& vec3d::operator-=(const vec3d& vec) {return subtract(vec);}
-   inline vec3d& vec3d::operator*=(double factor) {return scale(factor);}
-   inline vec3d  vec3d::operator-() const {return vec3d(-m_x,-m_y,-m_z);}
-
-   // vector arithmetic using friend operators
-   inline vec3d operator*(const vec3d& vec1,const vec3d& vec2) {return vec1.cross(vec2);}
-   inline vec3d operator+(const vec3d& vec1,const vec3d& vec2) {return vec3d(vec1)+=vec2;}
-   inline vec3d operator-(const vec3d& vec1,const vec3d& vec2) {return vec3d(vec1)-=vec2;}
-   inline vec3d operator*(const vec3d& vec,double factor) {return vec3d(vec)*=factor;}
-   inline vec3d operator*(double factor,const vec3d& vec) {return vec3d(vec)*=factor;}
-   inline vec3d normalise(const vec3d& vec) {return vec3d(vec).normalise();}
+   //Scaling
+   constexpr vec3d operator*(const vec3d& vec,double factor) noexcept { return vec3d(vec.x()*factor,vec.y()*factor,vec.z()*factor); }
+   constexpr vec3d operator*(double factor,const vec3d& vec) noexcept { return vec3d(vec.x()*factor,vec.y()*factor,vec.z()*factor); }
+
+   // normalisation of vector
+   inline vec3d normalise(const vec3d& vec) noexcept { return vec3d(vec).normalise(); }
 
 }
 
-#endif
+// the pos3d/vec3d mixed operations require both classes to be complete
+#include "pos3d.h"
 
+namespace spacemath {
+
+   constexpr vec3d::vec3d(const pos3d& start,const pos3d& end) noexcept
+   : m_x(end.x()-start.x()),m_y(end.y()-start.y()),m_z(end.z()-start.z())
+   {}
+
+}
+
+#endif
@@ -1,6 +1,6 @@
 // BeginLicense:
 // Part of: spacelibs - reusable libraries for 3d space calculations
-// Copyright (C) 2017 Carsten Arnholm
+// Copyright (C) 2017-2020 Carsten Arnholm
 // All rights reserved
 //
 // This file may be used under the terms of either the GNU General
@@ -13,5 +13,12 @@
 // A PARTICULAR PURPOSE.
 // EndLicense:
 
-#include "multimap_pos3d.h"
+#include "vertex_buffer.h"
 
+namespace spacemath {
+
+   // explicit instantiation, so all members are compiled with the library
+   template class basic_vertex_buffer<double>;
+   template class basic_vertex_buffer<float>;
+
+}
@@ -0,0 +1,190 @@
+// BeginLicense:
+// Part of: spacelibs - reusable libraries for 3d space calculations
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE.
+// EndLicense:
+
+#ifndef VERTEX_BUFFER_H
+#define VERTEX_BUFFER_H
+
+#include "polyhedron3d.h"
+#include "bbox3d.h"
+#include "HTmatrix.h"
+#include "aligned_allocator.h"
+#include <vector>
+#include <stdexcept>
+#include <utility>
+
+namespace spacemath {
+
+   // basic_vertex_buffer stores vertex coordinates as a structure of arrays: separate, 64 byte aligned
+   // x, y and z arrays. This is the layout SIMD kernels want, as opposed to the array of pos3d in vtx_vec.
+   // T is the coordinate type: use vertex_buffer (double) for computations and vertex_buffer_f (float)
+   // for read-only workloads like visualisation, where half the memory and bandwidth is enough.
+   //
+   // vtx_vec is interleaved, so converting to or from it always copies. Constructing from an rvalue
+   // vtx_vec releases its memory after the conversion, so both layouts are not kept alive together.
+   // Buffers of the same type are moved without copying, and are converted between float and double directly.
+   template <class T>
+   class basic_vertex_buffer {
+   public:
+      typedef T                                        value_type;
+      typedef std::vector<T,aligned_allocator<T,64>>   array_type;
+
+      basic_vertex_buffer() {}
+      explicit basic_vertex_buffer(const vtx_vec& vert)         { assign(vert); }
+      explicit basic_vertex_buffer(vtx_vec&& vert)              { assign(std::move(vert)); }
+      explicit basic_vertex_buffer(const polyhedron3d& poly)    { assign(poly); }
+
+      // convert from a buffer with another coordinate type
+      template <class U>
+      explicit basic_vertex_buffer(const basic_vertex_buffer<U>& other)
+      : m_x(other.x_data(),other.x_data()+other.size())
+      , m_y(other.y_data(),other.y_data()+other.size())
+      , m_z(other.z_data(),other.z_data()+other.size())
+      {}
+
+      // copy coordinates from vtx_vec or a polyhedron
+      void assign(const vtx_vec& vert)
+      {
+         resize(vert.size());
+         for(size_t i=0; i<vert.size(); i++) set(i,vert[i]);
+      }
+
+      // take over the coordinates of vert and release its memory
+      void assign(vtx_vec&& vert)
+      {
+         assign(static_cast<const vtx_vec&>(vert));
+         vtx_vec().swap(vert);
+      }
+
+      void assign(const polyhedron3d& poly)
+      {
+         resize(poly.vertex_size());
+         for(size_t i=0; i<poly.vertex_size(); i++) set(i,poly.vertex(i));
+      }
+
+      // return the coordinates as vtx_vec
+      vtx_vec vertices() const
+      {
+         vtx_vec vert;
+         vert.reserve(size());
+         for(size_t i=0; i<size(); i++) vert.push_back(position(i));
+         return vert;
+      }
+
+      // copy the coordinates back into a polyhedron with the same number of vertices
+      void copy_to(polyhedron3d& poly) const
+      {
+         if(poly.vertex_size() != size()) throw std::logic_error("basic_vertex_buffer::copy_to(), vertex count mismatch");
+         for(size_t i=0; i<size(); i++) poly.set_vertex(i,position(i));
+      }
+
+      inline size_t size() const                  { return m_x.size(); }
+      inline bool   empty() const                 { return m_x.empty(); }
+
+      void reserve(size_t n)                      { m_x.reserve(n); m_y.reserve(n); m_z.reserve(n); }
+      void resize(size_t n)                       { m_x.resize(n);  m_y.resize(n);  m_z.resize(n); }
+      void clear()                                { m_x.clear();    m_y.clear();    m_z.clear(); }
+
+      inline void push_back(const pos3d& pos)
+      {
+         m_x.push_back(static_cast<T>(pos.x()));
+         m_y.push_back(static_cast<T>(pos.y()));
+         m_z.push_back(static_cast<T>(pos.z()));
+      }
+
+      inline pos3d position(size_t i) const       { return pos3d(m_x[i],m_y[i],m_z[i]); }
+      inline void  set(size_t i, const pos3d& pos)
+      {
+         m_x[i] = static_cast<T>(pos.x());
+         m_y[i] = static_cast<T>(pos.y());
+         m_z[i] = static_cast<T>(pos.z());
+      }
+
+      // direct access to the coordinate arrays
+      inline T*       x_data()                    { return m_x.data(); }
+      inline T*       y_data()                    { return m_y.data(); }
+      inline T*       z_data()                    { return m_z.data(); }
+      inline const T* x_data() const              { return m_x.data(); }
+      inline const T* y_data() const              { return m_y.data(); }
+      inline const T* z_data() const              { return m_z.data(); }
+
+      // bounding box of all vertices, not initialised when empty
+      bbox3d bbox() const
+      {
+         if(empty()) return bbox3d();
+         T xmin,xmax,ymin,ymax,zmin,zmax;
+         min_max(m_x,xmin,xmax);
+         min_max(m_y,ymin,ymax);
+         min_max(m_z,zmin,zmax);
+         return bbox3d(pos3d(xmin,ymin,zmin),pos3d(xmax,ymax,zmax));
+      }
+
+      // transform all vertices, same as T*pos for each pos3d
+      void transform_inplace(const HTmatrix& mat)
+      {
+         const double (&e)[4][4] = mat.detail().elem;
+         const size_t n = size();
+         T* x = m_x.data();
+         T* y = m_y.data();
+         T* z = m_z.data();
+         for(size_t i=0; i<n; i++) {
+            double xi = x[i], yi = y[i], zi = z[i];
+            x[i] = static_cast<T>(e[0][0]*xi + e[0][1]*yi + e[0][2]*zi + e[0][3]);
+            y[i] = static_cast<T>(e[1][0]*xi + e[1][1]*yi + e[1][2]*zi + e[1][3]);
+            z[i] = static_cast<T>(e[2][0]*xi + e[2][1]*yi + e[2][2]*zi + e[2][3]);
+         }
+      }
+
+   private:
+      // min/max over one array, using independent lanes so the compiler can keep them in SIMD registers
+      static void min_max(const array_type& a, T& vmin, T& vmax)
+      {
+         const size_t lanes = 8;
+         const size_t n = a.size();
+         const T* p = a.data();
+         T lmin[lanes], lmax[lanes];
+         for(size_t k=0; k<lanes; k++) lmin[k] = lmax[k] = p[0];
+
+         size_t i=0;
+         for(; i+lanes<=n; i+=lanes) {
+            for(size_t k=0; k<lanes; k++) {
+               lmin[k] = (p[i+k] < lmin[k])? p[i+k] : lmin[k];
+               lmax[k] = (p[i+k] > lmax[k])? p[i+k] : lmax[k];
+            }
+         }
+         for(; i<n; i++) {
+            lmin[0] = (p[i] < lmin[0])? p[i] : lmin[0];
+            lmax[0] = (p[i] > lmax[0])? p[i] : lmax[0];
+         }
+
+         vmin = lmin[0];
+         vmax = lmax[0];
+         for(size_t k=1; k<lanes; k++) {
+            vmin = (lmin[k] < vmin)? lmin[k] : vmin;
+            vmax = (lmax[k] > vmax)? lmax[k] : vmax;
+         }
+      }
+
+   private:
+      array_type m_x;
+      array_type m_y;
+      array_type m_z;
+   };
+
+   typedef basic_vertex_buffer<double> vertex_buffer;    // double precision coordinates
+   typedef basic_vertex_buffer<float>  vertex_buffer_f;  // single precision coordinates
+
+}
+
+#endif // VERTEX_BUFFER_H